@@ -0,0 +1,85 @@
+/*
+ * AdaptiveBackground.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef ADAPTIVEBACKGROUND_H_
+#define ADAPTIVEBACKGROUND_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <vector>
+
+/**
+ * This class is a background model that follows changes of the scene, as an alternative to the
+ * static background mask. With the static mask, any change in lighting or camera pose leaves dark
+ * areas that are not in the background image, and each of them becomes a blob that has to be
+ * labeled and may be taken for the target.
+ *
+ * The blob detection subtracts a binary background from the thresholded frame, so the model is
+ * kept in the same terms: for every pixel it holds a running average of how often the pixel was
+ * dark (see ForegroundKernels::AdaptiveSubtract()). It starts out as the static background mask and
+ * every frame moves it by 1 / 2^rate towards the thresholded frame, so an area that stays dark for
+ * about 0.7 * 2^rate frames becomes background and one that stays bright for as long stops being
+ * background. The area around the target is left out of the update, so the target itself is never
+ * learnt as background.
+ *
+ * A model is kept for every frame size that is requested.
+ */
+class AdaptiveBackground
+{
+public:
+	/**
+	 * The background_mode of the dynamic reconfiguration.
+	 */
+	enum Mode
+	{
+		STATIC = 0,
+		ADAPTIVE = 1
+	};
+
+	AdaptiveBackground();
+
+	/**
+	 * Releases the models.
+	 */
+	virtual ~AdaptiveBackground();
+
+	/**
+	 * Sets how fast the model follows the scene, as the power of two of the number of frames.
+	 */
+	void SetRate( int rate );
+
+	/**
+	 * Forgets what has been learnt, every model starts out from the static background again.
+	 */
+	void Reset();
+
+	/**
+	 * Thresholds the region of interest of the gray image into the mask and removes the background
+	 * from it, the mask may be the gray image itself. The seed is the static background mask for a
+	 * frame of this size (or NULL) that a new model starts out as. If update is set, the model then
+	 * learns from the region of interest, except for the frozen rectangle (in image coordinates).
+	 */
+	void Subtract( const IplImage* gray, const IplImage* seed, int threshold, bool update, CvRect frozen, IplImage* mask );
+
+private:
+	/**
+	 * Returns the model for a frame of the provided size, creating it from the seed if there is
+	 * none.
+	 */
+	IplImage* GetModel( CvSize size, const IplImage* seed );
+
+protected:
+	std::vector<IplImage*>							m_models;
+	int												m_rate;
+
+	/*
+	 * The oldest model is dropped once this many sizes are kept.
+	 */
+	const static unsigned int						m_max_models = 4;
+};
+
+#endif /* ADAPTIVEBACKGROUND_H_ */
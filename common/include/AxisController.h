@@ -0,0 +1,94 @@
+/*
+ * AxisController.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef AXISCONTROLLER_H_
+#define AXISCONTROLLER_H_
+
+/**
+ * This class turns the image error of one axis (a pixel offset or an angle in degrees) into a
+ * velocity for the base or the arm. It is the image-based visual servoing control law, with one
+ * controller per axis:
+ *
+ * BANG_BANG    - Drive at a fixed speed towards the target until the error is inside the dead band.
+ *                This is how the visual servoing used to move.
+ * PROPORTIONAL - The velocity is proportional to the error, so the robot moves fast while the
+ *                target is far away and slows down as it gets close instead of overshooting.
+ * PID          - As PROPORTIONAL, plus an integral term against a steady offset (friction, a
+ *                moving target) and a derivative term to damp the approach.
+ *
+ * In the proportional and PID modes the velocity is limited to a maximum and it may only change
+ * by the maximum acceleration per second, except that the robot always stops at once when the
+ * error is inside the dead band.
+ *
+ * The velocity has the sign of the error, the caller maps it onto the direction of the joint.
+ */
+class AxisController
+{
+public:
+	enum Mode
+	{
+		BANG_BANG = 0,
+		PROPORTIONAL = 1,
+		PID = 2
+	};
+
+	AxisController();
+
+	virtual ~AxisController();
+
+	void SetMode( int mode );
+	int GetMode() const;
+
+	static const char* GetName( int mode );
+
+	void SetGains( double kp, double ki, double kd );
+
+	/**
+	 * Sets the speed of the bang-bang mode and the velocity and acceleration limits of the other
+	 * modes. A limit of zero is no limit.
+	 */
+	void SetLimits( double bang_bang_speed, double max_velocity, double max_acceleration );
+
+	/**
+	 * Errors whose size is below the dead band count as on target.
+	 */
+	void SetDeadBand( double dead_band );
+
+	/**
+	 * Forgets the state of the previous run (integral, last error and last velocity).
+	 */
+	void Reset();
+
+	/**
+	 * Returns the velocity for the provided error, dt seconds after the previous update.
+	 */
+	double Update( double error, double dt );
+
+	/**
+	 * Returns true if the error of the last update was inside the dead band.
+	 */
+	bool IsOnTarget() const;
+
+protected:
+	int												m_mode;
+
+	double											m_kp;
+	double											m_ki;
+	double											m_kd;
+
+	double											m_bang_bang_speed;
+	double											m_max_velocity;
+	double											m_max_acceleration;
+	double											m_dead_band;
+
+	double											m_integral;
+	double											m_last_error;
+	double											m_last_velocity;
+	bool											m_has_last_error;
+	bool											m_on_target;
+};
+
+#endif /* AXISCONTROLLER_H_ */
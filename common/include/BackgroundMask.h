@@ -0,0 +1,112 @@
+/*
+ * BackgroundMask.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BACKGROUNDMASK_H_
+#define BACKGROUNDMASK_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <vector>
+
+#include "ImageSmoother.h"
+
+/**
+ * This class holds the preprocessed (gray, smoothed and thresholded) version of the background
+ * image that is subtracted from every incoming frame during visual servoing.
+ *
+ * Building the mask is as expensive as preprocessing a camera frame, but its inputs only change
+ * when a new background is loaded, when the binary threshold is reconfigured or when the camera
+ * resolution changes. The mask is therefore cached and only rebuilt when one of those inputs
+ * differs from the ones it was last built with.
+ *
+ * Detection can run at a reduced resolution and refine the result at full resolution, so a mask
+ * is kept for every frame size (and smoothing back-end and kernel) that is requested. The mask is
+ * smoothed in the same way as the frames it is subtracted from.
+ */
+class BackgroundMask
+{
+public:
+	/**
+	 * Creates an empty cache. No mask is available until a background image has been set.
+	 */
+	BackgroundMask();
+
+	/**
+	 * Releases the cached masks. The background image itself is owned by the caller.
+	 */
+	virtual ~BackgroundMask();
+
+	/**
+	 * Sets the background image that the mask is built from. The image is not copied so it must
+	 * stay valid for as long as this object uses it.
+	 */
+	void SetBackground( IplImage* background_image );
+
+	/**
+	 * Sets the binary threshold that is used when the mask is built. If use_otsu is set the
+	 * threshold is ignored and Otsu's threshold of the background is used instead.
+	 */
+	void SetThreshold( double threshold, bool use_otsu = true );
+
+	/**
+	 * Returns the background mask for a frame of the provided size, smoothed with the provided
+	 * ImageSmoother back-end and kernel size. The mask is rebuilt only if the background or the
+	 * threshold has changed since it was last built. Returns NULL if no background image is
+	 * available.
+	 */
+	IplImage* GetMask( CvSize frame_size, int smoothing_size = 11, int smoothing_method = ImageSmoother::GAUSSIAN );
+
+	/**
+	 * Returns true if the next call to GetMask() with the same arguments will rebuild the mask.
+	 */
+	bool IsStale( CvSize frame_size, int smoothing_size = 11, int smoothing_method = ImageSmoother::GAUSSIAN ) const;
+
+private:
+	/**
+	 * A mask that has been built for one frame size and smoothing kernel.
+	 */
+	struct CachedMask
+	{
+		IplImage*									mask;
+		int											smoothing_size;
+		int											smoothing_method;
+		double										threshold;
+		bool										use_otsu;
+		unsigned int								generation;
+	};
+
+	/**
+	 * Returns the index of the cached mask for the provided size and kernel or -1 if there is none.
+	 */
+	int Find( CvSize frame_size, int smoothing_size, int smoothing_method ) const;
+
+	/**
+	 * Rebuilds the provided mask from the current background image and threshold.
+	 */
+	void Rebuild( CachedMask& cached );
+
+protected:
+	IplImage*										m_background_image;
+	std::vector<CachedMask>							m_masks;
+	ImageSmoother									m_smoother;
+
+	double											m_threshold;
+	bool											m_use_otsu;
+
+	/*
+	 * Incremented every time a background is set so that reloading an image at the same address
+	 * still invalidates the masks.
+	 */
+	unsigned int									m_background_generation;
+
+	/*
+	 * The oldest mask is dropped once this many sizes are cached.
+	 */
+	const static unsigned int						m_max_cached_masks = 4;
+};
+
+#endif /* BACKGROUNDMASK_H_ */
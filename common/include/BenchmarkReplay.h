@@ -0,0 +1,65 @@
+/*
+ * BenchmarkReplay.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BENCHMARKREPLAY_H_
+#define BENCHMARKREPLAY_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * This class contains what the benchmark programs share to replay recorded or made up frames: how
+ * many frames are replayed and how many of them warm the pipeline up, loading the frames of a
+ * folder and summing up the frame latencies.
+ */
+class BenchmarkReplay
+{
+public:
+	/**
+	 * The number of frames that are made when no input is given and the most that are read from
+	 * a folder or a video file.
+	 */
+	static const int FIXTURE_FRAMES = 300;
+	static const int MAX_FRAMES = 1000;
+
+	/**
+	 * The first frames allocate the buffers and fill the caches of the pipeline, they are not
+	 * counted.
+	 */
+	static const int WARM_UP_FRAMES = 5;
+
+	/**
+	 * Loads every image in the provided folder, in the order of their names, with the provided
+	 * cvLoadImage() flags. No more than MAX_FRAMES frames are kept.
+	 */
+	static void LoadFolder( const std::string& folder, int flags, std::vector<IplImage*>& frames );
+
+	/**
+	 * Releases the provided frames and empties the vector.
+	 */
+	static void ReleaseFrames( std::vector<IplImage*>& frames );
+
+	/**
+	 * Returns the time since the provided cvGetTickCount() value, in milliseconds.
+	 */
+	static double MillisecondsSince( int64 start );
+
+	/**
+	 * Returns the value below which the provided fraction of the (sorted) values lies.
+	 */
+	static double Percentile( const std::vector<double>& sorted, double fraction );
+
+	/**
+	 * Sorts the provided frame latencies (in milliseconds) and prints their median (p50), their
+	 * 99th percentile (p99) and the frames per second.
+	 */
+	static void PrintLatencies( std::vector<double>& latencies );
+};
+
+#endif /* BENCHMARKREPLAY_H_ */
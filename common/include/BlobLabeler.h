@@ -0,0 +1,188 @@
+/*
+ * BlobLabeler.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BLOBLABELER_H_
+#define BLOBLABELER_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <vector>
+
+/**
+ * The features of all blobs found in one mask. Every feature is kept in its own array (structure
+ * of arrays) so that scanning a single feature over all blobs, which is what target selection does,
+ * only touches the memory that it needs. Index i refers to the same blob in every array.
+ *
+ * All coordinates are in pixels of the full image, even if the labeled mask had a region of
+ * interest set.
+ */
+class BlobTable
+{
+public:
+	/**
+	 * The number of blobs in the table.
+	 */
+	unsigned int Size() const
+	{
+		return area.size();
+	}
+
+	/**
+	 * Removes all blobs but keeps the allocated memory so that the table can be refilled without
+	 * allocating.
+	 */
+	void Clear();
+
+	/**
+	 * Adds an empty entry to every array and returns its index.
+	 */
+	unsigned int Append();
+
+	/**
+	 * The centre of the bounding box of blob i, which is what the tracker follows.
+	 */
+	double BoxCenterX( unsigned int i ) const
+	{
+		return ( min_x[i] + max_x[i] ) / 2.0;
+	}
+
+	double BoxCenterY( unsigned int i ) const
+	{
+		return ( min_y[i] + max_y[i] ) / 2.0;
+	}
+
+	/**
+	 * The orientation of the major axis of blob i in degrees within [0, 180), computed from the
+	 * second-order central moments.
+	 */
+	double Orientation( unsigned int i ) const;
+
+	/**
+	 * Returns the index of the blob with the largest perimeter or -1 if the table is empty.
+	 */
+	int LargestPerimeter() const;
+
+	/**
+	 * Returns the index of the blob with the largest area or -1 if the table is empty.
+	 */
+	int LargestArea() const;
+
+	/**
+	 * Converts all blobs from the coordinates of an image that was downscaled by the provided
+	 * integer factor back to the coordinates of the full image.
+	 */
+	void Scale( int scale );
+
+	/**
+	 * Overwrites blob i with blob j of the provided table.
+	 */
+	void Set( unsigned int i, const BlobTable& other, unsigned int j );
+
+	std::vector<int>								area;
+	std::vector<int>								perimeter;
+	std::vector<int>								min_x;
+	std::vector<int>								max_x;
+	std::vector<int>								min_y;
+	std::vector<int>								max_y;
+
+	std::vector<double>								centroid_x;
+	std::vector<double>								centroid_y;
+
+	/*
+	 * Second-order central moments normalised by the area.
+	 */
+	std::vector<double>								mu20;
+	std::vector<double>								mu02;
+	std::vector<double>								mu11;
+};
+
+/**
+ * This class finds the 8-connected components of a binary mask (every non-zero pixel is part of a
+ * blob) and computes their area, bounding box, perimeter, centroid and second-order moments.
+ *
+ * The mask is read exactly once. Foreground pixels are grouped into horizontal runs, every run is
+ * given a provisional label from the runs touching it in the previous row and touching labels are
+ * joined in a union-find forest. The blob features are accumulated per provisional label while
+ * scanning and merged into their root labels at the end, so no label image has to be written or
+ * read back. Only blobs whose area is within the configured limits end up in the table.
+ */
+class BlobLabeler
+{
+public:
+	/**
+	 * Creates a labeler that keeps blobs of any size.
+	 */
+	BlobLabeler();
+
+	virtual ~BlobLabeler();
+
+	/**
+	 * Blobs with an area outside of [min_area, max_area] pixels are dropped while labeling.
+	 */
+	void SetAreaLimits( int min_area, int max_area );
+
+	/**
+	 * Labels the provided 8 bit, single channel mask and fills the table with the blobs that
+	 * passed the area limits. If the mask has a region of interest set only that region is
+	 * labeled. Returns the number of blobs in the table.
+	 */
+	unsigned int Label( const IplImage* mask, BlobTable& blobs );
+
+private:
+	/**
+	 * Creates a new provisional label with empty features and returns it.
+	 */
+	int NewLabel();
+
+	/**
+	 * Returns the root of the provided label, halving the path on the way.
+	 */
+	int Find( int label );
+
+	/**
+	 * Joins the trees of the two labels. The larger root is always attached to the smaller one.
+	 */
+	void Union( int a, int b );
+
+	/**
+	 * Adds the features of the run [x0, x1] on row y to the provided label.
+	 */
+	void AddRun( int label, int x0, int x1, int y );
+
+	/**
+	 * Adds the accumulated features of label 'from' to label 'to'.
+	 */
+	void Merge( int from, int to );
+
+protected:
+	int												m_min_area;
+	int												m_max_area;
+
+	/*
+	 * Provisional labels of the previous and the current row.
+	 */
+	std::vector<int>								m_previous_row;
+	std::vector<int>								m_current_row;
+
+	/*
+	 * Union-find forest and per label accumulators, all indexed by the provisional label.
+	 */
+	std::vector<int>								m_parent;
+	std::vector<int>								m_area;
+	std::vector<int>								m_perimeter;
+	std::vector<int>								m_min_x;
+	std::vector<int>								m_max_x;
+	std::vector<int>								m_min_y;
+	std::vector<int>								m_max_y;
+	std::vector<double>								m_sum_x;
+	std::vector<double>								m_sum_y;
+	std::vector<double>								m_sum_xx;
+	std::vector<double>								m_sum_yy;
+	std::vector<double>								m_sum_xy;
+};
+
+#endif /* BLOBLABELER_H_ */
@@ -0,0 +1,175 @@
+/*
+ * DebugRenderer.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef DEBUGRENDERER_H_
+#define DEBUGRENDERER_H_
+
+// ROS Includes
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+// BOOST
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <string>
+#include <vector>
+
+#include "ImageFrame.h"
+
+/**
+ * What is drawn on top of the blob mask in the debug display, in full resolution image coordinates.
+ */
+struct DebugOverlay
+{
+	double											x_offset;
+	double											y_offset;
+	double											rot_offset;
+
+	/*
+	 * The processed window, the crosshair (the point the target is centred on) and the target.
+	 */
+	CvRect											window;
+	CvPoint											center;
+	bool											has_target;
+	int												target_id;
+	CvRect											target_box;
+	CvPoint											tracked;
+
+	/*
+	 * Conveyer belt mode: where the target will cross the grasp line.
+	 */
+	bool											has_intercept;
+	CvPoint											intercept;
+
+	/*
+	 * The bounding boxes and IDs of all tracked objects that were seen in the frame.
+	 */
+	std::vector<CvRect>								object_boxes;
+	std::vector<int>								object_ids;
+};
+
+/**
+ * This class draws the debug display (Heads Up Display) of the visual servoing on a thread of its
+ * own and publishes it as an image, so that debugging adds next to nothing to the time a frame
+ * takes.
+ *
+ * The detection only asks IsSnapshotDue() every frame, which is true at the configured rate while
+ * someone is subscribed to the display and the previous snapshot has been drawn. Only then it
+ * hands over a copy of the frame, the blob mask and the overlay. Converting the frame to colour,
+ * drawing and composing the display is all done by the background thread.
+ */
+class DebugRenderer : private boost::noncopyable
+{
+public:
+	DebugRenderer( ros::NodeHandle& node_handler );
+
+	/**
+	 * Stops the background thread.
+	 */
+	virtual ~DebugRenderer();
+
+	/**
+	 * Starts publishing the display on the provided topic. Does nothing if it is already running.
+	 */
+	void Start( const std::string& topic );
+
+	/**
+	 * Stops publishing the display.
+	 */
+	void Stop();
+
+	bool IsRunning() const;
+
+	/**
+	 * Sets how often (in Hz) the display is refreshed.
+	 */
+	void SetRate( double rate );
+
+	/**
+	 * Sets the background image that is shown next to the frame, which must be done before Start().
+	 * The image is copied.
+	 */
+	void SetBackground( const IplImage* background );
+
+	/**
+	 * Returns true if the detection should hand over a snapshot of the current frame.
+	 */
+	bool IsSnapshotDue();
+
+	/**
+	 * Copies the provided frame, mask and overlay and wakes the background thread up to draw them.
+	 */
+	void TakeSnapshot( const ImageFrame& frame, const IplImage* mask, const DebugOverlay& overlay );
+
+private:
+	/**
+	 * The loop of the background thread.
+	 */
+	void Run();
+
+	/**
+	 * Draws the last snapshot and publishes it.
+	 */
+	void Render();
+
+	/**
+	 * Draws the overlay on the provided image, which has the size of the frame.
+	 */
+	void DrawOverlay( IplImage* image, const DebugOverlay& overlay );
+
+	/**
+	 * This function takes in an arbitrary number of images and arranges them into a single
+	 * display image, which is returned. This is a modified version of the source code found here:
+	 * http://opencv.willowgarage.com/wiki/DisplayManyImages
+	 */
+	IplImage* Compose( int count, IplImage** images );
+
+	/**
+	 * Returns an image of the provided size and type in the provided slot, reusing the one that is
+	 * there if it matches.
+	 */
+	static IplImage* Reserve( IplImage*& image, CvSize size, int channels );
+
+protected:
+	ros::NodeHandle&								m_node_handler;
+	ros::Publisher									m_publisher;
+
+	boost::thread									m_thread;
+	bool											m_running;
+
+	/*
+	 * Guards the flags below. The snapshot itself is written by the detection while m_pending is
+	 * false and read by the background thread while it is true, so it needs no lock.
+	 */
+	mutable boost::mutex							m_mutex;
+	boost::condition_variable						m_condition;
+	bool											m_pending;
+	double											m_period;
+	ros::WallTime									m_last_snapshot;
+
+	std::vector<unsigned char>						m_frame_buffer;
+	ImageFrame										m_frame;
+	IplImage*										m_mask;
+	DebugOverlay									m_overlay;
+	IplImage*										m_background;
+
+	/*
+	 * Only used by the background thread.
+	 */
+	IplImage*										m_bgr;
+	IplImage*										m_mask_bgr;
+	IplImage*										m_blob_image;
+	IplImage*										m_display;
+	sensor_msgs::Image								m_message;
+};
+
+#endif /* DEBUGRENDERER_H_ */
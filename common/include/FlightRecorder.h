@@ -0,0 +1,156 @@
+/*
+ * FlightRecorder.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FLIGHTRECORDER_H_
+#define FLIGHTRECORDER_H_
+
+// BOOST
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * What happened in one control cycle of the visual servoing. The record has a fixed size and is
+ * written to disk as it is, so fields may only be added at the end (and the version raised).
+ */
+struct FlightRecord
+{
+	/*
+	 * The visual servoing session and the number of the record in the recorder.
+	 */
+	uint32_t										session;
+	uint32_t										frame;
+
+	/*
+	 * The stamp of the camera image in seconds, and the times (in nanoseconds on the monotonic
+	 * clock, see LatencyMonitor) at which the image was taken, the target was detected and the
+	 * control cycle ended. They are zero if the latency instrumentation is compiled out.
+	 */
+	double											stamp;
+	int64_t											image_time;
+	int64_t											detected_time;
+	int64_t											control_time;
+
+	/*
+	 * The result of the control cycle (same codes as VisualServoing2D::VisualServoing()), the
+	 * target and the number of blobs that were found.
+	 */
+	int32_t											status;
+	int32_t											target_id;
+	uint16_t										blob_count;
+	uint16_t										flags;
+
+	/*
+	 * The centroid of the target and its offsets, in pixels and degrees.
+	 */
+	float											tracked_x;
+	float											tracked_y;
+	float											x_offset;
+	float											y_offset;
+	float											rot_offset;
+
+	/*
+	 * The commanded base velocities (m/s) and gripper rotation (rad/s).
+	 */
+	float											base_x;
+	float											base_y;
+	float											arm_rotation;
+	uint32_t										reserved;
+};
+
+/**
+ * This class keeps the last few thousand FlightRecords of the visual servoing in memory, so that
+ * the frames leading up to a failed run can be looked at afterwards without having to log them as
+ * text while the robot is moving.
+ *
+ * The records are kept in a ring buffer of fixed size that is allocated once. Recording is done by
+ * a single thread (the control stage) and takes no lock: the record is copied into its slot and
+ * only then the write position is advanced. Read() may be called from any other thread, it copies
+ * the buffer and drops the records that may have been overwritten while it was copying.
+ *
+ * Dump() writes the records to a file (a FlightRecorderHeader followed by the records), which the
+ * flight_recorder_decode tool turns into CSV.
+ */
+class FlightRecorder : private boost::noncopyable
+{
+public:
+	/**
+	 * The flags of a FlightRecord.
+	 */
+	enum Flag
+	{
+		FOUND = 1,			// the target was seen in the frame
+		TOO_CLOSE = 2,		// the safety node reported an obstacle, the base may not move forwards
+		DONE_X = 4,			// the base adjustments in x and y and the arm rotation were finished
+		DONE_Y = 8,
+		DONE_ROTATION = 16,
+		BASE_SENT = 32,		// a base and an arm command were sent in this control cycle
+		ARM_SENT = 64
+	};
+
+	/**
+	 * Sets up the recorder for the provided number of records, rounded up to a power of two.
+	 */
+	FlightRecorder( unsigned int capacity = 4096 );
+
+	virtual ~FlightRecorder();
+
+	/**
+	 * Starts a new session, which the following records are marked with.
+	 */
+	void BeginSession();
+
+	/**
+	 * Adds the provided record, overwriting the oldest one if the recorder is full. The session and
+	 * the frame number are filled in. Must only be called from one thread at a time.
+	 */
+	void Record( const FlightRecord& record );
+
+	/**
+	 * Copies the records that are in the recorder, oldest first, into the provided vector.
+	 */
+	void Read( std::vector<FlightRecord>& records ) const;
+
+	/**
+	 * Writes the records that are in the recorder to the provided file. Returns false if the file
+	 * could not be written.
+	 */
+	bool Dump( const std::string& path ) const;
+
+	/**
+	 * Reads the records of a file written by Dump(). Returns false if the file could not be read, was
+	 * not written by this version of the recorder or holds fewer records than its header claims.
+	 */
+	static bool Load( const std::string& path, std::vector<FlightRecord>& records );
+
+	static const char* GetFlagName( Flag flag );
+
+protected:
+	std::vector<FlightRecord>						m_records;
+	uint32_t										m_mask;
+	uint32_t										m_session;
+
+	/*
+	 * The number of records that have been written so far, the next one goes to the slot
+	 * m_written & m_mask.
+	 */
+	volatile uint32_t								m_written;
+};
+
+/**
+ * The start of a file written by FlightRecorder::Dump().
+ */
+struct FlightRecorderHeader
+{
+	char											magic[4];
+	uint32_t										version;
+	uint32_t										record_size;
+	uint32_t										count;
+};
+
+#endif /* FLIGHTRECORDER_H_ */
@@ -0,0 +1,108 @@
+/*
+ * ForegroundKernels.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FOREGROUNDKERNELS_H_
+#define FOREGROUNDKERNELS_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+/**
+ * This class contains the per pixel kernels that turn a camera frame into the foreground mask used
+ * for blob detection. Instead of running the gray conversion, the thresholding and the background
+ * subtraction as separate passes over the image, each with its own intermediate image, the kernels
+ * fuse as many of these steps as possible into a single pass.
+ *
+ * Every kernel has a scalar, an SSE (SSSE3) and an AVX2 implementation. The fastest one supported
+ * by the CPU is picked at run time, and all of them produce exactly the same output. The gray
+ * conversion uses the same fixed point weights as cvCvtColor( CV_BGR2GRAY ), the thresholding
+ * matches cvThreshold( CV_THRESH_BINARY_INV ) with a max value of 255 and the background removal
+ * matches cvSub(), so the kernels are drop-in replacements for those calls.
+ *
+ * All kernels work on the region of interest of their images, which must all be of the same size.
+ */
+class ForegroundKernels
+{
+public:
+	enum InstructionSet
+	{
+		SCALAR = 0,
+		SSE = 1,
+		AVX2 = 2
+	};
+
+	/**
+	 * Returns the instruction set that the kernels currently use.
+	 */
+	static InstructionSet GetInstructionSet();
+
+	/**
+	 * Forces the kernels to use the provided instruction set, for example to compare the
+	 * implementations. Instruction sets that the CPU does not support fall back to the best one it
+	 * does support. Returns the instruction set that is used from now on.
+	 */
+	static InstructionSet SetInstructionSet( InstructionSet instruction_set );
+
+	/**
+	 * Returns a printable name for the provided instruction set.
+	 */
+	static const char* GetName( InstructionSet instruction_set );
+
+	/**
+	 * Converts a 3 channel BGR image to gray.
+	 */
+	static void ConvertToGray( const IplImage* bgr, IplImage* gray );
+
+	/**
+	 * Copies the luma of a packed 4:2:2 image (2 channels, 8 bits each) into a gray image. The luma
+	 * is the first byte of every pixel for YUYV (offset 0) and the second one for UYVY (offset 1).
+	 */
+	static void ExtractLuma( const IplImage* packed, int offset, IplImage* gray );
+
+	/**
+	 * Counts the gray values of a single channel image into the provided 256 bin histogram, which is
+	 * cleared first.
+	 */
+	static void Histogram( const IplImage* gray, unsigned int* histogram );
+
+	/**
+	 * Returns the threshold that Otsu's method picks for the provided 256 bin histogram. This is the
+	 * same value that cvThreshold() computes with CV_THRESH_OTSU.
+	 */
+	static int OtsuThreshold( const unsigned int* histogram );
+
+	/**
+	 * Marks every pixel of the gray image that is not brighter than the threshold with 255 and then
+	 * removes the background mask (if one is provided) from the result. The mask may be the gray
+	 * image itself.
+	 */
+	static void ThresholdSubtract( const IplImage* gray, const IplImage* background, int threshold, IplImage* mask );
+
+	/**
+	 * The value of a pixel in an adaptive background model (16 bit, see AdaptiveBackground) that is
+	 * dark in every frame. Pixels from half of it up count as background.
+	 */
+	const static int ADAPTIVE_DARK = 255 << 7;
+
+	/**
+	 * Like ThresholdSubtract(), but the background is taken from the adaptive model: pixels whose
+	 * model is at least half of ADAPTIVE_DARK are removed. If update is set, the model of every pixel
+	 * outside the frozen rectangle (in coordinates of the whole model image) then moves towards the
+	 * thresholded pixel by 1 / 2^shift of the difference. The mask may be the gray image itself.
+	 */
+	static void AdaptiveSubtract( const IplImage* gray, IplImage* model, int threshold, int shift,
+								  bool update, CvRect frozen, IplImage* mask );
+
+	/**
+	 * Does all of the above in one pass: converts the BGR image to gray, counts the gray values into
+	 * the histogram (if one is provided), thresholds them and removes the background (if one is
+	 * provided). The gray image itself is never written.
+	 */
+	static void ForegroundMask( const IplImage* bgr, const IplImage* background, int threshold,
+								IplImage* mask, unsigned int* histogram );
+};
+
+#endif /* FOREGROUNDKERNELS_H_ */
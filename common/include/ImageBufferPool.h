@@ -0,0 +1,130 @@
+/*
+ * ImageBufferPool.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef IMAGEBUFFERPOOL_H_
+#define IMAGEBUFFERPOOL_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+// BOOST
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
+
+/**
+ * This class owns the scratch images that are used by the stages of the visual servoing pipeline.
+ *
+ * Images are handed out by size and format and returned to the pool when a stage is done with
+ * them. A new image is only created when no free image of the requested size and format is
+ * available, so once every stage has run at least once a servo session does not allocate any
+ * image memory at all. Every user of the pool can count the allocations made on its behalf so that
+ * this can be checked while the robot is running.
+ *
+ * Setting and removing the region of interest of an image with cvSetImageROI() and
+ * cvResetImageROI() allocates and frees a small header every time. Pooled images keep their header,
+ * and SetRegion() and ResetRegion() only change its fields.
+ *
+ * A pool may be shared by several camera streams that are processed on different threads. Handing
+ * out and returning images is locked, the images themselves are only ever used by one thread at a
+ * time.
+ */
+class ImageBufferPool : private boost::noncopyable
+{
+public:
+	/**
+	 * Creates an empty pool. Images are allocated lazily the first time they are requested.
+	 */
+	ImageBufferPool();
+
+	/**
+	 * Releases every image that the pool has ever allocated. All images handed out by the pool
+	 * must have been returned before the pool is destroyed.
+	 */
+	virtual ~ImageBufferPool();
+
+	/**
+	 * Hands out an image of the requested size and format. Its region of interest covers the whole
+	 * image. A newly allocated image is zeroed, a reused one still holds whatever it was last used
+	 * for. If a counter is provided it is incremented whenever a new image has to be allocated.
+	 */
+	IplImage* Acquire( CvSize size, int depth, int channels, unsigned int* allocations = NULL );
+
+	/**
+	 * Returns an image that was handed out by Acquire() back to the pool.
+	 */
+	void Release( IplImage* image );
+
+	/**
+	 * The total number of images that the pool has allocated.
+	 */
+	unsigned int GetTotalAllocations() const;
+
+	/**
+	 * Sets the region of interest of the image, clipped to the image like cvSetImageROI() does. If
+	 * the image already has a region of interest its header is reused.
+	 */
+	static void SetRegion( IplImage* image, CvRect rect );
+
+	/**
+	 * Makes the region of interest cover the whole image again, keeping its header.
+	 */
+	static void ResetRegion( IplImage* image );
+
+protected:
+	std::vector<IplImage*>							m_images;
+	std::vector<IplImage*>							m_free_images;
+	mutable boost::mutex							m_mutex;
+};
+
+/**
+ * A scoped image that is taken from an ImageBufferPool and automatically given back to it when it
+ * goes out of scope.
+ */
+class PooledImage : private boost::noncopyable
+{
+public:
+	PooledImage( ImageBufferPool& pool, CvSize size, int depth, int channels, unsigned int* allocations = NULL ) :
+		m_pool( pool ),
+		m_image( pool.Acquire( size, depth, channels, allocations ) )
+	{
+	}
+
+	~PooledImage()
+	{
+		m_pool.Release( m_image );
+	}
+
+	IplImage* Get() const
+	{
+		return m_image;
+	}
+
+	operator IplImage*() const
+	{
+		return m_image;
+	}
+
+	IplImage* operator->() const
+	{
+		return m_image;
+	}
+
+	/**
+	 * Returns a cv::Mat header that shares the pooled image data.
+	 */
+	cv::Mat Mat() const
+	{
+		return cv::Mat( m_image, false );
+	}
+
+private:
+	ImageBufferPool&								m_pool;
+	IplImage*										m_image;
+};
+
+#endif /* IMAGEBUFFERPOOL_H_ */
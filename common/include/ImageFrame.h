@@ -0,0 +1,124 @@
+/*
+ * ImageFrame.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef IMAGEFRAME_H_
+#define IMAGEFRAME_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * This class wraps a camera image in the encoding it arrived in, without copying or converting it.
+ * The detection only needs the gray (luma) values of the pixels, which are pulled straight out of
+ * the wrapped buffer for the window that is processed:
+ *
+ * MONO8      - The image already is gray and is copied as is.
+ * YUYV, UYVY - The luma bytes are picked out of the packed 4:2:2 pixels.
+ * BGR8, RGB8 - The colour pixels are converted to gray.
+ *
+ * A colour version of the image is only made on request (for the debug display).
+ *
+ * The wrapped buffer is not owned by the frame and must stay valid for as long as the frame uses
+ * it. It is never written to.
+ */
+class ImageFrame
+{
+public:
+	enum Encoding
+	{
+		UNSUPPORTED = 0,
+		BGR8,
+		RGB8,
+		MONO8,
+		YUYV,
+		UYVY
+	};
+
+	/**
+	 * Creates an empty frame.
+	 */
+	ImageFrame();
+
+	virtual ~ImageFrame();
+
+	/**
+	 * Returns the encoding for the provided ROS encoding name or UNSUPPORTED. Note that "yuv422" is
+	 * UYVY in ROS, YUYV is called "yuv422_yuy2" (or "yuyv").
+	 */
+	static Encoding ParseEncoding( const std::string& encoding );
+
+	/**
+	 * Wraps the provided pixel buffer. Returns false if the encoding is not supported, in which case
+	 * the frame is empty.
+	 */
+	bool Wrap( const unsigned char* data, int width, int height, int step, Encoding encoding );
+
+	/**
+	 * Wraps an OpenCV image, which must be BGR (3 channels) or gray (1 channel).
+	 */
+	bool Wrap( const IplImage* image );
+
+	/**
+	 * Returns true if an image has been wrapped.
+	 */
+	bool IsValid() const;
+
+	Encoding GetEncoding() const;
+
+	CvSize GetSize() const;
+
+	/**
+	 * Sets the time (in seconds) at which the image was taken. Zero, the default, means unknown.
+	 */
+	void SetStamp( double stamp );
+	double GetStamp() const;
+
+	/**
+	 * Writes the gray values of the window given by the region of interest of the gray image, which
+	 * must be of the frame size, into that window.
+	 */
+	void ExtractGray( IplImage* gray ) const;
+
+	/**
+	 * Turns the window given by the region of interest of the mask, which must be of the frame
+	 * size, straight into the foreground mask (see ForegroundKernels::ForegroundMask()) and counts
+	 * its gray values into the histogram if one is provided. This is only done for BGR8 frames,
+	 * false is returned for the other encodings and nothing is written.
+	 */
+	bool ExtractForeground( const IplImage* background, int threshold, IplImage* mask, unsigned int* histogram ) const;
+
+	/**
+	 * Converts the whole frame to BGR. The image must be of the frame size with 3 channels.
+	 */
+	void ConvertToBgr( IplImage* bgr ) const;
+
+	/**
+	 * Copies the wrapped pixels into the provided buffer and wraps the copy in the provided frame,
+	 * which then stays valid after the original buffer is gone. The buffer is reused if it is
+	 * large enough.
+	 */
+	void CopyTo( std::vector<unsigned char>& buffer, ImageFrame& copy ) const;
+
+private:
+	/**
+	 * Returns a header around the provided window of the wrapped buffer.
+	 */
+	IplImage Window( CvRect window ) const;
+
+protected:
+	Encoding										m_encoding;
+	double											m_stamp;
+
+	/*
+	 * Header around the whole wrapped buffer.
+	 */
+	IplImage										m_image;
+};
+
+#endif /* IMAGEFRAME_H_ */
@@ -0,0 +1,100 @@
+/*
+ * ImageSmoother.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef IMAGESMOOTHER_H_
+#define IMAGESMOOTHER_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <vector>
+
+/**
+ * This class smooths 8 bit, single channel images before they are thresholded. The 11x11 Gaussian
+ * that the detection used to run is the most expensive step per frame, so several back-ends with
+ * a different trade-off between speed and accuracy are available:
+ *
+ * GAUSSIAN  - The exact Gaussian of cvSmooth(), which OpenCV runs as two separable 1D passes. This
+ *             is the reference that the other back-ends are compared against.
+ * RECURSIVE - A third order recursive (IIR) approximation of the Gaussian (Young and van Vliet).
+ *             Its cost per pixel does not depend on the kernel size.
+ * BOX       - Three box filters in a row, computed with running sums, which approximate the same
+ *             Gaussian. Its cost per pixel does not depend on the kernel size either.
+ * NONE      - No smoothing at all.
+ *
+ * The kernel size has the same meaning for every back-end: the Gaussian that cvSmooth() would use
+ * for that size (sigma = 0.3 * ( ( size - 1 ) * 0.5 - 1 ) + 0.8) is approximated.
+ *
+ * Images are smoothed in place and only inside their region of interest. The working buffers are
+ * kept between calls so that no memory is allocated once the image size settles.
+ */
+class ImageSmoother
+{
+public:
+	enum Method
+	{
+		NONE = 0,
+		GAUSSIAN = 1,
+		RECURSIVE = 2,
+		BOX = 3
+	};
+
+	/**
+	 * Creates a smoother that uses the 11x11 Gaussian.
+	 */
+	ImageSmoother();
+
+	virtual ~ImageSmoother();
+
+	/**
+	 * Selects the back-end. Unknown values fall back to GAUSSIAN.
+	 */
+	void SetMethod( int method );
+
+	Method GetMethod() const;
+
+	/**
+	 * Sets the kernel size, which is made odd if it is not. A size of one or less disables the
+	 * smoothing.
+	 */
+	void SetSize( int size );
+
+	int GetSize() const;
+
+	/**
+	 * Returns a printable name for the provided back-end.
+	 */
+	static const char* GetName( Method method );
+
+	/**
+	 * Smooths the region of interest of the provided 8 bit, single channel image in place.
+	 */
+	void Smooth( IplImage* image );
+
+private:
+	/**
+	 * The standard deviation of the Gaussian that cvSmooth() uses for the current kernel size.
+	 */
+	double Sigma() const;
+
+	void SmoothRecursive( IplImage* image );
+
+	void SmoothBox( IplImage* image );
+
+protected:
+	Method											m_method;
+	int												m_size;
+
+	/*
+	 * Working buffers of the recursive and box back-ends.
+	 */
+	std::vector<float>								m_float_buffer;
+	std::vector<unsigned char>						m_first_buffer;
+	std::vector<unsigned char>						m_second_buffer;
+	std::vector<int>								m_column_sums;
+};
+
+#endif /* IMAGESMOOTHER_H_ */
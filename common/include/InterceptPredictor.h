@@ -0,0 +1,70 @@
+/*
+ * InterceptPredictor.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef INTERCEPTPREDICTOR_H_
+#define INTERCEPTPREDICTOR_H_
+
+/**
+ * This class predicts where and when an object on a conveyer belt will cross the grasp line, so
+ * the robot can wait for the object there instead of chasing its current position.
+ *
+ * The velocity of the belt (in pixels per second) is learnt from the velocities of the tracked
+ * objects and smoothed over time. As every object on the belt moves the same way it is kept from
+ * one object to the next. The grasp line runs through the grasp point (where the visual servoing
+ * centres the object) across the belt, i.e. perpendicular to the belt velocity.
+ */
+class InterceptPredictor
+{
+public:
+	InterceptPredictor();
+
+	virtual ~InterceptPredictor();
+
+	/**
+	 * Sets the speed (in pixels per second) below which the belt is taken to be standing still, the
+	 * weight of a new velocity in the smoothed belt velocity and how far ahead (in seconds) crossings
+	 * are predicted.
+	 */
+	void SetParameters( double min_speed, double alpha, double horizon );
+
+	/**
+	 * Forgets the belt velocity.
+	 */
+	void Reset();
+
+	/**
+	 * Adds the velocity of a tracked object to the belt velocity.
+	 */
+	void AddVelocity( double velocity_x, double velocity_y );
+
+	/**
+	 * Returns true if the belt velocity is known and fast enough to predict crossings.
+	 */
+	bool IsMoving() const;
+
+	double GetVelocityX() const;
+	double GetVelocityY() const;
+
+	/**
+	 * Works out where (intercept_x, intercept_y) and in how many seconds the object at the provided
+	 * position crosses the grasp line through the provided grasp point. Returns false if the belt is
+	 * not moving, the object has already crossed the line or it will not reach it within the
+	 * horizon.
+	 */
+	bool Predict( double x, double y, double grasp_x, double grasp_y,
+				  double& intercept_x, double& intercept_y, double& time_to_intercept ) const;
+
+protected:
+	bool											m_has_velocity;
+	double											m_velocity_x;
+	double											m_velocity_y;
+
+	double											m_min_speed;
+	double											m_alpha;
+	double											m_horizon;
+};
+
+#endif /* INTERCEPTPREDICTOR_H_ */
@@ -0,0 +1,172 @@
+/*
+ * LatencyMonitor.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef LATENCYMONITOR_H_
+#define LATENCYMONITOR_H_
+
+// BOOST
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+#include <time.h>
+#include <cstring>
+
+/**
+ * The times (in nanoseconds on the monotonic clock) at which a camera frame passed the points of
+ * the pipeline. The image time is the stamp of the camera image, moved onto the monotonic clock
+ * when the image is received, so that every latency is measured from the moment the image was
+ * taken.
+ */
+struct FrameTimestamps
+{
+	int64_t											image;
+	int64_t											ingest;
+	int64_t											detected;
+};
+
+/**
+ * A summary of the latencies that were recorded for one stage, in milliseconds.
+ */
+struct LatencySummary
+{
+	unsigned int									count;
+	double											mean;
+	double											p50;
+	double											p99;
+	double											max;
+};
+
+/**
+ * This class records how long the stages of the visual servoing take and how old a frame is when
+ * it reaches each point of the pipeline.
+ *
+ * Every stage has a histogram with logarithmic buckets (four per power of two microseconds, so the
+ * percentiles are within 19% of the real value) that the pipeline threads add to with atomic
+ * increments, so recording never takes a lock and never allocates. Snapshot() switches the
+ * recording over to a second set of histograms and summarises and clears the first one, so every
+ * snapshot covers the time since the previous one.
+ *
+ * The monitor is only compiled in when VISUAL_SERVOING_INSTRUMENTATION is defined (see
+ * CMakeLists.txt). Without it Now() returns zero and Record() does nothing, so the compiler drops
+ * the instrumentation altogether.
+ */
+class LatencyMonitor : private boost::noncopyable
+{
+public:
+	enum Stage
+	{
+		INGEST = 0,		// image stamp to the camera callback
+		CONVERT,		// the blob detection stages, see DetectionTimings
+		SMOOTH,
+		THRESHOLD,
+		SUBTRACT,
+		LABEL,
+		SELECT,
+		DETECT,			// camera callback to the finished observation
+		QUEUE,			// finished observation to the start of the control stage
+		CONTROL,		// the control stage
+		BASE_COMMAND,	// image stamp to a base velocity command being published
+		ARM_COMMAND,	// image stamp to an arm velocity command being published
+		STAGE_COUNT
+	};
+
+	LatencyMonitor();
+
+	virtual ~LatencyMonitor();
+
+	/**
+	 * Returns true if the instrumentation has been compiled in.
+	 */
+	static bool IsEnabled()
+	{
+#ifdef VISUAL_SERVOING_INSTRUMENTATION
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * Returns the current time on the monotonic clock in nanoseconds.
+	 */
+	static int64_t Now()
+	{
+#ifdef VISUAL_SERVOING_INSTRUMENTATION
+		timespec now;
+		clock_gettime( CLOCK_MONOTONIC, &now );
+		return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+		return 0;
+#endif
+	}
+
+	/**
+	 * Adds a latency in nanoseconds to the histogram of the provided stage. This is safe to call
+	 * from any thread.
+	 */
+	void Record( Stage stage, int64_t nanoseconds )
+	{
+#ifdef VISUAL_SERVOING_INSTRUMENTATION
+		Histogram& histogram = m_histograms[m_active][stage];
+		uint64_t microseconds = nanoseconds > 0 ? nanoseconds / 1000 : 0;
+
+		__sync_fetch_and_add( &histogram.buckets[Bucket( microseconds )], 1 );
+		__sync_fetch_and_add( &histogram.sum, microseconds );
+
+		uint64_t max = histogram.max;
+		while( microseconds > max )
+		{
+			max = __sync_val_compare_and_swap( &histogram.max, max, microseconds );
+		}
+#endif
+	}
+
+	/**
+	 * Records the time from the provided start time until now for the provided stage and returns
+	 * the current time.
+	 */
+	int64_t RecordSince( Stage stage, int64_t start )
+	{
+		int64_t now = Now();
+		Record( stage, now - start );
+		return now;
+	}
+
+	/**
+	 * Summarises the latencies that were recorded since the last call into the provided array, which
+	 * must hold STAGE_COUNT entries, and starts over. Snapshots must not be taken from several
+	 * threads at once.
+	 */
+	void Snapshot( LatencySummary* summaries );
+
+	static const char* GetName( Stage stage );
+
+private:
+	/**
+	 * Returns the histogram bucket for the provided latency and the smallest latency that goes into
+	 * a bucket.
+	 */
+	static unsigned int Bucket( uint64_t microseconds );
+	static uint64_t BucketStart( unsigned int bucket );
+
+protected:
+	const static unsigned int						m_bucket_count = 128;
+
+	struct Histogram
+	{
+		volatile uint64_t							buckets[m_bucket_count];
+		volatile uint64_t							sum;
+		volatile uint64_t							max;
+	};
+
+	/*
+	 * Two sets of histograms, the threads record into the active one.
+	 */
+	Histogram										m_histograms[2][STAGE_COUNT];
+	volatile int									m_active;
+};
+
+#endif /* LATENCYMONITOR_H_ */
@@ -0,0 +1,165 @@
+/*
+ * LatestSlot.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef LATESTSLOT_H_
+#define LATESTSLOT_H_
+
+// BOOST
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+/**
+ * This class hands the latest value from one producer thread to one consumer thread. If the
+ * producer publishes a new value before the consumer has taken the previous one, the previous one
+ * is dropped, so the consumer always works on the freshest value and never on a backlog.
+ *
+ * The slot is a triple buffer: the producer fills its own buffer, the consumer reads from its own
+ * buffer and the third one holds the value that has been published but not yet taken. Publishing
+ * and taking a value swap a buffer with the middle one using an atomic compare-and-swap, so values
+ * are never copied and neither side ever waits on a lock to pass data. Only a consumer that wants
+ * to sleep until a value arrives uses a condition variable, which the producer signals after
+ * publishing.
+ *
+ * The buffers are reused, so a value type that owns memory (an image, for example) only has to
+ * allocate it the first time each buffer is written.
+ */
+template<class T>
+class LatestSlot : private boost::noncopyable
+{
+public:
+	LatestSlot()
+	{
+		m_write_index = 0;
+		m_shared = 1;
+		m_read_index = 2;
+	}
+
+	/**
+	 * The buffer that the producer fills before calling Publish().
+	 */
+	T& WriteBuffer()
+	{
+		return m_buffers[m_write_index];
+	}
+
+	/**
+	 * Makes the write buffer available to the consumer and hands the producer a new one to fill.
+	 * Returns true if a value that the consumer had not taken yet was dropped.
+	 */
+	bool Publish()
+	{
+		int previous = Exchange( m_write_index | m_fresh );
+		m_write_index = previous & m_index_mask;
+
+		{
+			boost::mutex::scoped_lock lock( m_wait_mutex );
+		}
+		m_wait_condition.notify_one();
+
+		return ( previous & m_fresh ) != 0;
+	}
+
+	/**
+	 * Moves the latest published value into the read buffer if one has been published since the
+	 * last call. Returns true if the read buffer now holds a new value.
+	 */
+	bool Take()
+	{
+		if( !( m_shared & m_fresh ) )
+		{
+			return false;
+		}
+
+		m_read_index = Exchange( m_read_index ) & m_index_mask;
+		return true;
+	}
+
+	/**
+	 * Returns true if a value has been published that has not been taken yet.
+	 */
+	bool HasNew() const
+	{
+		return ( m_shared & m_fresh ) != 0;
+	}
+
+	/**
+	 * Waits for up to the provided number of milliseconds for a new value and takes it. Returns
+	 * false if there still is no new value, either because of the timeout or because Wake() was
+	 * called.
+	 */
+	bool Wait( int timeout_ms )
+	{
+		if( Take() )
+		{
+			return true;
+		}
+
+		{
+			boost::mutex::scoped_lock lock( m_wait_mutex );
+			if( !( m_shared & m_fresh ) )
+			{
+				m_wait_condition.timed_wait( lock, boost::posix_time::milliseconds( timeout_ms ) );
+			}
+		}
+
+		return Take();
+	}
+
+	/**
+	 * Wakes up a consumer that is waiting in Wait(), for example to let it shut down.
+	 */
+	void Wake()
+	{
+		boost::mutex::scoped_lock lock( m_wait_mutex );
+		m_wait_condition.notify_all();
+	}
+
+	/**
+	 * The buffer that holds the value that was taken last.
+	 */
+	T& ReadBuffer()
+	{
+		return m_buffers[m_read_index];
+	}
+
+private:
+	/**
+	 * Atomically replaces the middle buffer index (and its fresh flag) and returns the old one.
+	 */
+	int Exchange( int value )
+	{
+		int previous;
+		do
+		{
+			previous = m_shared;
+		}
+		while( __sync_val_compare_and_swap( &m_shared, previous, value ) != previous );
+
+		return previous;
+	}
+
+protected:
+	T												m_buffers[3];
+
+	int												m_write_index;
+	int												m_read_index;
+
+	/*
+	 * The index of the middle buffer, with m_fresh set while it holds a value that has not been
+	 * taken yet.
+	 */
+	volatile int									m_shared;
+
+	boost::mutex									m_wait_mutex;
+	boost::condition_variable						m_wait_condition;
+
+	const static int								m_index_mask = 3;
+	const static int								m_fresh = 4;
+};
+
+#endif /* LATESTSLOT_H_ */
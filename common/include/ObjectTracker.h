@@ -0,0 +1,199 @@
+/*
+ * ObjectTracker.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef OBJECTTRACKER_H_
+#define OBJECTTRACKER_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <vector>
+
+#include "BlobLabeler.h"
+#include "TargetTracker.h"
+
+/**
+ * A blob that is followed from frame to frame. The ID stays the same for as long as the object is
+ * tracked and is never handed out again.
+ */
+struct ObjectTrack
+{
+	int												id;
+
+	/*
+	 * Position and velocity of the centre of the object's bounding box.
+	 */
+	TargetTracker									filter;
+
+	/*
+	 * Size of the bounding box when the object was last seen.
+	 */
+	int												width;
+	int												height;
+
+	/*
+	 * The blob the object was matched with in the current frame, or -1.
+	 */
+	int												blob;
+
+	/*
+	 * The time (in seconds) of the frame the object was last seen in.
+	 */
+	double											last_seen;
+};
+
+/**
+ * This class follows every blob that is found, not only the one that is servoed to, and gives each
+ * of them an ID that stays the same across frames. That way the target can be switched to another
+ * object by its ID, without starting over with the largest blob.
+ *
+ * Every track predicts its object to the time of the frame, the blobs are then matched with the
+ * tracks in the order of their Mahalanobis distance, each blob to at most one track and only within
+ * the gate of the track. To keep this cheap when there are many blobs, the blobs are put into a
+ * uniform grid and a track only looks at the cells that its gate overlaps.
+ *
+ * Blobs that are not matched start new tracks. Tracks that are not matched coast on their
+ * prediction until they are given up. Tracks whose prediction lies outside the part of the image
+ * that was processed could not have been seen, so they are neither matched nor coasted. They are
+ * kept for a limited time only, and the uncertainty of their position is capped so that their gate
+ * does not grow over the whole image.
+ */
+class ObjectTracker
+{
+public:
+	ObjectTracker();
+
+	virtual ~ObjectTracker();
+
+	/**
+	 * Sets the parameters of the Kalman filter of every track, see TargetTracker::SetParameters().
+	 */
+	void SetParameters( double acceleration_noise, double measurement_noise, double gate, int max_coast_frames );
+
+	/**
+	 * Sets the size (in pixels) of the cells of the grid that the blobs are sorted into.
+	 */
+	void SetCellSize( int cell_size );
+
+	/**
+	 * Sets the largest standard deviation (in pixels) of the predicted position of a track and for
+	 * how long (in seconds) a track that is not seen is kept.
+	 */
+	void SetLimits( double max_deviation, double max_unseen_time );
+
+	/**
+	 * Forgets all tracks.
+	 */
+	void Reset();
+
+	/**
+	 * Moves every track to where its object is expected at the provided time (in seconds).
+	 */
+	void Predict( double stamp );
+
+	/**
+	 * Matches the provided blobs, found in the provided window of a frame of the provided size, with
+	 * the tracks whose prediction lies inside of the window. Nothing is changed but the match, so
+	 * this may be repeated when the blobs are detected again.
+	 */
+	void Associate( const BlobTable& blobs, CvSize frame_size, CvRect window );
+
+	/**
+	 * Returns the blob that the track with the provided ID was matched with, or -1.
+	 */
+	int GetAssignedBlob( int id ) const;
+
+	/**
+	 * Returns true if the track with the provided ID exists and may miss another frame without
+	 * being given up.
+	 */
+	bool CanCoast( int id ) const;
+
+	/**
+	 * Applies the last match: matched tracks are corrected with their blob, unmatched tracks that
+	 * should have been seen in the processed window coast (or are given up) and unmatched blobs
+	 * start new tracks at the provided time.
+	 */
+	void Update( const BlobTable& blobs, CvRect window, double stamp );
+
+	/**
+	 * Returns the ID of the track of the provided blob after Update(), or -1.
+	 */
+	int GetBlobTrack( unsigned int blob ) const;
+
+	/**
+	 * Returns the track with the provided ID or NULL if there is none.
+	 */
+	const ObjectTrack* FindTrack( int id ) const;
+
+	/**
+	 * Returns all tracks.
+	 */
+	const std::vector<ObjectTrack>& GetTracks() const;
+
+private:
+	/**
+	 * Sorts the blobs into the grid by the centre of their bounding box.
+	 */
+	void BuildGrid( const BlobTable& blobs, CvSize frame_size );
+
+	/**
+	 * Returns true if the prediction of the track lies inside of the window.
+	 */
+	static bool IsInWindow( const ObjectTrack& track, CvRect window );
+
+	/**
+	 * Returns the index of the track with the provided ID in m_tracks, or -1.
+	 */
+	int FindIndex( int id ) const;
+
+	/**
+	 * A possible match of a track and a blob.
+	 */
+	struct Candidate
+	{
+		double										distance;
+		int											track;
+		int											blob;
+
+		bool operator<( const Candidate& other ) const
+		{
+			return distance < other.distance;
+		}
+	};
+
+protected:
+	std::vector<ObjectTrack>						m_tracks;
+	int												m_next_id;
+
+	/*
+	 * The ID of the track of every blob after Update().
+	 */
+	std::vector<int>								m_blob_tracks;
+
+	/*
+	 * The grid: the blobs of cell c are m_cell_blobs[m_cell_start[c]] up to (not including)
+	 * m_cell_blobs[m_cell_start[c + 1]].
+	 */
+	int												m_cell_size;
+	int												m_grid_width;
+	int												m_grid_height;
+	std::vector<int>								m_cell_start;
+	std::vector<int>								m_cell_blobs;
+	std::vector<int>								m_blob_cells;
+
+	std::vector<Candidate>							m_candidates;
+	std::vector<bool>								m_blob_assigned;
+
+	double											m_acceleration_noise;
+	double											m_measurement_noise;
+	double											m_gate;
+	int												m_max_coast_frames;
+	double											m_max_deviation;
+	double											m_max_unseen_time;
+};
+
+#endif /* OBJECTTRACKER_H_ */
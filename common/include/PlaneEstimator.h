@@ -0,0 +1,120 @@
+/*
+ * PlaneEstimator.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef PLANEESTIMATOR_H_
+#define PLANEESTIMATOR_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * A plane a * x + b * y + c * z + d = 0 with a unit normal (a, b, c). The normal points to the side
+ * of the plane the camera is on, so the signed distance of a point is its height above the plane.
+ */
+struct Plane
+{
+	double											a;
+	double											b;
+	double											c;
+	double											d;
+
+	double Distance( double x, double y, double z ) const
+	{
+		return a * x + b * y + c * z + d;
+	}
+};
+
+/**
+ * This class finds the support plane (the table or the floor) in a set of points with RANSAC.
+ *
+ * Planes through three random points are scored by the number of points within the inlier
+ * distance, and the best one is refined with a least squares fit to its inliers. The number of
+ * planes that are tried follows from the share of inliers found so far, so that the plane is found
+ * with 99% probability.
+ *
+ * The estimate is incremental: the plane of the last frame is scored first. As the camera moves
+ * little between frames it usually has most points as inliers already, so only a few more planes
+ * need to be tried and the search ends early.
+ */
+class PlaneEstimator
+{
+public:
+	PlaneEstimator();
+
+	virtual ~PlaneEstimator();
+
+	/**
+	 * Sets the distance (in metres) up to which a point is taken to be on the plane and the most
+	 * planes that are tried per estimate.
+	 */
+	void SetParameters( double inlier_distance, int max_iterations );
+
+	/**
+	 * Forgets the plane of the last frame.
+	 */
+	void Reset();
+
+	/**
+	 * Finds the plane in the provided points (in metres). Returns false if no plane holds at least
+	 * a fifth of the points, in which case the next estimate starts without a prior.
+	 */
+	bool Estimate( const std::vector<CvPoint3D32f>& points );
+
+	bool HasPlane() const;
+
+	const Plane& GetPlane() const;
+
+	/**
+	 * Returns the share of the points that were inliers of the last plane and the number of planes
+	 * that were tried for it.
+	 */
+	double GetInlierRatio() const;
+	int GetIterations() const;
+
+private:
+	/**
+	 * Returns the number of points within the inlier distance of the provided plane.
+	 */
+	unsigned int CountInliers( const std::vector<CvPoint3D32f>& points, const Plane& plane ) const;
+
+	/**
+	 * Sets the plane through the three provided points. Returns false if they are (nearly) on a
+	 * line.
+	 */
+	static bool PlaneThrough( const CvPoint3D32f& p0, const CvPoint3D32f& p1, const CvPoint3D32f& p2, Plane& plane );
+
+	/**
+	 * Fits the plane to the inliers of the provided plane by least squares.
+	 */
+	bool Refine( const std::vector<CvPoint3D32f>& points, Plane& plane ) const;
+
+	/**
+	 * Returns the number of planes to try for a plane with the provided share of inliers.
+	 */
+	int RequiredIterations( double inlier_ratio ) const;
+
+	/**
+	 * Returns a pseudo random number in [0, n). The sequence is the same for every run, so that
+	 * recorded frames always give the same planes.
+	 */
+	unsigned int Random( unsigned int n );
+
+protected:
+	double											m_inlier_distance;
+	int												m_max_iterations;
+
+	bool											m_has_plane;
+	Plane											m_plane;
+	double											m_inlier_ratio;
+	int												m_iterations;
+
+	uint32_t										m_random;
+};
+
+#endif /* PLANEESTIMATOR_H_ */
@@ -0,0 +1,104 @@
+/*
+ * ProximityMonitor.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef PROXIMITYMONITOR_H_
+#define PROXIMITYMONITOR_H_
+
+// ROS Includes
+#include <ros/ros.h>
+#include <hbrs_srvs/ReturnBool.h>
+
+// BOOST
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <string>
+
+/**
+ * This class keeps track of whether the robot is too close to an obstacle to move its base any
+ * further. The safety node is asked by a background thread at a fixed rate and the answer is cached
+ * together with the time it was received, so the control code only ever reads the cached value and
+ * never waits for a service call.
+ *
+ * An answer is only trusted for a limited time. If the last answer is older than that, or there is
+ * none at all because the safety node is not responding, the answer is unknown and the robot must
+ * not move towards the obstacle, but it has not been found to be too close either.
+ */
+class ProximityMonitor : private boost::noncopyable
+{
+public:
+	enum Answer
+	{
+		CLEAR = 0,
+		TOO_CLOSE = 1,
+		UNKNOWN = 2
+	};
+
+	/**
+	 * Sets up the monitor for the provided service, which is not called until Start().
+	 */
+	ProximityMonitor( ros::NodeHandle& node_handler, const std::string& service_name );
+
+	/**
+	 * Stops the background thread.
+	 */
+	virtual ~ProximityMonitor();
+
+	/**
+	 * Starts asking the safety node. Any answer from a previous run is forgotten.
+	 */
+	void Start();
+
+	/**
+	 * Stops asking the safety node.
+	 */
+	void Stop();
+
+	/**
+	 * Sets how often (in Hz) the safety node is asked and for how long (in seconds) an answer is
+	 * trusted. This is safe to call from any thread.
+	 */
+	void SetTiming( double rate, double staleness_bound );
+
+	/**
+	 * Returns the last answer of the safety node, or UNKNOWN if there is none that is recent enough.
+	 */
+	Answer GetAnswer() const;
+
+	/**
+	 * Returns true unless a recent answer says that the robot is clear of obstacles.
+	 */
+	bool IsTooClose() const;
+
+private:
+	/**
+	 * The loop of the background thread.
+	 */
+	void Run();
+
+protected:
+	ros::NodeHandle&								m_node_handler;
+	std::string										m_service_name;
+
+	boost::thread									m_thread;
+	bool											m_running;
+
+	/*
+	 * The cached answer and when it was received, both guarded by the mutex, which is only ever held
+	 * to copy them. The condition wakes the background thread up when it should stop.
+	 */
+	mutable boost::mutex							m_mutex;
+	boost::condition_variable						m_condition;
+	bool											m_too_close;
+	ros::WallTime									m_stamp;
+
+	double											m_rate;
+	double											m_staleness_bound;
+};
+
+#endif /* PROXIMITYMONITOR_H_ */
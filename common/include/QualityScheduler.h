@@ -0,0 +1,88 @@
+/*
+ * QualityScheduler.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef QUALITYSCHEDULER_H_
+#define QUALITYSCHEDULER_H_
+
+/**
+ * This class lowers the quality of the blob detection when the frames take longer to process than
+ * the latency budget allows, and raises it again once there is headroom.
+ *
+ * The processing time of every frame goes into a moving average. Once the average has been over
+ * the budget for a few frames the detection steps down one level, once it has been below the
+ * headroom fraction of the budget it steps back up. The average starts over after every switch, so
+ * it only ever covers frames of the current level.
+ *
+ * A level that turns out to be too slow right after stepping up to it is tried again only after
+ * twice as many frames each time, so the scheduler does not keep switching between two levels of
+ * which one is just too slow.
+ */
+class QualityScheduler
+{
+public:
+	/**
+	 * The quality levels, each one adds to the savings of the ones before it.
+	 */
+	enum Level
+	{
+		FULL_FRAME = 0,		// the full frame is searched, at the configured resolution
+		TRACKING_WINDOW,	// only the window around the target is searched
+		HALF_RESOLUTION,	// the blobs are detected on an image downscaled at least by two
+		NO_SMOOTHING,		// the image is not smoothed before thresholding
+		LEVEL_COUNT
+	};
+
+	QualityScheduler();
+
+	virtual ~QualityScheduler();
+
+	/**
+	 * Sets the latency budget of a frame in milliseconds, 0 turns the scheduling off, and the
+	 * fraction of the budget below which the quality is raised again.
+	 */
+	void SetBudget( double budget, double headroom );
+
+	/**
+	 * Returns true if there is a budget to schedule for.
+	 */
+	bool IsEnabled() const;
+
+	/**
+	 * Goes back to the full quality and forgets the processing times.
+	 */
+	void Reset();
+
+	/**
+	 * Adds the processing time of a frame in milliseconds. Returns true if the level was changed.
+	 */
+	bool Update( double milliseconds );
+
+	Level GetLevel() const;
+
+	/**
+	 * Returns the moving average of the processing time at the current level, in milliseconds.
+	 */
+	double GetAverage() const;
+
+	static const char* GetName( Level level );
+
+protected:
+	double											m_budget;
+	double											m_headroom;
+
+	Level											m_level;
+	double											m_average;
+	unsigned int									m_frames;
+
+	/*
+	 * The number of frames with headroom that are needed to step up, and whether the current level
+	 * was reached by stepping up and has not yet lasted that long.
+	 */
+	unsigned int									m_up_frames;
+	bool											m_probing;
+};
+
+#endif /* QUALITYSCHEDULER_H_ */
@@ -0,0 +1,144 @@
+/*
+ * TargetTracker.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef TARGETTRACKER_H_
+#define TARGETTRACKER_H_
+
+/**
+ * This class follows the centre of the tracked blob through the image with a constant velocity
+ * Kalman filter. It keeps the position and velocity of the target (in pixels and pixels per second)
+ * together with their covariance, which tells how far the target may have moved from where it is
+ * expected.
+ *
+ * Every frame the target is first predicted to the time stamp of the frame. Only blobs within the
+ * gate around the prediction, measured in Mahalanobis distance, may be taken as the target. If none
+ * is, the target coasts on its prediction for a few frames before it is given up, so a blob that is
+ * briefly hidden or misdetected is not lost right away.
+ *
+ * The motion in x and y is independent, so each axis is filtered on its own with a 2x2 covariance.
+ */
+class TargetTracker
+{
+public:
+	/**
+	 * Creates a tracker that does not follow a target yet.
+	 */
+	TargetTracker();
+
+	virtual ~TargetTracker();
+
+	/**
+	 * Sets the standard deviation of the acceleration of the target (in pixels per second squared)
+	 * and of the measured blob centre (in pixels), the gate as a squared Mahalanobis distance and
+	 * the number of frames the target may coast before it is given up.
+	 */
+	void SetParameters( double acceleration_noise, double measurement_noise, double gate, int max_coast_frames );
+
+	/**
+	 * Limits the standard deviation of the predicted position (in pixels), so that the gate of a
+	 * target that has not been seen for a while stops growing. Zero, the default, means no limit.
+	 */
+	void SetMaxDeviation( double deviation );
+
+	/**
+	 * Forgets the target.
+	 */
+	void Reset();
+
+	/**
+	 * Returns true while a target is followed, including while it coasts.
+	 */
+	bool IsTracking() const;
+
+	/**
+	 * Starts following a target at the provided position, which was seen at the provided time (in
+	 * seconds). The target is taken to be standing still.
+	 */
+	void Initialize( double x, double y, double stamp );
+
+	/**
+	 * Moves the target to where it is expected at the provided time. A time that is not later than
+	 * the last one leaves the target where it is.
+	 */
+	void Predict( double stamp );
+
+	/**
+	 * Returns the squared Mahalanobis distance between the provided position and the prediction.
+	 */
+	double Distance( double x, double y ) const;
+
+	/**
+	 * Returns true if the provided position is within the gate around the prediction.
+	 */
+	bool IsInGate( double x, double y ) const;
+
+	/**
+	 * Returns half the width and half the height of the box around the gate, so that candidates
+	 * outside of it can be skipped without working out their distance.
+	 */
+	void GetGateBox( double& half_width, double& half_height ) const;
+
+	/**
+	 * Corrects the prediction with the provided measured position of the target.
+	 */
+	void Correct( double x, double y );
+
+	/**
+	 * Records a frame in which the target was not found, the target stays on its prediction. Returns
+	 * false if the target has coasted for too long, in which case it is forgotten.
+	 */
+	bool Coast();
+
+	double GetX() const;
+	double GetY() const;
+	double GetVelocityX() const;
+	double GetVelocityY() const;
+
+	/**
+	 * Returns the number of frames in a row in which the target was not found.
+	 */
+	int GetCoastedFrames() const;
+
+	/**
+	 * Returns the number of frames in which the target was found since it was picked up.
+	 */
+	int GetCorrectedFrames() const;
+
+private:
+	/**
+	 * The state of one axis: position, velocity and their covariance.
+	 */
+	struct Axis
+	{
+		double										position;
+		double										velocity;
+		double										p_pp;
+		double										p_pv;
+		double										p_vv;
+	};
+
+	void PredictAxis( Axis& axis, double dt ) const;
+
+	void CorrectAxis( Axis& axis, double measurement ) const;
+
+protected:
+	bool											m_tracking;
+	double											m_stamp;
+	int												m_coasted_frames;
+	int												m_corrected_frames;
+
+	Axis											m_x;
+	Axis											m_y;
+
+	double											m_acceleration_noise;
+	double											m_measurement_noise;
+	double											m_initial_velocity;
+	double											m_gate;
+	int												m_max_coast_frames;
+	double											m_max_deviation;
+};
+
+#endif /* TARGETTRACKER_H_ */
@@ -0,0 +1,182 @@
+/*
+ * ThresholdEstimator.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef THRESHOLDESTIMATOR_H_
+#define THRESHOLDESTIMATOR_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+/**
+ * This class decides which binary threshold separates the objects from the background of the
+ * smoothed gray image. It supports three modes:
+ *
+ * FIXED     - The configured threshold is always used.
+ * OTSU      - Otsu's threshold is computed from the full histogram of the region that is looked at
+ *             (the original behaviour of the detection, which looked at the whole frame).
+ * AMORTIZED - Otsu's threshold is computed from a histogram of a subsampled grid of pixels, and
+ *             only every few frames or when the mean brightness of the same region of the image
+ *             has drifted since the last update. Every new estimate is blended into the threshold
+ *             in use so that it follows slow lighting changes without jumping from frame to frame.
+ *
+ * Detection may look at the same frame several times (at different scales or in a widening
+ * window). Looks at a region that is no larger than one already looked at reuse the threshold of
+ * the frame, so the widened windows and the refinement do not each get their own threshold. The
+ * window is widened when the target is not in it, so the first region may hold nothing but
+ * background, whose histogram has a single peak that Otsu's method splits in two. The threshold is
+ * therefore estimated again whenever a larger share of the frame is looked at (in AMORTIZED mode
+ * only if the frame was used for an update, which is then made from the larger region instead).
+ */
+class ThresholdEstimator
+{
+public:
+	enum Mode
+	{
+		FIXED = 0,
+		OTSU = 1,
+		AMORTIZED = 2
+	};
+
+	/**
+	 * Creates an estimator that computes Otsu's threshold on every image.
+	 */
+	ThresholdEstimator();
+
+	virtual ~ThresholdEstimator();
+
+	/**
+	 * Selects the mode. Unknown values fall back to OTSU.
+	 */
+	void SetMode( int mode );
+
+	Mode GetMode() const;
+
+	/**
+	 * Sets the threshold of the FIXED mode.
+	 */
+	void SetFixedThreshold( double threshold );
+
+	/**
+	 * Sets the parameters of the AMORTIZED mode: the histogram is built from every subsample-th
+	 * pixel of every subsample-th row, it is rebuilt at least every interval frames or whenever the
+	 * mean brightness of the same region differs from the one at the last update by more than drift
+	 * gray values, and every new estimate is blended into the threshold with the weight alpha (1
+	 * means no blending).
+	 */
+	void SetAmortization( int interval, int subsample, double drift, double alpha );
+
+	/**
+	 * Marks the start of a new frame.
+	 */
+	void BeginFrame();
+
+	/**
+	 * Returns the threshold to use for the region of interest of the provided gray image.
+	 */
+	int Estimate( const IplImage* gray );
+
+	/**
+	 * Returns true if Estimate() has to look at the gray values of the region of interest of the
+	 * provided image to pick the threshold. If not, the threshold is known before the region is
+	 * converted to gray and can be taken with EstimateAhead().
+	 */
+	bool NeedsImage( const IplImage* gray ) const;
+
+	/**
+	 * Returns the threshold to use for the current region without looking at it. If
+	 * WantsHistogram() is true afterwards, the histogram of the region must be handed to Learn()
+	 * once it has been counted.
+	 */
+	int EstimateAhead();
+
+	bool WantsHistogram() const;
+
+	/**
+	 * Decides from the 256 bin histogram of the region of interest of the mask, which was
+	 * thresholded with the value of EstimateAhead(), whether the threshold is estimated again, and
+	 * does so from the histogram. The new threshold is used for the looks that follow.
+	 */
+	void Learn( const IplImage* mask, const unsigned int* histogram );
+
+	/**
+	 * Returns the threshold that was returned last, which is the threshold currently in use.
+	 */
+	double GetThreshold() const;
+
+	/**
+	 * Returns true if the last call to Estimate() rebuilt a histogram.
+	 */
+	bool WasUpdated() const;
+
+private:
+	/**
+	 * Returns the mean gray value of the subsampled grid of the image.
+	 */
+	double SampleMean( const IplImage* gray, int subsample ) const;
+
+	/**
+	 * Counts the gray values of the subsampled grid of the image into the histogram.
+	 */
+	void SampleHistogram( const IplImage* gray, int subsample, unsigned int* histogram ) const;
+
+	/**
+	 * Returns true if the threshold of the AMORTIZED mode is due to be estimated again for a frame
+	 * with the provided mean gray value over the region of interest of the image.
+	 */
+	bool IsDue( double mean, const IplImage* gray );
+
+	/**
+	 * Blends the threshold that Otsu's method picks for the histogram into the one in use.
+	 */
+	void Update( const unsigned int* histogram );
+
+	/**
+	 * Returns the share of the image that its region of interest covers.
+	 */
+	static double Share( const IplImage* gray );
+
+	/**
+	 * Returns true if the region of interest of the image is not the first one of the frame and
+	 * covers a larger share of it than the region the threshold of the frame was picked from.
+	 */
+	bool IsWider( const IplImage* gray ) const;
+
+protected:
+	Mode											m_mode;
+
+	double											m_fixed_threshold;
+	double											m_threshold;
+
+	int												m_interval;
+	int												m_subsample;
+	double											m_drift;
+	double											m_alpha;
+
+	bool											m_initialized;
+	bool											m_first_look;
+	bool											m_updated;
+	bool											m_learn_pending;
+	int												m_frames_since_update;
+
+	/*
+	 * The share of the frame that the threshold of the frame was picked from, whether the frame was
+	 * used for an update of the AMORTIZED mode and the state before that update.
+	 */
+	double											m_look_share;
+	bool											m_frame_updated;
+	double											m_threshold_before;
+	bool											m_initialized_before;
+
+	/*
+	 * The mean gray value that the drift is measured from and the region (and the size of the
+	 * image) it was taken over.
+	 */
+	double											m_mean_at_update;
+	CvRect											m_mean_region;
+	CvSize											m_mean_size;
+};
+
+#endif /* THRESHOLDESTIMATOR_H_ */
@@ -0,0 +1,89 @@
+/*
+ * TrackingWindow.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef TRACKINGWINDOW_H_
+#define TRACKINGWINDOW_H_
+
+// OpenCV Includes
+#include <opencv/cv.h>
+
+/**
+ * This class keeps track of the part of the image that has to be processed in order to find the
+ * tracked blob again in the next frame.
+ *
+ * Once the target has been found the window is centred on the position it is expected at in the
+ * next frame (its last position plus the distance it moved between the last two frames) and sized
+ * to the target's bounding box plus a margin. If the target is not found inside the window, the
+ * window is widened step by step until it covers the full frame.
+ */
+class TrackingWindow
+{
+public:
+	/**
+	 * Creates a window that covers the full frame.
+	 */
+	TrackingWindow();
+
+	virtual ~TrackingWindow();
+
+	/**
+	 * Sets how the window is sized. The window is 'margin' times the size of the target's
+	 * bounding box plus 'padding' pixels on every side. Every widening step multiplies the size by
+	 * 'growth' and after 'max_steps' steps the full frame is used.
+	 */
+	void SetParameters( double margin, int padding, double growth, int max_steps );
+
+	/**
+	 * Makes the window cover the full frame and forgets the target's motion.
+	 */
+	void Reset();
+
+	/**
+	 * Moves the window to the position where the target is expected in the next frame, given its
+	 * position and bounding box size in the current frame.
+	 */
+	void Update( double center_x, double center_y, int target_width, int target_height );
+
+	/**
+	 * Widens the window by one step. Returns false if the window already covers the full frame.
+	 */
+	bool Widen();
+
+	/**
+	 * Returns true if the window covers the full frame.
+	 */
+	bool IsFullFrame() const;
+
+	/**
+	 * Returns the window clipped to a frame of the provided size.
+	 */
+	CvRect GetRect( CvSize frame_size ) const;
+
+	/**
+	 * Returns true if the provided box touches an edge of the window that is not also an edge of
+	 * the frame, which means that the blob in the box might have been cut off by the window.
+	 */
+	bool IsOnBorder( CvRect window, CvSize frame_size, int min_x, int min_y, int max_x, int max_y ) const;
+
+protected:
+	bool											m_has_target;
+	bool											m_has_motion;
+	int												m_step;
+
+	double											m_center_x;
+	double											m_center_y;
+	double											m_velocity_x;
+	double											m_velocity_y;
+	int												m_target_width;
+	int												m_target_height;
+
+	double											m_margin;
+	int												m_padding;
+	double											m_growth;
+	int												m_max_steps;
+};
+
+#endif /* TRACKINGWINDOW_H_ */
@@ -0,0 +1,107 @@
+/*
+ * VelocityCommandOutput.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VELOCITYCOMMANDOUTPUT_H_
+#define VELOCITYCOMMANDOUTPUT_H_
+
+// ROS Includes
+#include <ros/ros.h>
+#include <geometry_msgs/Twist.h>
+#include <brics_actuator/JointVelocities.h>
+
+// BOOST
+#include <boost/noncopyable.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+ * This class is the output stage of the control: it collects the base and arm velocities of a
+ * control cycle and sends them as one base command and one arm command.
+ *
+ * The arm message is built once when the publishers are set up, with an entry (joint name and
+ * unit) for every joint, so a control cycle only has to fill in the velocities and a single time
+ * stamp. Commands are sent at most at the configured rate and a zero command is only sent once
+ * until something moves again. A command that stops the robot is never held back by the rate.
+ */
+class VelocityCommandOutput : private boost::noncopyable
+{
+public:
+	/**
+	 * The commands that Flush() has sent.
+	 */
+	enum Command
+	{
+		BASE = 1,
+		ARM = 2
+	};
+
+	VelocityCommandOutput();
+
+	virtual ~VelocityCommandOutput();
+
+	/**
+	 * Sets up the base publisher and, if the robot has an arm, the arm publisher and the arm message
+	 * for the provided joints.
+	 */
+	void Advertise( ros::NodeHandle& node_handler, bool arm, const std::vector<std::string>& arm_joint_names );
+
+	/**
+	 * Sends a zero command on both publishers and shuts them down.
+	 */
+	void Shutdown();
+
+	/**
+	 * Sets the highest rate (in Hz) at which commands are sent. Zero sends one every control cycle.
+	 */
+	void SetRate( double rate );
+
+	void SetBaseLinearX( double velocity );
+	void SetBaseLinearY( double velocity );
+
+	/**
+	 * Sets the velocity of the provided arm joint, all other joints keep theirs (zero unless set).
+	 */
+	void SetArmJointVelocity( unsigned int joint, double velocity );
+
+	/**
+	 * The velocities of the current control cycle, zero for joints the robot does not have.
+	 */
+	double GetBaseLinearX() const;
+	double GetBaseLinearY() const;
+	double GetArmJointVelocity( unsigned int joint ) const;
+
+	/**
+	 * Sends the commands of this control cycle, as far as the rate and the zero command rule allow.
+	 * Returns the commands that were sent (a combination of BASE and ARM).
+	 */
+	int Flush();
+
+private:
+	/**
+	 * Returns true if a command should be sent now: a stop is sent right away, but only once, any
+	 * other command when the rate allows it.
+	 */
+	bool ShouldSend( bool is_zero, bool was_zero, const ros::WallTime& last_sent, const ros::WallTime& now ) const;
+
+protected:
+	ros::Publisher									m_base_publisher;
+	ros::Publisher									m_arm_publisher;
+
+	geometry_msgs::Twist							m_base_command;
+	geometry_msgs::Twist							m_sent_base_command;
+	ros::WallTime									m_base_sent_time;
+	bool											m_base_sent;
+
+	brics_actuator::JointVelocities					m_arm_command;
+	std::vector<double>								m_sent_arm_velocities;
+	ros::WallTime									m_arm_sent_time;
+	bool											m_arm_sent;
+
+	double											m_period;
+};
+
+#endif /* VELOCITYCOMMANDOUTPUT_H_ */
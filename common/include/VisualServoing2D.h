@@ -19,15 +19,98 @@
 #include <opencv/cv.h>
 #include <opencv/highgui.h>
 
-// cvBlobsLib Includes.
-#include <BlobResult.h>
-
 #include "std_msgs/String.h"
+#include "std_msgs/Float64.h"
+
+#include "AdaptiveBackground.h"
+#include "AxisController.h"
+#include "BackgroundMask.h"
+#include "BlobLabeler.h"
+#include "DebugRenderer.h"
+#include "FlightRecorder.h"
+#include "ForegroundKernels.h"
+#include "ImageFrame.h"
+#include "InterceptPredictor.h"
+#include "ImageSmoother.h"
+#include "ProximityMonitor.h"
+#include "QualityScheduler.h"
+#include "LatencyMonitor.h"
+#include "ObjectTracker.h"
+#include "ThresholdEstimator.h"
+#include "TrackingWindow.h"
+#include "VelocityCommandOutput.h"
+#include "ImageBufferPool.h"
 
 // BOOST
 #include <boost/units/systems/si.hpp>
+#include <boost/thread/mutex.hpp>
 #include <string>
 
+/**
+ * The result of the blob detection on a single frame. This is everything that the control part of
+ * the visual servoing needs, so detection and control can run on different threads.
+ */
+struct TargetObservation
+{
+	/*
+	 * Same codes as VisualServoing(), anything but 0 ends the visual servoing.
+	 */
+	int												status;
+	bool											found;
+
+	double											x_offset;
+	double											y_offset;
+	double											rot_offset;
+
+	/*
+	 * Conveyer belt mode only: the number of seconds until the object crosses the grasp line, or -1
+	 * if no crossing is predicted. If there is one, the offsets are those of the crossing point.
+	 */
+	double											time_to_intercept;
+
+	/*
+	 * The stamp of the frame (in seconds), the number of blobs that were found in it and where the
+	 * target was, for the flight recorder.
+	 */
+	double											stamp;
+	unsigned int									blob_count;
+	double											tracked_x;
+	double											tracked_y;
+
+	/*
+	 * The quality level the frame was processed at, see QualityScheduler.
+	 */
+	int												quality_level;
+
+	/*
+	 * The ID of the object that is servoed to (-1 if there is none) and every object that is being
+	 * tracked.
+	 */
+	int												target_id;
+	std::vector<ObjectTrack>						objects;
+
+	/*
+	 * When the frame was taken and processed. DetectTarget() leaves these alone, they are filled in
+	 * by whoever hands the frame over.
+	 */
+	FrameTimestamps									timestamps;
+};
+
+/**
+ * The time in milliseconds that a single DetectTarget() call spent in each stage of the blob
+ * detection. Stages that run more than once per frame (when the tracking window is widened or the
+ * blob is refined) are summed up.
+ */
+struct DetectionTimings
+{
+	double											convert;
+	double											smooth;
+	double											threshold;
+	double											subtract;
+	double											label;
+	double											select;
+};
+
 /**
  *	This is the class that is responsible for performing visual servoing on
  *	2 Dimensional images typically provided in the RGB spectrum. We are
@@ -48,10 +131,14 @@ public:
 	 * Modes:
 	 * 0 - Standard Visual Servoing
 	 * 1 - Conveyer Belt Visual Servoing
+	 *
+	 * Several instances, one per camera stream, may share a buffer pool. Without one the instance
+	 * uses a pool of its own.
 	 */
 	VisualServoing2D( bool debugging,
 					  int mode,
-					  std::vector<std::string> arm_joint_names );
+					  std::vector<std::string> arm_joint_names,
+					  ImageBufferPool* buffer_pool = NULL );
 	/**
 	 * Standard C++ destructor method.
 	 */
@@ -69,12 +156,69 @@ public:
 	 */
 	int VisualServoing( IplImage* input_image );
 
+	/**
+	 * This function runs only the detection part of VisualServoing() on the provided frame and
+	 * stores the offsets of the tracked blob in the observation. It returns false if the frame could
+	 * not be used, in which case there is nothing to act on.
+	 */
+	bool DetectTarget( const ImageFrame& frame, TargetObservation& observation );
+
+	/**
+	 * This function runs only the control part of VisualServoing(): it moves the base and the arm to
+	 * account for the offsets in the provided observation. The return values are the same as for
+	 * VisualServoing().
+	 *
+	 * DetectTarget() and ServoToTarget() may be called from two different threads, but each of them
+	 * must only ever be called from one.
+	 */
+	int ServoToTarget( const TargetObservation& observation );
+
+	/**
+	 * Returns the stage timings of the last DetectTarget() call.
+	 */
+	const DetectionTimings& GetDetectionTimings() const;
+
+	/**
+	 * Returns the latency monitor of this instance, into which the detection records its stages and
+	 * the control stage the age of the frames whose commands it publishes.
+	 */
+	LatencyMonitor& GetLatencyMonitor();
+
+	/**
+	 * Returns the flight recorder of this instance, which holds a record of the last few thousand
+	 * control cycles. A new session is started by CreatePublishers().
+	 */
+	FlightRecorder& GetFlightRecorder();
+
+	/**
+	 * Switches the target to the tracked object with the provided ID, without starting over. It is
+	 * safe to call this from any thread, the switch is made at the start of the next detection if
+	 * the object is still being tracked then.
+	 */
+	void SelectTarget( int id );
+
+	/**
+	 * Forgets the tracked objects, the target and what the adaptive background has learnt, so that
+	 * the next frame starts over with the largest blob. This is done by CreatePublishers() for every
+	 * session, and must not be called while a frame is being detected.
+	 */
+	void ResetSession();
+
+	/**
+	 * Sets the topic the debug display is published on. Takes effect the next time it is started.
+	 */
+	void SetDebugTopic( const std::string& topic );
+
 	/**
 	 * Setter function which allows the visual servoing application to pass down updated gripper
 	 * positions so that we can use them in future computations.
 	 */
 	void UpdateGripperPosition( float new_position );
 
+	/**
+	 * Hands a new configuration to the visual servoing. It is safe to call this from any thread, the
+	 * configuration is picked up at the start of the next detection and of the next control cycle.
+	 */
 	void UpdateDynamicVariables( raw_visual_servoing::VisualServoingConfig config );
 
 	/**
@@ -117,6 +261,19 @@ private:
 	 */
 	bool ArmAdjustment( double orientation );
 
+	/**
+	 * This function applies the configuration that was last passed to UpdateDynamicVariables(), if
+	 * it has not been applied yet. It is run by the detection thread.
+	 */
+	void ApplyDynamicVariables();
+
+	/**
+	 * This function applies the control part (controller modes, gains and limits, command rate) of
+	 * the configuration that was last passed to UpdateDynamicVariables(). It is run by the control
+	 * thread, so the controllers are only ever touched by that thread.
+	 */
+	void ApplyControlVariables();
+
 	/**
 	 * This function loads in the background image that will be subtracted from the incoming image
 	 * during the visual servoing to allow the system to better focus on non-standard parts of the
@@ -131,12 +288,82 @@ private:
 	IplImage* RegionOfInterest( IplImage* input_image, double scale );
 
 	/**
-	 * This is a function that will take in an arbitrary number of images and create a display for
-	 * them that will serve as the Heads Up Display (HUD) of the Visual Servoing Application.
-	 * This is a modified version of the source code found here:
-	 * http://opencv.willowgarage.com/wiki/DisplayManyImages
+	 * This function crops the provided image to the provided window by setting its region of
+	 * interest, see ImageBufferPool::SetRegion().
+	 */
+	IplImage* RegionOfInterest( IplImage* input_image, CvRect window );
+
+	/**
+	 * This function runs the blob detection (gray extraction, smoothing, thresholding, background
+	 * removal and labeling) on the provided window of the frame. If the scale is larger than one
+	 * the gray window is first extracted into luma, which must be of the frame size, and downscaled
+	 * by that factor. The resulting mask is written to the matching window of the gray image, which
+	 * must be of the downscaled size, and the blobs that were found are stored in full resolution
+	 * coordinates in the provided table. The window is aligned to the scale on return.
+	 *
+	 * With the adaptive background, the background model learns from the window if a rectangle
+	 * (in full resolution coordinates) is provided to leave out of the update.
+	 *
+	 * Unsmoothed BGR frames at full resolution skip the gray values and are turned into the mask in
+	 * a single pass (see ImageFrame::ExtractForeground()) whenever the threshold is known up front.
+	 */
+	void DetectBlobs( const ImageFrame& frame, IplImage* luma, IplImage* gray, CvRect& window, int scale, BlobTable& blobs,
+					  const CvRect* learn_outside = NULL );
+
+	/**
+	 * This function labels the blobs in the region of interest of the mask, which has been
+	 * downscaled by the provided factor, and then resets the region of interest.
+	 */
+	void LabelBlobs( IplImage* mask, int scale, BlobTable& blobs );
+
+	/**
+	 * This function repeats the blob detection at full resolution inside the bounding box of the
+	 * provided blob in m_blobs and replaces the blob with the refined one. It returns the window
+	 * that was processed.
+	 */
+	CvRect RefineBlob( const ImageFrame& frame, IplImage* full_gray, int blob );
+
+	/**
+	 * This function returns the size of the smoothing kernel to use for an image that has been
+	 * downscaled by the provided factor. A size of one means that no smoothing is done, which is also
+	 * the case at the lowest quality level.
 	 */
-	void HUD(char* title, int nArgs, ...);
+	int SmoothingSize( int scale ) const;
+
+	/**
+	 * This function returns the index of the blob in m_blobs whose bounding box centre is closest
+	 * to the provided position, or -1 if there are no blobs.
+	 */
+	int NearestBlob( double x, double y ) const;
+
+	/**
+	 * This function matches the blobs in m_blobs, found in the provided window, with the tracked
+	 * objects and returns the index of the blob that is taken as the target. While the target is
+	 * tracked this is the blob matched with its track, or -1 if there is none. Otherwise it is the
+	 * blob nearest to the last tracked position.
+	 */
+	int SelectBlob( CvRect window );
+
+	/**
+	 * This function makes the switch to the target that was last passed to SelectTarget(), if any.
+	 */
+	void ApplyTargetSelection();
+
+	/**
+	 * Returns the time in milliseconds since the provided tick count and sets it to the current one.
+	 */
+	double Lap( int64& ticks ) const;
+
+	/**
+	 * Records the age of the frame that is being acted on when a command is published.
+	 */
+	void RecordCommand( LatencyMonitor::Stage stage );
+
+	/**
+	 * Adds the control cycle for the provided observation, with its result and FlightRecorder flags,
+	 * to the flight recorder.
+	 */
+	void RecordFlight( const TargetObservation& observation, int status, int flags );
 
 protected:
 	/*
@@ -163,26 +390,76 @@ protected:
 	double 											m_tracked_y;
 
 	float											m_gripper_position;
+	boost::mutex									m_gripper_mutex;
 
-	geometry_msgs::Twist 							m_youbot_base_velocities;
-	brics_actuator::JointVelocities 				m_youbot_arm_velocities;
 	std::vector<std::string> 						m_arm_joint_names;
 
-	ros::Publisher 									m_base_velocities_publisher;
-	ros::Publisher 									m_arm_velocities_publisher;
+	VelocityCommandOutput							m_command_output;
+
+	/*
+	 * One controller per adjustment: the base in x, the base in y and the arm rotation. The control
+	 * time is when the last control cycle ran, the start time when the publishers were created.
+	 */
+	AxisController									m_x_controller;
+	AxisController									m_y_controller;
+	AxisController									m_rot_controller;
+	double											m_control_dt;
+	ros::WallTime									m_control_time;
+	ros::WallTime									m_start_time;
+	double											m_grasp_lead;
 	  ros::Publisher									m_pub_visual_servoing_status;
+	ros::Publisher									m_threshold_publisher;
 	ros::NodeHandle 								m_node_handler;
 
 	bool											m_is_blob_lost;
 	ros::Time 										m_time_when_lost;
 	const static int								m_lost_blob_timeout = 3;
 
-	ros::ServiceClient  							m_safe_cmd_vel_service;
-	hbrs_srvs::ReturnBool							m_service_msg;
+	ProximityMonitor								m_proximity_monitor;
 
 	IplImage* 										m_background_image;
+	BackgroundMask									m_background_mask;
+	AdaptiveBackground								m_adaptive_background;
+	QualityScheduler								m_quality_scheduler;
+
+	DebugRenderer									m_debug_renderer;
+	DebugOverlay									m_debug_overlay;
+	std::string										m_debug_topic;
+
+	ImageBufferPool									m_own_buffer_pool;
+	ImageBufferPool&								m_buffer_pool;
+	unsigned int									m_frame_allocations;
+
+	BlobLabeler										m_blob_labeler;
+	BlobTable										m_blobs;
+	BlobTable										m_refined_blobs;
+
+	TrackingWindow									m_tracking_window;
+	ObjectTracker									m_object_tracker;
+	int												m_target_id;
+	int												m_requested_target_id;
+	InterceptPredictor								m_intercept_predictor;
+
+	DetectionTimings								m_timings;
+
+	/*
+	 * The observation of VisualServoing(), kept so that its table of objects is reused.
+	 */
+	TargetObservation								m_observation;
+
+	LatencyMonitor									m_latency_monitor;
+	FrameTimestamps									m_command_timestamps;
+	FlightRecorder									m_flight_recorder;
+	bool											m_too_close;
+
+	ImageSmoother									m_smoother;
+	ThresholdEstimator								m_threshold_estimator;
 
 	raw_visual_servoing::VisualServoingConfig		m_dynamic_variables;
+	raw_visual_servoing::VisualServoingConfig		m_pending_config;
+	bool											m_config_changed;
+	bool											m_control_config_changed;
+	boost::mutex									m_config_mutex;
 
 	/*
 	 * Constant values
@@ -193,6 +470,8 @@ protected:
 	const static double 							m_x_velocity = 0.012;
 	const static double 							m_y_velocity = 0.012;
 	const static double 							m_rot_velocity = 0.3;
+	const static double								m_nominal_control_period = 0.1;
+	const static double								m_max_control_period = 0.5;
 
 	const static int								m_x_target = 0;
 	const static int 								m_x_threshold = 20;
@@ -202,6 +481,11 @@ protected:
 
 	const static int								m_rot_target = 90;
 	const static int								m_rot_tolerance = 5;
+
+	/*
+	 * The velocity of a target only counts towards the belt velocity once it has been seen this often.
+	 */
+	const static int								m_min_belt_frames = 5;
 };
 
 #endif /* VISUALSERVOING2D_H_ */
@@ -8,11 +8,216 @@
 #ifndef VISUALSERVOING3D_H_
 #define VISUALSERVOING3D_H_
 
+// OpenCV Includes
+#include <opencv/cv.h>
+
+#include <vector>
+
+#include "BlobLabeler.h"
+#include "PlaneEstimator.h"
+
+/**
+ * The result of the object detection on a single depth frame. All positions are in metres in the
+ * camera frame (x to the right, y down, z along the optical axis).
+ */
+struct DepthObservation
+{
+	/*
+	 * Whether the support plane and an object on it were found, and the plane.
+	 */
+	bool											plane_found;
+	bool											found;
+	Plane											plane;
+
+	/*
+	 * The centroid of the visible surface of the object and its offset from the target position,
+	 * see VisualServoing3D::SetTargetPosition().
+	 */
+	double											x;
+	double											y;
+	double											z;
+	double											x_offset;
+	double											y_offset;
+	double											z_offset;
+
+	/*
+	 * The orientation of the object's major axis in the plane, in radians within (-pi/2, pi/2]. It
+	 * is measured from the camera's x axis projected onto the plane, counter-clockwise as seen from
+	 * the camera's side of the plane.
+	 */
+	double											yaw;
+
+	/*
+	 * The height of the highest point of the object above the plane, the number of depth pixels it
+	 * covers and the number of objects that were found on the plane.
+	 */
+	double											height;
+	unsigned int									point_count;
+	unsigned int									blob_count;
+};
+
+/**
+ * The time in milliseconds that a single DetectTarget() call spent in each stage.
+ */
+struct DepthTimings
+{
+	double											convert;
+	double											plane;
+	double											segment;
+	double											label;
+	double											measure;
+};
+
+/**
+ * This is the class that is responsible for finding the object to servo to in organized depth
+ * images, such as those of an RGB-D camera, and for working out its metric offsets and yaw.
+ *
+ * The support plane is found with an incremental RANSAC (see PlaneEstimator) on points sampled from
+ * a coarse grid of the depth image. Every pixel is then marked as part of an object if it lies
+ * between the minimum and the maximum height above the plane. This works on the image grid
+ * directly: the heights follow from the depth and two tables of ray directions (one per column and
+ * one per row), so no point cloud is ever built. The objects are the connected components of the
+ * marked pixels (see BlobLabeler), and only the pixels of the target are turned into 3D points to
+ * measure its centroid and orientation.
+ *
+ * The first target is the largest object, after that the object closest to the last target in the
+ * image is followed. The class does not depend on ROS, so recorded depth frames can be replayed
+ * through it offline (see depth_benchmark).
+ */
 class VisualServoing3D
 {
 public:
 	VisualServoing3D();
 	virtual ~VisualServoing3D();
+
+	/**
+	 * Sets the focal lengths and the principal point of the depth camera, in pixels. The default is
+	 * the Kinect's 525, 525, 319.5, 239.5 (at 640x480).
+	 */
+	void SetCamera( double fx, double fy, double cx, double cy );
+
+	/**
+	 * Sets the position (in metres, in the camera frame) that the object should end up at. The
+	 * offsets of an observation are measured from it.
+	 */
+	void SetTargetPosition( double x, double y, double z );
+
+	/**
+	 * Sets the heights (in metres) between which a point above the plane belongs to an object and
+	 * the least number of pixels an object has to cover.
+	 */
+	void SetSegmentation( double min_height, double max_height, int min_pixels );
+
+	/**
+	 * Sets the distance (in metres) up to which a point is on the plane and the most planes that
+	 * RANSAC tries per frame.
+	 */
+	void SetPlaneParameters( double inlier_distance, int max_iterations );
+
+	/**
+	 * Forgets the plane and the target, the next frame starts over.
+	 */
+	void Reset();
+
+	/**
+	 * Finds the target in the provided organized depth image, which is either 16 bit in millimetres
+	 * or 32 bit floating point in metres. Pixels without depth are zero (or NaN). Returns false if
+	 * the image could not be used.
+	 */
+	bool DetectTarget( const IplImage* depth, DepthObservation& observation );
+
+	/**
+	 * Returns the stage timings of the last DetectTarget() call.
+	 */
+	const DepthTimings& GetTimings() const;
+
+	/**
+	 * Returns the number of planes that RANSAC tried in the last frame.
+	 */
+	int GetPlaneIterations() const;
+
+private:
+	/**
+	 * Returns the depth image in metres, converting it if it is in millimetres.
+	 */
+	const IplImage* MetricDepth( const IplImage* depth );
+
+	/**
+	 * Fills the tables of ray directions for an image of the provided size.
+	 */
+	void UpdateRays( CvSize size );
+
+	/**
+	 * Collects the points of every few pixels of the depth image for the plane estimate.
+	 */
+	void SamplePoints( const IplImage* depth );
+
+	/**
+	 * Marks the pixels between the minimum and maximum height above the plane in the mask.
+	 */
+	void Segment( const IplImage* depth, const Plane& plane );
+
+	/**
+	 * Returns the blob to follow or -1 if there is none.
+	 */
+	int SelectBlob() const;
+
+	/**
+	 * Measures the position, orientation and height of the provided blob from its depth pixels.
+	 * Returns false if it has no pixels with depth.
+	 */
+	bool Measure( const IplImage* depth, const Plane& plane, int blob, DepthObservation& observation );
+
+	/**
+	 * Returns the time in milliseconds since the provided tick count and sets it to now.
+	 */
+	double Lap( int64& ticks ) const;
+
+protected:
+	double											m_fx;
+	double											m_fy;
+	double											m_cx;
+	double											m_cy;
+
+	double											m_target_x;
+	double											m_target_y;
+	double											m_target_z;
+
+	double											m_min_height;
+	double											m_max_height;
+
+	PlaneEstimator									m_plane_estimator;
+	BlobLabeler										m_blob_labeler;
+	BlobTable										m_blobs;
+
+	/*
+	 * The depth in metres (if the input is in millimetres) and the object mask.
+	 */
+	IplImage*										m_metric_depth;
+	IplImage*										m_mask;
+
+	/*
+	 * The x and y direction of the ray through every column and row, for a depth of one metre.
+	 */
+	std::vector<float>								m_ray_x;
+	std::vector<float>								m_ray_y;
+	CvSize											m_ray_size;
+
+	std::vector<CvPoint3D32f>						m_samples;
+
+	/*
+	 * Where the target was in the image in the last frame.
+	 */
+	bool											m_has_target;
+	double											m_last_x;
+	double											m_last_y;
+
+	DepthTimings									m_timings;
+
+	/*
+	 * Every this many pixels and rows a point is sampled for the plane estimate.
+	 */
+	const static int								m_sample_stride = 8;
 };
 
 #endif /* VISUALSERVOING3D_H_ */
@@ -0,0 +1,96 @@
+/*
+ * WorkerPool.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+// BOOST
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <deque>
+#include <vector>
+
+/**
+ * This class runs tasks on a fixed set of worker threads that is shared by all camera streams, so
+ * the number of threads follows the number of cores instead of the number of streams.
+ *
+ * Every worker has its own queue. A task that is submitted from a worker goes onto the queue of
+ * that worker and is run from the back (newest first), which keeps the data of a stream in the
+ * cache of the core that just worked on it. A worker whose queue is empty steals the oldest task
+ * from the front of another queue, so a busy stream never holds up the others while a core is
+ * idle. Tasks that are submitted from outside (the ROS callbacks) are spread over the queues.
+ *
+ * The pool does not order tasks. Anything that must not run concurrently (the detection of one
+ * stream, for example) has to be serialised by the caller.
+ */
+class WorkerPool : private boost::noncopyable
+{
+public:
+	typedef boost::function<void()>					Task;
+
+	/**
+	 * Starts the provided number of worker threads. Zero starts one per core.
+	 */
+	WorkerPool( unsigned int threads = 0 );
+
+	/**
+	 * Stops the workers after the tasks they are running have finished. Tasks that have not been
+	 * started yet are dropped.
+	 */
+	virtual ~WorkerPool();
+
+	/**
+	 * Queues a task to be run by one of the workers.
+	 */
+	void Submit( const Task& task );
+
+	unsigned int GetThreadCount() const;
+
+private:
+	/**
+	 * The loop that each worker thread runs.
+	 */
+	void Run( unsigned int worker );
+
+	/**
+	 * Takes the newest task from the queue of the provided worker or, if it is empty, steals the
+	 * oldest one from another queue. Returns false if all queues are empty.
+	 */
+	bool Pop( unsigned int worker, Task& task );
+
+protected:
+	struct WorkQueue
+	{
+		boost::mutex								mutex;
+		std::deque<Task>							tasks;
+	};
+
+	std::vector<WorkQueue*>							m_queues;
+	boost::thread_group								m_threads;
+
+	/*
+	 * The index of the worker that is running on the current thread, not set outside the pool.
+	 */
+	boost::thread_specific_ptr<unsigned int>		m_worker_index;
+
+	/*
+	 * Idle workers sleep on the condition until a task is submitted. m_pending counts the tasks that
+	 * have been submitted but not taken yet.
+	 */
+	boost::mutex									m_idle_mutex;
+	boost::condition_variable						m_idle_condition;
+	volatile int									m_pending;
+	volatile bool									m_running;
+
+	unsigned int									m_next_queue;
+};
+
+#endif /* WORKERPOOL_H_ */
@@ -0,0 +1,82 @@
+/*
+ * AdaptiveBackground.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "AdaptiveBackground.h"
+
+#include "ForegroundKernels.h"
+#include "ImageBufferPool.h"
+
+AdaptiveBackground::AdaptiveBackground()
+{
+	m_rate = 6;
+}
+
+AdaptiveBackground::~AdaptiveBackground()
+{
+	Reset();
+}
+
+void
+AdaptiveBackground::SetRate( int rate )
+{
+	m_rate = rate;
+}
+
+void
+AdaptiveBackground::Reset()
+{
+	for( unsigned int i = 0; i < m_models.size(); i++ )
+	{
+		cvReleaseImage( &m_models[i] );
+	}
+	m_models.clear();
+}
+
+void
+AdaptiveBackground::Subtract( const IplImage* gray, const IplImage* seed, int threshold, bool update, CvRect frozen, IplImage* mask )
+{
+	IplImage* model = GetModel( cvGetSize( gray ), seed );
+
+	CvRect roi = cvGetImageROI( gray );
+	ImageBufferPool::SetRegion( model, roi );
+	ForegroundKernels::AdaptiveSubtract( gray, model, threshold, m_rate, update, frozen, mask );
+	ImageBufferPool::ResetRegion( model );
+}
+
+IplImage*
+AdaptiveBackground::GetModel( CvSize size, const IplImage* seed )
+{
+	for( unsigned int i = 0; i < m_models.size(); i++ )
+	{
+		if( m_models[i]->width == size.width && m_models[i]->height == size.height )
+		{
+			return m_models[i];
+		}
+	}
+
+	if( m_models.size() >= m_max_models )
+	{
+		cvReleaseImage( &m_models.front() );
+		m_models.erase( m_models.begin() );
+	}
+
+	/**
+	 * The static mask is 255 where the background is dark, which becomes a model that has been dark
+	 * in every frame.
+	 */
+	IplImage* model = cvCreateImage( size, IPL_DEPTH_16U, 1 );
+	if( seed )
+	{
+		cvConvertScale( seed, model, ForegroundKernels::ADAPTIVE_DARK / 255.0 );
+	}
+	else
+	{
+		cvSetZero( model );
+	}
+
+	m_models.push_back( model );
+	return model;
+}
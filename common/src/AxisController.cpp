@@ -0,0 +1,157 @@
+/*
+ * AxisController.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "AxisController.h"
+
+#include <algorithm>
+#include <cmath>
+
+AxisController::AxisController()
+{
+	m_mode = BANG_BANG;
+
+	m_kp = 0;
+	m_ki = 0;
+	m_kd = 0;
+
+	m_bang_bang_speed = 0;
+	m_max_velocity = 0;
+	m_max_acceleration = 0;
+	m_dead_band = 0;
+
+	Reset();
+}
+
+AxisController::~AxisController()
+{
+}
+
+void
+AxisController::SetMode( int mode )
+{
+	if( mode < BANG_BANG || mode > PID )
+	{
+		mode = BANG_BANG;
+	}
+
+	if( mode != m_mode )
+	{
+		m_mode = mode;
+		m_integral = 0;
+	}
+}
+
+int
+AxisController::GetMode() const
+{
+	return m_mode;
+}
+
+const char*
+AxisController::GetName( int mode )
+{
+	switch( mode )
+	{
+		case BANG_BANG:		return "bang-bang";
+		case PROPORTIONAL:	return "proportional";
+		case PID:			return "PID";
+		default:			return "unknown";
+	}
+}
+
+void
+AxisController::SetGains( double kp, double ki, double kd )
+{
+	m_kp = kp;
+	m_ki = ki;
+	m_kd = kd;
+}
+
+void
+AxisController::SetLimits( double bang_bang_speed, double max_velocity, double max_acceleration )
+{
+	m_bang_bang_speed = bang_bang_speed;
+	m_max_velocity = max_velocity;
+	m_max_acceleration = max_acceleration;
+}
+
+void
+AxisController::SetDeadBand( double dead_band )
+{
+	m_dead_band = dead_band;
+}
+
+void
+AxisController::Reset()
+{
+	m_integral = 0;
+	m_last_error = 0;
+	m_last_velocity = 0;
+	m_has_last_error = false;
+	m_on_target = false;
+}
+
+double
+AxisController::Update( double error, double dt )
+{
+	double derivative = ( m_has_last_error && dt > 0 ) ? ( error - m_last_error ) / dt : 0;
+	m_last_error = error;
+	m_has_last_error = true;
+
+	m_on_target = fabs( error ) < m_dead_band;
+	if( m_on_target )
+	{
+		m_integral = 0;
+		m_last_velocity = 0;
+		return 0;
+	}
+
+	if( m_mode == BANG_BANG )
+	{
+		m_last_velocity = ( error > 0 ) ? m_bang_bang_speed : -m_bang_bang_speed;
+		return m_last_velocity;
+	}
+
+	double velocity = m_kp * error;
+	double integral = m_integral;
+
+	if( m_mode == PID )
+	{
+		integral += error * std::max( dt, 0.0 );
+		velocity += m_ki * integral + m_kd * derivative;
+	}
+
+	/**
+	 * While the velocity is clamped the integral is not allowed to grow any further, otherwise it
+	 * would keep pushing long after the target has been reached (integral windup).
+	 */
+	bool saturated = false;
+	if( m_max_velocity > 0 && fabs( velocity ) > m_max_velocity )
+	{
+		velocity = ( velocity > 0 ) ? m_max_velocity : -m_max_velocity;
+		saturated = true;
+	}
+
+	if( !saturated || fabs( integral ) < fabs( m_integral ) )
+	{
+		m_integral = integral;
+	}
+
+	if( m_max_acceleration > 0 && dt > 0 )
+	{
+		double step = m_max_acceleration * dt;
+		velocity = std::min( std::max( velocity, m_last_velocity - step ), m_last_velocity + step );
+	}
+
+	m_last_velocity = velocity;
+	return velocity;
+}
+
+bool
+AxisController::IsOnTarget() const
+{
+	return m_on_target;
+}
@@ -0,0 +1,139 @@
+/*
+ * BackgroundMask.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BackgroundMask.h"
+
+BackgroundMask::BackgroundMask()
+{
+	m_background_image = NULL;
+
+	m_threshold = 0;
+	m_use_otsu = true;
+
+	m_background_generation = 0;
+}
+
+BackgroundMask::~BackgroundMask()
+{
+	for( unsigned int i = 0; i < m_masks.size(); i++ )
+	{
+		cvReleaseImage( &m_masks[i].mask );
+	}
+}
+
+void
+BackgroundMask::SetBackground( IplImage* background_image )
+{
+	m_background_image = background_image;
+	m_background_generation++;
+}
+
+void
+BackgroundMask::SetThreshold( double threshold, bool use_otsu )
+{
+	m_threshold = threshold;
+	m_use_otsu = use_otsu;
+}
+
+bool
+BackgroundMask::IsStale( CvSize frame_size, int smoothing_size, int smoothing_method ) const
+{
+	int index = Find( frame_size, smoothing_size, smoothing_method );
+
+	if( index < 0 )
+	{
+		return true;
+	}
+
+	return ( m_masks[index].generation != m_background_generation ) ||
+		   ( m_masks[index].use_otsu != m_use_otsu ) ||
+		   ( !m_use_otsu && m_masks[index].threshold != m_threshold );
+}
+
+IplImage*
+BackgroundMask::GetMask( CvSize frame_size, int smoothing_size, int smoothing_method )
+{
+	if( !m_background_image )
+	{
+		return NULL;
+	}
+
+	int index = Find( frame_size, smoothing_size, smoothing_method );
+
+	if( index < 0 )
+	{
+		if( m_masks.size() >= m_max_cached_masks )
+		{
+			cvReleaseImage( &m_masks.front().mask );
+			m_masks.erase( m_masks.begin() );
+		}
+
+		CachedMask cached;
+		cached.mask = cvCreateImage( frame_size, IPL_DEPTH_8U, 1 );
+		cached.smoothing_size = smoothing_size;
+		cached.smoothing_method = smoothing_method;
+		Rebuild( cached );
+
+		m_masks.push_back( cached );
+		return cached.mask;
+	}
+
+	if( IsStale( frame_size, smoothing_size, smoothing_method ) )
+	{
+		Rebuild( m_masks[index] );
+	}
+
+	return m_masks[index].mask;
+}
+
+int
+BackgroundMask::Find( CvSize frame_size, int smoothing_size, int smoothing_method ) const
+{
+	for( unsigned int i = 0; i < m_masks.size(); i++ )
+	{
+		if( m_masks[i].mask->width == frame_size.width &&
+			m_masks[i].mask->height == frame_size.height &&
+			m_masks[i].smoothing_size == smoothing_size &&
+			m_masks[i].smoothing_method == smoothing_method )
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void
+BackgroundMask::Rebuild( CachedMask& cached )
+{
+	IplImage* mask = cached.mask;
+
+	/**
+	 * The background image does not have to be taken at the camera resolution. If it differs we
+	 * convert it at its own size and scale the gray image to the frame size before smoothing so that
+	 * the subtraction always lines up with the incoming frame.
+	 */
+	if( m_background_image->width == mask->width && m_background_image->height == mask->height )
+	{
+		cvCvtColor( m_background_image, mask, CV_BGR2GRAY );
+	}
+	else
+	{
+		IplImage* background_gray = cvCreateImage( cvGetSize( m_background_image ), IPL_DEPTH_8U, 1 );
+		cvCvtColor( m_background_image, background_gray, CV_BGR2GRAY );
+		cvResize( background_gray, mask, CV_INTER_AREA );
+		cvReleaseImage( &background_gray );
+	}
+
+	m_smoother.SetMethod( cached.smoothing_method );
+	m_smoother.SetSize( cached.smoothing_size );
+	m_smoother.Smooth( mask );
+	cvThreshold( mask, mask, m_threshold, 255, CV_THRESH_BINARY_INV | ( m_use_otsu ? CV_THRESH_OTSU : 0 ) );
+
+	cached.threshold = m_threshold;
+	cached.use_otsu = m_use_otsu;
+	cached.generation = m_background_generation;
+}
@@ -0,0 +1,87 @@
+/*
+ * BenchmarkReplay.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BenchmarkReplay.h"
+
+// OpenCV
+#include <opencv/highgui.h>
+
+// BOOST
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+const int BenchmarkReplay::FIXTURE_FRAMES;
+const int BenchmarkReplay::MAX_FRAMES;
+const int BenchmarkReplay::WARM_UP_FRAMES;
+
+void
+BenchmarkReplay::LoadFolder( const std::string& folder, int flags, std::vector<IplImage*>& frames )
+{
+	std::vector<std::string> paths;
+	for( boost::filesystem::directory_iterator it( folder ); it != boost::filesystem::directory_iterator(); ++it )
+	{
+		paths.push_back( it->path().string() );
+	}
+	std::sort( paths.begin(), paths.end() );
+
+	for( unsigned int i = 0; i < paths.size() && (int)frames.size() < MAX_FRAMES; i++ )
+	{
+		IplImage* image = cvLoadImage( paths[i].c_str(), flags );
+		if( image )
+		{
+			frames.push_back( image );
+		}
+	}
+}
+
+void
+BenchmarkReplay::ReleaseFrames( std::vector<IplImage*>& frames )
+{
+	for( unsigned int i = 0; i < frames.size(); i++ )
+	{
+		cvReleaseImage( &frames[i] );
+	}
+	frames.clear();
+}
+
+double
+BenchmarkReplay::MillisecondsSince( int64 start )
+{
+	return ( cvGetTickCount() - start ) / ( cvGetTickFrequency() * 1000.0 );
+}
+
+double
+BenchmarkReplay::Percentile( const std::vector<double>& sorted, double fraction )
+{
+	if( sorted.empty() )
+	{
+		return 0;
+	}
+
+	unsigned int index = std::min( (unsigned int)( fraction * sorted.size() ), (unsigned int)sorted.size() - 1 );
+	return sorted[index];
+}
+
+void
+BenchmarkReplay::PrintLatencies( std::vector<double>& latencies )
+{
+	if( latencies.empty() )
+	{
+		return;
+	}
+
+	double sum = 0;
+	for( unsigned int i = 0; i < latencies.size(); i++ )
+	{
+		sum += latencies[i];
+	}
+	std::sort( latencies.begin(), latencies.end() );
+
+	printf( "  frame      p50 %.3f ms, p99 %.3f ms, %.1f fps\n", Percentile( latencies, 0.5 ), Percentile( latencies, 0.99 ),
+			1000.0 * latencies.size() / sum );
+}
@@ -0,0 +1,396 @@
+/*
+ * BlobLabeler.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BlobLabeler.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+void
+BlobTable::Clear()
+{
+	area.clear();
+	perimeter.clear();
+	min_x.clear();
+	max_x.clear();
+	min_y.clear();
+	max_y.clear();
+	centroid_x.clear();
+	centroid_y.clear();
+	mu20.clear();
+	mu02.clear();
+	mu11.clear();
+}
+
+unsigned int
+BlobTable::Append()
+{
+	area.push_back( 0 );
+	perimeter.push_back( 0 );
+	min_x.push_back( 0 );
+	max_x.push_back( 0 );
+	min_y.push_back( 0 );
+	max_y.push_back( 0 );
+	centroid_x.push_back( 0 );
+	centroid_y.push_back( 0 );
+	mu20.push_back( 0 );
+	mu02.push_back( 0 );
+	mu11.push_back( 0 );
+
+	return area.size() - 1;
+}
+
+double
+BlobTable::Orientation( unsigned int i ) const
+{
+	double angle = 0.5 * atan2( 2.0 * mu11[i], mu20[i] - mu02[i] ) * 180.0 / CV_PI;
+
+	if( angle < 0 )
+	{
+		angle += 180.0;
+	}
+
+	return angle;
+}
+
+int
+BlobTable::LargestPerimeter() const
+{
+	int largest = -1;
+
+	for( unsigned int i = 0; i < perimeter.size(); i++ )
+	{
+		if( largest < 0 || perimeter[i] > perimeter[largest] )
+		{
+			largest = i;
+		}
+	}
+
+	return largest;
+}
+
+int
+BlobTable::LargestArea() const
+{
+	int largest = -1;
+
+	for( unsigned int i = 0; i < area.size(); i++ )
+	{
+		if( largest < 0 || area[i] > area[largest] )
+		{
+			largest = i;
+		}
+	}
+
+	return largest;
+}
+
+void
+BlobTable::Scale( int scale )
+{
+	if( scale == 1 )
+	{
+		return;
+	}
+
+	/**
+	 * A pixel of the downscaled image covers a scale x scale block of the full image, so bounding
+	 * boxes grow to the outer edges of their blocks and centroids move to the centre of theirs.
+	 */
+	double offset = ( scale - 1 ) / 2.0;
+	double scale_squared = scale * scale;
+
+	for( unsigned int i = 0; i < area.size(); i++ )
+	{
+		area[i] *= scale * scale;
+		perimeter[i] *= scale;
+		min_x[i] = min_x[i] * scale;
+		max_x[i] = max_x[i] * scale + scale - 1;
+		min_y[i] = min_y[i] * scale;
+		max_y[i] = max_y[i] * scale + scale - 1;
+		centroid_x[i] = centroid_x[i] * scale + offset;
+		centroid_y[i] = centroid_y[i] * scale + offset;
+		mu20[i] *= scale_squared;
+		mu02[i] *= scale_squared;
+		mu11[i] *= scale_squared;
+	}
+}
+
+void
+BlobTable::Set( unsigned int i, const BlobTable& other, unsigned int j )
+{
+	area[i] = other.area[j];
+	perimeter[i] = other.perimeter[j];
+	min_x[i] = other.min_x[j];
+	max_x[i] = other.max_x[j];
+	min_y[i] = other.min_y[j];
+	max_y[i] = other.max_y[j];
+	centroid_x[i] = other.centroid_x[j];
+	centroid_y[i] = other.centroid_y[j];
+	mu20[i] = other.mu20[j];
+	mu02[i] = other.mu02[j];
+	mu11[i] = other.mu11[j];
+}
+
+BlobLabeler::BlobLabeler()
+{
+	m_min_area = 0;
+	m_max_area = INT_MAX;
+}
+
+BlobLabeler::~BlobLabeler()
+{
+}
+
+void
+BlobLabeler::SetAreaLimits( int min_area, int max_area )
+{
+	m_min_area = min_area;
+	m_max_area = max_area;
+}
+
+unsigned int
+BlobLabeler::Label( const IplImage* mask, BlobTable& blobs )
+{
+	blobs.Clear();
+
+	if( !mask || mask->depth != IPL_DEPTH_8U || mask->nChannels != 1 )
+	{
+		return 0;
+	}
+
+	CvRect roi = cvGetImageROI( mask );
+	int width = roi.width;
+	int height = roi.height;
+
+	m_previous_row.assign( width, -1 );
+	m_current_row.assign( width, -1 );
+
+	m_parent.clear();
+	m_area.clear();
+	m_perimeter.clear();
+	m_min_x.clear();
+	m_max_x.clear();
+	m_min_y.clear();
+	m_max_y.clear();
+	m_sum_x.clear();
+	m_sum_y.clear();
+	m_sum_xx.clear();
+	m_sum_yy.clear();
+	m_sum_xy.clear();
+
+	for( int row = 0; row < height; row++ )
+	{
+		const unsigned char* pixels = (const unsigned char*)( mask->imageData + ( roi.y + row ) * mask->widthStep + roi.x );
+		int y = roi.y + row;
+		bool last_row = ( row == height - 1 );
+
+		int x = 0;
+		while( x < width )
+		{
+			if( !pixels[x] )
+			{
+				// The bottom edge of a blob pixel directly above us.
+				int above = m_previous_row[x];
+				if( above >= 0 )
+				{
+					m_perimeter[above]++;
+				}
+
+				m_current_row[x] = -1;
+				x++;
+				continue;
+			}
+
+			int x0 = x;
+			while( x < width && pixels[x] )
+			{
+				x++;
+			}
+			int x1 = x - 1;
+
+			/**
+			 * With 8-connectivity the run touches every labeled pixel of the previous row between
+			 * one pixel left of its start and one pixel right of its end. The first label found is
+			 * reused and all other ones are joined with it.
+			 */
+			int label = -1;
+			int last_above = -1;
+			int first = std::max( x0 - 1, 0 );
+			int last = std::min( x1 + 1, width - 1 );
+			for( int i = first; i <= last; i++ )
+			{
+				int above = m_previous_row[i];
+				if( above >= 0 && above != last_above )
+				{
+					if( label < 0 )
+					{
+						label = above;
+					}
+					else
+					{
+						Union( label, above );
+					}
+					last_above = above;
+				}
+			}
+
+			if( label < 0 )
+			{
+				label = NewLabel();
+			}
+
+			// The left and right end of the run are always on the blob border.
+			int perimeter = 2;
+			for( int i = x0; i <= x1; i++ )
+			{
+				if( m_previous_row[i] < 0 )
+				{
+					perimeter++;
+				}
+				m_current_row[i] = label;
+			}
+
+			if( last_row )
+			{
+				perimeter += x1 - x0 + 1;
+			}
+
+			m_perimeter[label] += perimeter;
+			AddRun( label, roi.x + x0, roi.x + x1, y );
+		}
+
+		m_previous_row.swap( m_current_row );
+	}
+
+	/**
+	 * A root always has the smallest label of its tree, so visiting the labels in increasing order
+	 * merges every child into a root that still only holds its own features.
+	 */
+	int labels = m_parent.size();
+	for( int label = 0; label < labels; label++ )
+	{
+		int root = Find( label );
+		if( root != label )
+		{
+			Merge( label, root );
+		}
+	}
+
+	for( int label = 0; label < labels; label++ )
+	{
+		if( m_parent[label] != label || m_area[label] < m_min_area || m_area[label] > m_max_area )
+		{
+			continue;
+		}
+
+		unsigned int i = blobs.Append();
+		double area = m_area[label];
+		double centroid_x = m_sum_x[label] / area;
+		double centroid_y = m_sum_y[label] / area;
+
+		blobs.area[i] = m_area[label];
+		blobs.perimeter[i] = m_perimeter[label];
+		blobs.min_x[i] = m_min_x[label];
+		blobs.max_x[i] = m_max_x[label];
+		blobs.min_y[i] = m_min_y[label];
+		blobs.max_y[i] = m_max_y[label];
+		blobs.centroid_x[i] = centroid_x;
+		blobs.centroid_y[i] = centroid_y;
+		blobs.mu20[i] = m_sum_xx[label] / area - centroid_x * centroid_x;
+		blobs.mu02[i] = m_sum_yy[label] / area - centroid_y * centroid_y;
+		blobs.mu11[i] = m_sum_xy[label] / area - centroid_x * centroid_y;
+	}
+
+	return blobs.Size();
+}
+
+int
+BlobLabeler::NewLabel()
+{
+	int label = m_parent.size();
+
+	m_parent.push_back( label );
+	m_area.push_back( 0 );
+	m_perimeter.push_back( 0 );
+	m_min_x.push_back( INT_MAX );
+	m_max_x.push_back( INT_MIN );
+	m_min_y.push_back( INT_MAX );
+	m_max_y.push_back( INT_MIN );
+	m_sum_x.push_back( 0 );
+	m_sum_y.push_back( 0 );
+	m_sum_xx.push_back( 0 );
+	m_sum_yy.push_back( 0 );
+	m_sum_xy.push_back( 0 );
+
+	return label;
+}
+
+int
+BlobLabeler::Find( int label )
+{
+	while( m_parent[label] != label )
+	{
+		m_parent[label] = m_parent[m_parent[label]];
+		label = m_parent[label];
+	}
+
+	return label;
+}
+
+void
+BlobLabeler::Union( int a, int b )
+{
+	a = Find( a );
+	b = Find( b );
+
+	if( a < b )
+	{
+		m_parent[b] = a;
+	}
+	else if( b < a )
+	{
+		m_parent[a] = b;
+	}
+}
+
+void
+BlobLabeler::AddRun( int label, int x0, int x1, int y )
+{
+	double n = x1 - x0 + 1;
+
+	// Sums of x and x^2 over the run in closed form.
+	double sum_x = ( x0 + x1 ) * n / 2.0;
+	double sum_xx = ( x1 * ( x1 + 1.0 ) * ( 2.0 * x1 + 1.0 ) - ( x0 - 1.0 ) * x0 * ( 2.0 * x0 - 1.0 ) ) / 6.0;
+
+	m_area[label] += x1 - x0 + 1;
+	m_min_x[label] = std::min( m_min_x[label], x0 );
+	m_max_x[label] = std::max( m_max_x[label], x1 );
+	m_min_y[label] = std::min( m_min_y[label], y );
+	m_max_y[label] = std::max( m_max_y[label], y );
+	m_sum_x[label] += sum_x;
+	m_sum_y[label] += n * y;
+	m_sum_xx[label] += sum_xx;
+	m_sum_yy[label] += n * y * y;
+	m_sum_xy[label] += sum_x * y;
+}
+
+void
+BlobLabeler::Merge( int from, int to )
+{
+	m_area[to] += m_area[from];
+	m_perimeter[to] += m_perimeter[from];
+	m_min_x[to] = std::min( m_min_x[to], m_min_x[from] );
+	m_max_x[to] = std::max( m_max_x[to], m_max_x[from] );
+	m_min_y[to] = std::min( m_min_y[to], m_min_y[from] );
+	m_max_y[to] = std::max( m_max_y[to], m_max_y[from] );
+	m_sum_x[to] += m_sum_x[from];
+	m_sum_y[to] += m_sum_y[from];
+	m_sum_xx[to] += m_sum_xx[from];
+	m_sum_yy[to] += m_sum_yy[from];
+	m_sum_xy[to] += m_sum_xy[from];
+}
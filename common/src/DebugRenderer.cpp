@@ -0,0 +1,334 @@
+/*
+ * DebugRenderer.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "DebugRenderer.h"
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+DebugRenderer::DebugRenderer( ros::NodeHandle& node_handler ) :
+	m_node_handler( node_handler )
+{
+	m_running = false;
+	m_pending = false;
+	m_period = 0.2;
+
+	m_mask = NULL;
+	m_background = NULL;
+	m_bgr = NULL;
+	m_mask_bgr = NULL;
+	m_blob_image = NULL;
+	m_display = NULL;
+
+	memset( &m_overlay.window, 0, sizeof( m_overlay.window ) );
+	m_overlay.has_target = false;
+	m_overlay.has_intercept = false;
+}
+
+DebugRenderer::~DebugRenderer()
+{
+	Stop();
+
+	IplImage** images[] = { &m_mask, &m_background, &m_bgr, &m_mask_bgr, &m_blob_image, &m_display };
+	for( unsigned int i = 0; i < sizeof( images ) / sizeof( images[0] ); i++ )
+	{
+		if( *images[i] )
+		{
+			cvReleaseImage( images[i] );
+		}
+	}
+}
+
+void
+DebugRenderer::Start( const std::string& topic )
+{
+	if( IsRunning() )
+	{
+		return;
+	}
+
+	m_publisher = m_node_handler.advertise<sensor_msgs::Image>( topic, 1 );
+
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_running = true;
+		m_pending = false;
+		m_last_snapshot = ros::WallTime();
+	}
+
+	m_thread = boost::thread( boost::bind( &DebugRenderer::Run, this ) );
+	ROS_INFO( "Publishing the visual servoing display on %s", topic.c_str() );
+}
+
+void
+DebugRenderer::Stop()
+{
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_running = false;
+	}
+	m_condition.notify_all();
+
+	if( m_thread.joinable() )
+	{
+		m_thread.join();
+	}
+
+	m_publisher.shutdown();
+}
+
+bool
+DebugRenderer::IsRunning() const
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	return m_running;
+}
+
+void
+DebugRenderer::SetRate( double rate )
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	m_period = 1.0 / std::max( rate, 0.1 );
+}
+
+void
+DebugRenderer::SetBackground( const IplImage* background )
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	if( m_background )
+	{
+		cvReleaseImage( &m_background );
+	}
+
+	if( background )
+	{
+		m_background = cvCloneImage( background );
+	}
+}
+
+bool
+DebugRenderer::IsSnapshotDue()
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	if( !m_running || m_pending || m_publisher.getNumSubscribers() == 0 )
+	{
+		return false;
+	}
+
+	return m_last_snapshot.isZero() || ( ros::WallTime::now() - m_last_snapshot ).toSec() >= m_period;
+}
+
+void
+DebugRenderer::TakeSnapshot( const ImageFrame& frame, const IplImage* mask, const DebugOverlay& overlay )
+{
+	// The background thread is idle until m_pending is set, so the snapshot can be written freely.
+	frame.CopyTo( m_frame_buffer, m_frame );
+	cvCopy( mask, Reserve( m_mask, cvGetSize( mask ), 1 ) );
+	m_overlay = overlay;
+
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_pending = true;
+		m_last_snapshot = ros::WallTime::now();
+	}
+	m_condition.notify_all();
+}
+
+void
+DebugRenderer::Run()
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	while( m_running )
+	{
+		if( !m_pending )
+		{
+			m_condition.wait( lock );
+			continue;
+		}
+
+		lock.unlock();
+		Render();
+		lock.lock();
+
+		m_pending = false;
+	}
+}
+
+void
+DebugRenderer::Render()
+{
+	if( !m_frame.IsValid() )
+	{
+		return;
+	}
+
+	CvSize size = m_frame.GetSize();
+
+	IplImage* bgr = Reserve( m_bgr, size, 3 );
+	m_frame.ConvertToBgr( bgr );
+
+	/**
+	 * The blob image shows the mask (which may be downscaled) in blue at the size of the frame, with
+	 * the overlay on top.
+	 */
+	IplImage* blob_image = Reserve( m_blob_image, size, 3 );
+	IplImage* mask_bgr = Reserve( m_mask_bgr, cvGetSize( m_mask ), 3 );
+	cvSetZero( mask_bgr );
+	cvSet( mask_bgr, CV_RGB( 0, 0, 255 ), m_mask );
+	cvResize( mask_bgr, blob_image, CV_INTER_NN );
+
+	DrawOverlay( blob_image, m_overlay );
+
+	IplImage* images[3];
+	int count = 0;
+	images[count++] = bgr;
+	if( m_background )
+	{
+		images[count++] = m_background;
+	}
+	images[count++] = blob_image;
+
+	IplImage* display = Compose( count, images );
+
+	m_message.header.stamp = ros::Time::now();
+	m_message.height = display->height;
+	m_message.width = display->width;
+	m_message.encoding = "bgr8";
+	m_message.is_bigendian = 0;
+	m_message.step = display->widthStep;
+	m_message.data.assign( (unsigned char*)display->imageData,
+						   (unsigned char*)display->imageData + display->widthStep * display->height );
+
+	m_publisher.publish( m_message );
+}
+
+void
+DebugRenderer::DrawOverlay( IplImage* image, const DebugOverlay& overlay )
+{
+	// Setting up fonts for overlay information.
+	CvFont font;
+	cvInitFont( &font, CV_FONT_HERSHEY_SIMPLEX, 1.0, 1.0, 0, 1, CV_AA );
+
+	CvFont small_font;
+	cvInitFont( &small_font, CV_FONT_HERSHEY_SIMPLEX, 0.5, 0.5, 0, 1, CV_AA );
+
+	cvRectangle( image, cvPoint( overlay.window.x, overlay.window.y ),
+				 cvPoint( overlay.window.x + overlay.window.width - 1, overlay.window.y + overlay.window.height - 1 ),
+				 CV_RGB( 128, 128, 128 ), 1 );
+
+	cvLine( image, cvPoint( 0, overlay.center.y ), cvPoint( image->width, overlay.center.y ), CV_RGB( 255, 0, 0 ), 2, 0 );
+	cvLine( image, cvPoint( overlay.center.x, 0 ), cvPoint( overlay.center.x, image->height ), CV_RGB( 255, 0, 0 ), 2, 0 );
+
+	for( unsigned int i = 0; i < overlay.object_boxes.size(); i++ )
+	{
+		const CvRect& box = overlay.object_boxes[i];
+		cvRectangle( image, cvPoint( box.x, box.y ), cvPoint( box.x + box.width - 1, box.y + box.height - 1 ), CV_RGB( 255, 255, 0 ), 1 );
+
+		std::string id_str = boost::lexical_cast<std::string>( overlay.object_ids[i] );
+		cvPutText( image, id_str.c_str(), cvPoint( box.x, box.y - 4 ), &small_font, CV_RGB( 255, 255, 0 ) );
+	}
+
+	if( overlay.has_target )
+	{
+		//  Draw the blob we are tracking as well as a circle to represent the centroid of that object.
+		const CvRect& box = overlay.target_box;
+		cvRectangle( image, cvPoint( box.x, box.y ), cvPoint( box.x + box.width - 1, box.y + box.height - 1 ), CV_RGB( 255, 0, 0 ), 2 );
+		cvCircle( image, overlay.tracked, 10, CV_RGB( 255, 0, 0 ), 2 );
+	}
+
+	if( overlay.has_intercept )
+	{
+		cvCircle( image, overlay.intercept, 10, CV_RGB( 0, 255, 0 ), 2 );
+	}
+
+	cvRectangle( image, cvPoint( 0, image->height - 40 ), cvPoint( image->width, image->height ), CV_RGB( 0, 0, 0 ), -1 );
+
+	std::string x_str = "X: ";
+	x_str += boost::lexical_cast<std::string>( overlay.x_offset );
+
+	std::string y_str = "Y: ";
+	y_str += boost::lexical_cast<std::string>( overlay.y_offset );
+
+	std::string rot_str = "Rotation: ";
+	rot_str += boost::lexical_cast<std::string>( overlay.rot_offset );
+
+	cvPutText( image, x_str.c_str(), cvPoint( 10, image->height - 10 ), &font, CV_RGB( 255, 0, 0 ) );
+	cvPutText( image, y_str.c_str(),  cvPoint( 185, image->height - 10 ), &font, CV_RGB( 255, 0, 0 ) );
+	cvPutText( image, rot_str.c_str(), cvPoint( 350, image->height - 10 ), &font, CV_RGB( 255, 0, 0 ) );
+}
+
+IplImage*
+DebugRenderer::Compose( int count, IplImage** images )
+{
+	// w - Maximum number of images in a row
+	// h - Maximum number of images in a column
+	int w, h;
+	int size;
+
+	// Determine the size of the image, and the number of rows/cols from the number of images.
+	if( count == 1 )
+	{
+		w = h = 1;
+		size = 300;
+	}
+	else if( count == 2 )
+	{
+		w = 2; h = 1;
+		size = 300;
+	}
+	else
+	{
+		w = 2; h = 2;
+		size = 350;
+	}
+
+	IplImage* display = Reserve( m_display, cvSize( 50 + size * w, 60 + size * h ), 3 );
+	cvSetZero( display );
+
+	for( int i = 0, m = 20, n = 20; i < count; i++, m += ( 20 + size ) )
+	{
+		IplImage* image = images[i];
+
+		// Find whether height or width is greater in order to resize the image
+		int max = std::max( image->width, image->height );
+
+		// Find the scaling factor to resize the image
+		float scale = (float)max / size;
+
+		// Used to Align the images
+		if( i % w == 0 && m != 20 )
+		{
+			m = 20;
+			n += 20 + size;
+		}
+
+		// Resize the input image and copy it to the Single Big Image
+		cvSetImageROI( display, cvRect( m, n, (int)( image->width / scale ), (int)( image->height / scale ) ) );
+		cvResize( image, display );
+		cvResetImageROI( display );
+	}
+
+	return display;
+}
+
+IplImage*
+DebugRenderer::Reserve( IplImage*& image, CvSize size, int channels )
+{
+	if( image && ( image->width != size.width || image->height != size.height || image->nChannels != channels ) )
+	{
+		cvReleaseImage( &image );
+	}
+
+	if( !image )
+	{
+		image = cvCreateImage( size, IPL_DEPTH_8U, channels );
+	}
+
+	return image;
+}
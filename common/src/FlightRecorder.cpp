@@ -0,0 +1,176 @@
+/*
+ * FlightRecorder.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Identifies the files written by Dump(). The version changes whenever FlightRecord does.
+ */
+const static char g_magic[4] = { 'V', 'S', 'F', 'R' };
+const static uint32_t g_version = 1;
+
+FlightRecorder::FlightRecorder( unsigned int capacity )
+{
+	uint32_t size = 1;
+	while( size < capacity )
+	{
+		size <<= 1;
+	}
+
+	FlightRecord empty;
+	memset( &empty, 0, sizeof( empty ) );
+
+	m_records.assign( size, empty );
+	m_mask = size - 1;
+	m_session = 0;
+	m_written = 0;
+}
+
+FlightRecorder::~FlightRecorder()
+{
+}
+
+void
+FlightRecorder::BeginSession()
+{
+	m_session++;
+}
+
+void
+FlightRecorder::Record( const FlightRecord& record )
+{
+	uint32_t written = m_written;
+
+	FlightRecord& slot = m_records[written & m_mask];
+	slot = record;
+	slot.session = m_session;
+	slot.frame = written;
+
+	// The record has to be in its slot before a reader can see that it is there.
+	__sync_synchronize();
+	m_written = written + 1;
+}
+
+void
+FlightRecorder::Read( std::vector<FlightRecord>& records ) const
+{
+	uint32_t capacity = m_records.size();
+
+	uint32_t written = m_written;
+	__sync_synchronize();
+
+	uint32_t first = ( written > capacity ) ? written - capacity : 0;
+	records.clear();
+	for( uint32_t i = first; i < written; i++ )
+	{
+		records.push_back( m_records[i & m_mask] );
+	}
+
+	/**
+	 * The recorder may have moved on while the records were copied. Everything up to the slot that
+	 * is being written now may have been overwritten, so those records are dropped.
+	 */
+	__sync_synchronize();
+	uint32_t now = m_written;
+	uint32_t valid = ( now >= capacity ) ? now - capacity + 1 : 0;
+	if( valid > first )
+	{
+		records.erase( records.begin(), records.begin() + std::min<uint32_t>( valid - first, records.size() ) );
+	}
+}
+
+bool
+FlightRecorder::Dump( const std::string& path ) const
+{
+	std::vector<FlightRecord> records;
+	Read( records );
+
+	FILE* file = fopen( path.c_str(), "wb" );
+	if( !file )
+	{
+		return false;
+	}
+
+	FlightRecorderHeader header;
+	memcpy( header.magic, g_magic, sizeof( header.magic ) );
+	header.version = g_version;
+	header.record_size = sizeof( FlightRecord );
+	header.count = records.size();
+
+	bool written = fwrite( &header, sizeof( header ), 1, file ) == 1;
+	if( written && !records.empty() )
+	{
+		written = fwrite( &records[0], sizeof( FlightRecord ), records.size(), file ) == records.size();
+	}
+
+	return ( fclose( file ) == 0 ) && written;
+}
+
+bool
+FlightRecorder::Load( const std::string& path, std::vector<FlightRecord>& records )
+{
+	records.clear();
+
+	FILE* file = fopen( path.c_str(), "rb" );
+	if( !file )
+	{
+		return false;
+	}
+
+	FlightRecorderHeader header;
+	bool valid = fread( &header, sizeof( header ), 1, file ) == 1 &&
+				 memcmp( header.magic, g_magic, sizeof( header.magic ) ) == 0 &&
+				 header.version == g_version &&
+				 header.record_size == sizeof( FlightRecord );
+
+	/**
+	 * The count is checked against the size of the file before anything is allocated, so that a
+	 * truncated or damaged file cannot make us reserve gigabytes for records that are not there.
+	 */
+	if( valid )
+	{
+		long start = ftell( file );
+		valid = start >= 0 && fseek( file, 0, SEEK_END ) == 0;
+
+		long end = valid ? ftell( file ) : -1;
+		valid = valid && end >= start && fseek( file, start, SEEK_SET ) == 0 &&
+				header.count <= (unsigned long)( end - start ) / sizeof( FlightRecord );
+	}
+
+	if( valid && header.count > 0 )
+	{
+		records.resize( header.count );
+		valid = fread( &records[0], sizeof( FlightRecord ), header.count, file ) == header.count;
+	}
+
+	fclose( file );
+
+	if( !valid )
+	{
+		records.clear();
+	}
+	return valid;
+}
+
+const char*
+FlightRecorder::GetFlagName( Flag flag )
+{
+	switch( flag )
+	{
+		case FOUND:				return "found";
+		case TOO_CLOSE:			return "too_close";
+		case DONE_X:			return "done_x";
+		case DONE_Y:			return "done_y";
+		case DONE_ROTATION:		return "done_rotation";
+		case BASE_SENT:			return "base_sent";
+		case ARM_SENT:			return "arm_sent";
+		default:				return "unknown";
+	}
+}
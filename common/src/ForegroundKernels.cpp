@@ -0,0 +1,821 @@
+/*
+ * ForegroundKernels.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ForegroundKernels.h"
+
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define FOREGROUND_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+/*
+ * Fixed point weights of cvCvtColor( CV_BGR2GRAY ): gray = ( 1868 B + 9617 G + 4899 R + 2^13 ) >> 14
+ */
+const int gray_shift = 14;
+const int gray_blue = 1868;
+const int gray_green = 9617;
+const int gray_red = 4899;
+const int gray_round = 1 << ( gray_shift - 1 );
+
+typedef void ( *GrayRowFunction )( const unsigned char* bgr, unsigned char* gray, int width );
+typedef void ( *ThresholdRowFunction )( const unsigned char* gray, const unsigned char* background,
+										unsigned char threshold, unsigned char* mask, int width );
+typedef void ( *ForegroundRowFunction )( const unsigned char* bgr, const unsigned char* background,
+										 unsigned char threshold, unsigned char* mask,
+										 unsigned int* histogram, int width );
+typedef void ( *LumaRowFunction )( const unsigned char* packed, int offset, unsigned char* gray, int width );
+typedef void ( *AdaptiveRowFunction )( const unsigned char* gray, unsigned short* model, unsigned char threshold,
+									   int shift, bool update, unsigned char* mask, int width );
+
+/*
+ * The adaptive background model: ADAPTIVE_DARK for a pixel that is always dark, zero for one that
+ * never is. The difference to the target always fits into a signed 16 bit word.
+ */
+const int adaptive_dark = ForegroundKernels::ADAPTIVE_DARK;
+const int adaptive_half = 128 << 7;
+
+inline unsigned char
+GrayPixel( const unsigned char* bgr )
+{
+	return (unsigned char)( ( bgr[0] * gray_blue + bgr[1] * gray_green + bgr[2] * gray_red + gray_round ) >> gray_shift );
+}
+
+inline unsigned char
+MaskPixel( unsigned char gray, const unsigned char* background, int x, unsigned char threshold )
+{
+	int value = ( gray <= threshold ) ? 255 : 0;
+
+	if( background )
+	{
+		value = std::max( 0, value - background[x] );
+	}
+
+	return (unsigned char)value;
+}
+
+/*
+ * Scalar kernels, these are also used for the pixels at the end of a row that do not fill a whole
+ * vector.
+ */
+void
+GrayRowScalar( const unsigned char* bgr, unsigned char* gray, int width )
+{
+	for( int x = 0; x < width; x++ )
+	{
+		gray[x] = GrayPixel( bgr + 3 * x );
+	}
+}
+
+void
+LumaRowScalar( const unsigned char* packed, int offset, unsigned char* gray, int width )
+{
+	for( int x = 0; x < width; x++ )
+	{
+		gray[x] = packed[2 * x + offset];
+	}
+}
+
+void
+ThresholdRowScalar( const unsigned char* gray, const unsigned char* background,
+					unsigned char threshold, unsigned char* mask, int width )
+{
+	for( int x = 0; x < width; x++ )
+	{
+		mask[x] = MaskPixel( gray[x], background, x, threshold );
+	}
+}
+
+void
+ForegroundRowScalar( const unsigned char* bgr, const unsigned char* background,
+					 unsigned char threshold, unsigned char* mask,
+					 unsigned int* histogram, int width )
+{
+	for( int x = 0; x < width; x++ )
+	{
+		unsigned char gray = GrayPixel( bgr + 3 * x );
+
+		if( histogram )
+		{
+			histogram[gray]++;
+		}
+
+		mask[x] = MaskPixel( gray, background, x, threshold );
+	}
+}
+
+void
+AdaptiveRowScalar( const unsigned char* gray, unsigned short* model, unsigned char threshold,
+				   int shift, bool update, unsigned char* mask, int width )
+{
+	for( int x = 0; x < width; x++ )
+	{
+		bool dark = gray[x] <= threshold;
+		int value = model[x];
+
+		mask[x] = ( dark && value < adaptive_half ) ? 255 : 0;
+
+		if( update )
+		{
+			model[x] = (unsigned short)( value + ( ( ( dark ? adaptive_dark : 0 ) - value ) >> shift ) );
+		}
+	}
+}
+
+#ifdef FOREGROUND_KERNELS_X86
+
+/*
+ * Splits 16 interleaved BGR pixels into one vector per channel.
+ */
+__attribute__(( target( "ssse3" ) )) inline void
+Deinterleave16( const unsigned char* bgr, __m128i& blue, __m128i& green, __m128i& red )
+{
+	const __m128i v0 = _mm_loadu_si128( (const __m128i*)( bgr ) );
+	const __m128i v1 = _mm_loadu_si128( (const __m128i*)( bgr + 16 ) );
+	const __m128i v2 = _mm_loadu_si128( (const __m128i*)( bgr + 32 ) );
+
+	blue = _mm_or_si128( _mm_or_si128(
+			_mm_shuffle_epi8( v0, _mm_setr_epi8( 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 ) ),
+			_mm_shuffle_epi8( v1, _mm_setr_epi8( -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 ) ) ),
+			_mm_shuffle_epi8( v2, _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 ) ) );
+	green = _mm_or_si128( _mm_or_si128(
+			_mm_shuffle_epi8( v0, _mm_setr_epi8( 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 ) ),
+			_mm_shuffle_epi8( v1, _mm_setr_epi8( -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 ) ) ),
+			_mm_shuffle_epi8( v2, _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 ) ) );
+	red = _mm_or_si128( _mm_or_si128(
+			_mm_shuffle_epi8( v0, _mm_setr_epi8( 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 ) ),
+			_mm_shuffle_epi8( v1, _mm_setr_epi8( -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 ) ) ),
+			_mm_shuffle_epi8( v2, _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 ) ) );
+}
+
+/*
+ * Computes the gray value of 16 pixels. The blue/green and red/rounding pairs are multiplied and
+ * added in one step with pmaddwd, which keeps the exact 32 bit fixed point result.
+ */
+__attribute__(( target( "ssse3" ) )) inline __m128i
+Gray16Sse( const unsigned char* bgr )
+{
+	__m128i blue, green, red;
+	Deinterleave16( bgr, blue, green, red );
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i blue_green = _mm_setr_epi16( gray_blue, gray_green, gray_blue, gray_green, gray_blue, gray_green, gray_blue, gray_green );
+	const __m128i red_round = _mm_setr_epi16( gray_red, 1, gray_red, 1, gray_red, 1, gray_red, 1 );
+	const __m128i round = _mm_set1_epi16( gray_round );
+
+	__m128i result[2];
+	for( int half = 0; half < 2; half++ )
+	{
+		__m128i b = half ? _mm_unpackhi_epi8( blue, zero ) : _mm_unpacklo_epi8( blue, zero );
+		__m128i g = half ? _mm_unpackhi_epi8( green, zero ) : _mm_unpacklo_epi8( green, zero );
+		__m128i r = half ? _mm_unpackhi_epi8( red, zero ) : _mm_unpacklo_epi8( red, zero );
+
+		__m128i low = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( b, g ), blue_green ),
+									 _mm_madd_epi16( _mm_unpacklo_epi16( r, round ), red_round ) );
+		__m128i high = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( b, g ), blue_green ),
+									  _mm_madd_epi16( _mm_unpackhi_epi16( r, round ), red_round ) );
+
+		result[half] = _mm_packs_epi32( _mm_srli_epi32( low, gray_shift ), _mm_srli_epi32( high, gray_shift ) );
+	}
+
+	return _mm_packus_epi16( result[0], result[1] );
+}
+
+/*
+ * Thresholds 16 gray values and removes the background. Unsigned 'gray <= threshold' is computed as
+ * 'min( gray, threshold ) == gray'.
+ */
+__attribute__(( target( "ssse3" ) )) inline __m128i
+Mask16Sse( __m128i gray, const unsigned char* background, __m128i threshold )
+{
+	__m128i mask = _mm_cmpeq_epi8( _mm_min_epu8( gray, threshold ), gray );
+
+	if( background )
+	{
+		mask = _mm_subs_epu8( mask, _mm_loadu_si128( (const __m128i*)background ) );
+	}
+
+	return mask;
+}
+
+__attribute__(( target( "ssse3" ) )) void
+GrayRowSse( const unsigned char* bgr, unsigned char* gray, int width )
+{
+	int x = 0;
+	for( ; x + 16 <= width; x += 16 )
+	{
+		_mm_storeu_si128( (__m128i*)( gray + x ), Gray16Sse( bgr + 3 * x ) );
+	}
+
+	GrayRowScalar( bgr + 3 * x, gray + x, width - x );
+}
+
+/*
+ * Keeps every other byte of 16 packed pixels (32 bytes), starting at the provided offset. Taking
+ * the low or the high byte of every 16 bit word and packing them back together does this without
+ * a shuffle.
+ */
+__attribute__(( target( "ssse3" ) )) void
+LumaRowSse( const unsigned char* packed, int offset, unsigned char* gray, int width )
+{
+	const __m128i low_bytes = _mm_set1_epi16( 0x00FF );
+
+	int x = 0;
+	for( ; x + 16 <= width; x += 16 )
+	{
+		__m128i first = _mm_loadu_si128( (const __m128i*)( packed + 2 * x ) );
+		__m128i second = _mm_loadu_si128( (const __m128i*)( packed + 2 * x + 16 ) );
+
+		if( offset )
+		{
+			first = _mm_srli_epi16( first, 8 );
+			second = _mm_srli_epi16( second, 8 );
+		}
+		else
+		{
+			first = _mm_and_si128( first, low_bytes );
+			second = _mm_and_si128( second, low_bytes );
+		}
+
+		_mm_storeu_si128( (__m128i*)( gray + x ), _mm_packus_epi16( first, second ) );
+	}
+
+	LumaRowScalar( packed + 2 * x, offset, gray + x, width - x );
+}
+
+__attribute__(( target( "ssse3" ) )) void
+ThresholdRowSse( const unsigned char* gray, const unsigned char* background,
+				 unsigned char threshold, unsigned char* mask, int width )
+{
+	const __m128i threshold_vector = _mm_set1_epi8( (char)threshold );
+
+	int x = 0;
+	for( ; x + 16 <= width; x += 16 )
+	{
+		__m128i values = _mm_loadu_si128( (const __m128i*)( gray + x ) );
+		_mm_storeu_si128( (__m128i*)( mask + x ), Mask16Sse( values, background ? background + x : NULL, threshold_vector ) );
+	}
+
+	ThresholdRowScalar( gray + x, background ? background + x : NULL, threshold, mask + x, width - x );
+}
+
+__attribute__(( target( "ssse3" ) )) void
+ForegroundRowSse( const unsigned char* bgr, const unsigned char* background,
+				  unsigned char threshold, unsigned char* mask,
+				  unsigned int* histogram, int width )
+{
+	const __m128i threshold_vector = _mm_set1_epi8( (char)threshold );
+	unsigned char values[16];
+
+	int x = 0;
+	for( ; x + 16 <= width; x += 16 )
+	{
+		__m128i gray = Gray16Sse( bgr + 3 * x );
+
+		if( histogram )
+		{
+			_mm_storeu_si128( (__m128i*)values, gray );
+			for( int i = 0; i < 16; i++ )
+			{
+				histogram[values[i]]++;
+			}
+		}
+
+		_mm_storeu_si128( (__m128i*)( mask + x ), Mask16Sse( gray, background ? background + x : NULL, threshold_vector ) );
+	}
+
+	ForegroundRowScalar( bgr + 3 * x, background ? background + x : NULL, threshold, mask + x, histogram, width - x );
+}
+
+/*
+ * The model is compared and updated as 16 bit words, the dark bytes (0 or 0xFF) are widened to
+ * words of 0 or 0xFFFF by unpacking them with themselves.
+ */
+__attribute__(( target( "ssse3" ) )) void
+AdaptiveRowSse( const unsigned char* gray, unsigned short* model, unsigned char threshold,
+				int shift, bool update, unsigned char* mask, int width )
+{
+	const __m128i threshold_vector = _mm_set1_epi8( (char)threshold );
+	const __m128i half = _mm_set1_epi16( adaptive_half - 1 );
+	const __m128i dark_value = _mm_set1_epi16( adaptive_dark );
+	const __m128i shift_count = _mm_cvtsi32_si128( shift );
+
+	int x = 0;
+	for( ; x + 16 <= width; x += 16 )
+	{
+		__m128i values = _mm_loadu_si128( (const __m128i*)( gray + x ) );
+		__m128i dark = _mm_cmpeq_epi8( _mm_min_epu8( values, threshold_vector ), values );
+
+		__m128i low = _mm_loadu_si128( (const __m128i*)( model + x ) );
+		__m128i high = _mm_loadu_si128( (const __m128i*)( model + x + 8 ) );
+		__m128i background = _mm_packs_epi16( _mm_cmpgt_epi16( low, half ), _mm_cmpgt_epi16( high, half ) );
+
+		_mm_storeu_si128( (__m128i*)( mask + x ), _mm_andnot_si128( background, dark ) );
+
+		if( update )
+		{
+			__m128i low_target = _mm_and_si128( _mm_unpacklo_epi8( dark, dark ), dark_value );
+			__m128i high_target = _mm_and_si128( _mm_unpackhi_epi8( dark, dark ), dark_value );
+
+			low = _mm_add_epi16( low, _mm_sra_epi16( _mm_sub_epi16( low_target, low ), shift_count ) );
+			high = _mm_add_epi16( high, _mm_sra_epi16( _mm_sub_epi16( high_target, high ), shift_count ) );
+
+			_mm_storeu_si128( (__m128i*)( model + x ), low );
+			_mm_storeu_si128( (__m128i*)( model + x + 8 ), high );
+		}
+	}
+
+	AdaptiveRowScalar( gray + x, model + x, threshold, shift, update, mask + x, width - x );
+}
+
+/*
+ * Computes the gray value of 32 pixels. The channels are split with the 128 bit shuffles and the
+ * arithmetic runs on 256 bit vectors. pmaddwd and packssdw work per 128 bit lane, which happens
+ * to keep the 16 bit results of each half in order, so only the final byte pack needs a permute.
+ */
+__attribute__(( target( "avx2" ) )) inline __m256i
+Gray16WordsAvx2( const unsigned char* bgr )
+{
+	__m128i blue, green, red;
+	Deinterleave16( bgr, blue, green, red );
+
+	const __m256i blue_green = _mm256_setr_epi16( gray_blue, gray_green, gray_blue, gray_green, gray_blue, gray_green, gray_blue, gray_green,
+												  gray_blue, gray_green, gray_blue, gray_green, gray_blue, gray_green, gray_blue, gray_green );
+	const __m256i red_round = _mm256_setr_epi16( gray_red, 1, gray_red, 1, gray_red, 1, gray_red, 1,
+												 gray_red, 1, gray_red, 1, gray_red, 1, gray_red, 1 );
+	const __m256i round = _mm256_set1_epi16( gray_round );
+
+	__m256i b = _mm256_cvtepu8_epi16( blue );
+	__m256i g = _mm256_cvtepu8_epi16( green );
+	__m256i r = _mm256_cvtepu8_epi16( red );
+
+	__m256i low = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( b, g ), blue_green ),
+									_mm256_madd_epi16( _mm256_unpacklo_epi16( r, round ), red_round ) );
+	__m256i high = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( b, g ), blue_green ),
+									 _mm256_madd_epi16( _mm256_unpackhi_epi16( r, round ), red_round ) );
+
+	return _mm256_packs_epi32( _mm256_srli_epi32( low, gray_shift ), _mm256_srli_epi32( high, gray_shift ) );
+}
+
+__attribute__(( target( "avx2" ) )) inline __m256i
+Gray32Avx2( const unsigned char* bgr )
+{
+	return _mm256_permute4x64_epi64( _mm256_packus_epi16( Gray16WordsAvx2( bgr ), Gray16WordsAvx2( bgr + 48 ) ), 0xD8 );
+}
+
+__attribute__(( target( "avx2" ) )) inline __m256i
+Mask32Avx2( __m256i gray, const unsigned char* background, __m256i threshold )
+{
+	__m256i mask = _mm256_cmpeq_epi8( _mm256_min_epu8( gray, threshold ), gray );
+
+	if( background )
+	{
+		mask = _mm256_subs_epu8( mask, _mm256_loadu_si256( (const __m256i*)background ) );
+	}
+
+	return mask;
+}
+
+__attribute__(( target( "avx2" ) )) void
+GrayRowAvx2( const unsigned char* bgr, unsigned char* gray, int width )
+{
+	int x = 0;
+	for( ; x + 32 <= width; x += 32 )
+	{
+		_mm256_storeu_si256( (__m256i*)( gray + x ), Gray32Avx2( bgr + 3 * x ) );
+	}
+
+	GrayRowSse( bgr + 3 * x, gray + x, width - x );
+}
+
+__attribute__(( target( "avx2" ) )) void
+LumaRowAvx2( const unsigned char* packed, int offset, unsigned char* gray, int width )
+{
+	const __m256i low_bytes = _mm256_set1_epi16( 0x00FF );
+
+	int x = 0;
+	for( ; x + 32 <= width; x += 32 )
+	{
+		__m256i first = _mm256_loadu_si256( (const __m256i*)( packed + 2 * x ) );
+		__m256i second = _mm256_loadu_si256( (const __m256i*)( packed + 2 * x + 32 ) );
+
+		if( offset )
+		{
+			first = _mm256_srli_epi16( first, 8 );
+			second = _mm256_srli_epi16( second, 8 );
+		}
+		else
+		{
+			first = _mm256_and_si256( first, low_bytes );
+			second = _mm256_and_si256( second, low_bytes );
+		}
+
+		// packuswb works per 128 bit lane, the permute puts the four quarters back in order.
+		_mm256_storeu_si256( (__m256i*)( gray + x ), _mm256_permute4x64_epi64( _mm256_packus_epi16( first, second ), 0xD8 ) );
+	}
+
+	LumaRowSse( packed + 2 * x, offset, gray + x, width - x );
+}
+
+__attribute__(( target( "avx2" ) )) void
+ThresholdRowAvx2( const unsigned char* gray, const unsigned char* background,
+				  unsigned char threshold, unsigned char* mask, int width )
+{
+	const __m256i threshold_vector = _mm256_set1_epi8( (char)threshold );
+
+	int x = 0;
+	for( ; x + 32 <= width; x += 32 )
+	{
+		__m256i values = _mm256_loadu_si256( (const __m256i*)( gray + x ) );
+		_mm256_storeu_si256( (__m256i*)( mask + x ), Mask32Avx2( values, background ? background + x : NULL, threshold_vector ) );
+	}
+
+	ThresholdRowSse( gray + x, background ? background + x : NULL, threshold, mask + x, width - x );
+}
+
+__attribute__(( target( "avx2" ) )) void
+ForegroundRowAvx2( const unsigned char* bgr, const unsigned char* background,
+				   unsigned char threshold, unsigned char* mask,
+				   unsigned int* histogram, int width )
+{
+	const __m256i threshold_vector = _mm256_set1_epi8( (char)threshold );
+	unsigned char values[32];
+
+	int x = 0;
+	for( ; x + 32 <= width; x += 32 )
+	{
+		__m256i gray = Gray32Avx2( bgr + 3 * x );
+
+		if( histogram )
+		{
+			_mm256_storeu_si256( (__m256i*)values, gray );
+			for( int i = 0; i < 32; i++ )
+			{
+				histogram[values[i]]++;
+			}
+		}
+
+		_mm256_storeu_si256( (__m256i*)( mask + x ), Mask32Avx2( gray, background ? background + x : NULL, threshold_vector ) );
+	}
+
+	ForegroundRowSse( bgr + 3 * x, background ? background + x : NULL, threshold, mask + x, histogram, width - x );
+}
+
+/*
+ * The 256 bit version of AdaptiveRowSse(). The byte pack works per 128 bit lane, so the mask is
+ * put back in order with a permute, and the dark bytes are widened with a sign extension instead
+ * of the unpacks, which would mix up the lanes.
+ */
+__attribute__(( target( "avx2" ) )) void
+AdaptiveRowAvx2( const unsigned char* gray, unsigned short* model, unsigned char threshold,
+				 int shift, bool update, unsigned char* mask, int width )
+{
+	const __m256i threshold_vector = _mm256_set1_epi8( (char)threshold );
+	const __m256i half = _mm256_set1_epi16( adaptive_half - 1 );
+	const __m256i dark_value = _mm256_set1_epi16( adaptive_dark );
+	const __m128i shift_count = _mm_cvtsi32_si128( shift );
+
+	int x = 0;
+	for( ; x + 32 <= width; x += 32 )
+	{
+		__m256i values = _mm256_loadu_si256( (const __m256i*)( gray + x ) );
+		__m256i dark = _mm256_cmpeq_epi8( _mm256_min_epu8( values, threshold_vector ), values );
+
+		__m256i low = _mm256_loadu_si256( (const __m256i*)( model + x ) );
+		__m256i high = _mm256_loadu_si256( (const __m256i*)( model + x + 16 ) );
+		__m256i background = _mm256_permute4x64_epi64( _mm256_packs_epi16( _mm256_cmpgt_epi16( low, half ),
+																		   _mm256_cmpgt_epi16( high, half ) ), 0xD8 );
+
+		_mm256_storeu_si256( (__m256i*)( mask + x ), _mm256_andnot_si256( background, dark ) );
+
+		if( update )
+		{
+			__m256i low_target = _mm256_and_si256( _mm256_cvtepi8_epi16( _mm256_castsi256_si128( dark ) ), dark_value );
+			__m256i high_target = _mm256_and_si256( _mm256_cvtepi8_epi16( _mm256_extracti128_si256( dark, 1 ) ), dark_value );
+
+			low = _mm256_add_epi16( low, _mm256_sra_epi16( _mm256_sub_epi16( low_target, low ), shift_count ) );
+			high = _mm256_add_epi16( high, _mm256_sra_epi16( _mm256_sub_epi16( high_target, high ), shift_count ) );
+
+			_mm256_storeu_si256( (__m256i*)( model + x ), low );
+			_mm256_storeu_si256( (__m256i*)( model + x + 16 ), high );
+		}
+	}
+
+	AdaptiveRowSse( gray + x, model + x, threshold, shift, update, mask + x, width - x );
+}
+
+#endif /* FOREGROUND_KERNELS_X86 */
+
+/*
+ * The kernels that are currently in use.
+ */
+struct Dispatch
+{
+	ForegroundKernels::InstructionSet				instruction_set;
+	GrayRowFunction									gray_row;
+	ThresholdRowFunction							threshold_row;
+	ForegroundRowFunction							foreground_row;
+	LumaRowFunction									luma_row;
+	AdaptiveRowFunction								adaptive_row;
+};
+
+ForegroundKernels::InstructionSet
+BestSupported( ForegroundKernels::InstructionSet requested )
+{
+#ifdef FOREGROUND_KERNELS_X86
+	__builtin_cpu_init();
+
+	if( requested >= ForegroundKernels::AVX2 && __builtin_cpu_supports( "avx2" ) )
+	{
+		return ForegroundKernels::AVX2;
+	}
+
+	if( requested >= ForegroundKernels::SSE && __builtin_cpu_supports( "ssse3" ) )
+	{
+		return ForegroundKernels::SSE;
+	}
+#endif
+
+	return ForegroundKernels::SCALAR;
+}
+
+Dispatch
+MakeDispatch( ForegroundKernels::InstructionSet requested )
+{
+	Dispatch dispatch;
+	dispatch.instruction_set = BestSupported( requested );
+	dispatch.gray_row = GrayRowScalar;
+	dispatch.threshold_row = ThresholdRowScalar;
+	dispatch.foreground_row = ForegroundRowScalar;
+	dispatch.luma_row = LumaRowScalar;
+	dispatch.adaptive_row = AdaptiveRowScalar;
+
+#ifdef FOREGROUND_KERNELS_X86
+	if( dispatch.instruction_set == ForegroundKernels::AVX2 )
+	{
+		dispatch.gray_row = GrayRowAvx2;
+		dispatch.threshold_row = ThresholdRowAvx2;
+		dispatch.foreground_row = ForegroundRowAvx2;
+		dispatch.luma_row = LumaRowAvx2;
+		dispatch.adaptive_row = AdaptiveRowAvx2;
+	}
+	else if( dispatch.instruction_set == ForegroundKernels::SSE )
+	{
+		dispatch.gray_row = GrayRowSse;
+		dispatch.threshold_row = ThresholdRowSse;
+		dispatch.foreground_row = ForegroundRowSse;
+		dispatch.luma_row = LumaRowSse;
+		dispatch.adaptive_row = AdaptiveRowSse;
+	}
+#endif
+
+	return dispatch;
+}
+
+Dispatch g_dispatch = MakeDispatch( ForegroundKernels::AVX2 );
+
+/*
+ * Returns a pointer to the first pixel of row y of the image's region of interest.
+ */
+inline unsigned char*
+Row( const IplImage* image, CvRect roi, int y )
+{
+	return (unsigned char*)( image->imageData + ( roi.y + y ) * image->widthStep + roi.x * image->nChannels );
+}
+
+inline unsigned short*
+Row16( const IplImage* image, CvRect roi, int y )
+{
+	return (unsigned short*)( image->imageData + ( roi.y + y ) * image->widthStep ) + roi.x * image->nChannels;
+}
+
+inline unsigned char
+ClampThreshold( int threshold )
+{
+	return (unsigned char)std::min( 255, std::max( 0, threshold ) );
+}
+
+}
+
+ForegroundKernels::InstructionSet
+ForegroundKernels::GetInstructionSet()
+{
+	return g_dispatch.instruction_set;
+}
+
+ForegroundKernels::InstructionSet
+ForegroundKernels::SetInstructionSet( InstructionSet instruction_set )
+{
+	g_dispatch = MakeDispatch( instruction_set );
+	return g_dispatch.instruction_set;
+}
+
+const char*
+ForegroundKernels::GetName( InstructionSet instruction_set )
+{
+	switch( instruction_set )
+	{
+	case AVX2:
+		return "AVX2";
+	case SSE:
+		return "SSE";
+	default:
+		return "scalar";
+	}
+}
+
+void
+ForegroundKernels::ConvertToGray( const IplImage* bgr, IplImage* gray )
+{
+	CvRect bgr_roi = cvGetImageROI( bgr );
+	CvRect gray_roi = cvGetImageROI( gray );
+
+	for( int y = 0; y < gray_roi.height; y++ )
+	{
+		g_dispatch.gray_row( Row( bgr, bgr_roi, y ), Row( gray, gray_roi, y ), gray_roi.width );
+	}
+}
+
+void
+ForegroundKernels::ExtractLuma( const IplImage* packed, int offset, IplImage* gray )
+{
+	CvRect packed_roi = cvGetImageROI( packed );
+	CvRect gray_roi = cvGetImageROI( gray );
+
+	for( int y = 0; y < gray_roi.height; y++ )
+	{
+		g_dispatch.luma_row( Row( packed, packed_roi, y ), offset, Row( gray, gray_roi, y ), gray_roi.width );
+	}
+}
+
+void
+ForegroundKernels::Histogram( const IplImage* gray, unsigned int* histogram )
+{
+	CvRect roi = cvGetImageROI( gray );
+
+	/**
+	 * Consecutive pixels often have the same value, so counting into four interleaved histograms
+	 * avoids stalling on the increment of the same bin.
+	 */
+	unsigned int partial[4][256];
+	memset( partial, 0, sizeof( partial ) );
+
+	for( int y = 0; y < roi.height; y++ )
+	{
+		const unsigned char* pixels = Row( gray, roi, y );
+
+		int x = 0;
+		for( ; x + 4 <= roi.width; x += 4 )
+		{
+			partial[0][pixels[x]]++;
+			partial[1][pixels[x + 1]]++;
+			partial[2][pixels[x + 2]]++;
+			partial[3][pixels[x + 3]]++;
+		}
+		for( ; x < roi.width; x++ )
+		{
+			partial[0][pixels[x]]++;
+		}
+	}
+
+	for( int i = 0; i < 256; i++ )
+	{
+		histogram[i] = partial[0][i] + partial[1][i] + partial[2][i] + partial[3][i];
+	}
+}
+
+int
+ForegroundKernels::OtsuThreshold( const unsigned int* histogram )
+{
+	/**
+	 * This follows the implementation of cvThreshold() step by step so that both pick the same
+	 * threshold for the same histogram.
+	 */
+	double total = 0;
+	double mu = 0;
+	for( int i = 0; i < 256; i++ )
+	{
+		total += histogram[i];
+		mu += i * (double)histogram[i];
+	}
+
+	if( total == 0 )
+	{
+		return 0;
+	}
+
+	double scale = 1.0 / total;
+	mu *= scale;
+
+	double mu1 = 0;
+	double q1 = 0;
+	double max_sigma = 0;
+	int max_value = 0;
+
+	for( int i = 0; i < 256; i++ )
+	{
+		double p_i = histogram[i] * scale;
+		mu1 *= q1;
+		q1 += p_i;
+		double q2 = 1.0 - q1;
+
+		if( std::min( q1, q2 ) < FLT_EPSILON || std::max( q1, q2 ) > 1.0 - FLT_EPSILON )
+		{
+			continue;
+		}
+
+		mu1 = ( mu1 + i * p_i ) / q1;
+		double mu2 = ( mu - q1 * mu1 ) / q2;
+		double sigma = q1 * q2 * ( mu1 - mu2 ) * ( mu1 - mu2 );
+
+		if( sigma > max_sigma )
+		{
+			max_sigma = sigma;
+			max_value = i;
+		}
+	}
+
+	return max_value;
+}
+
+void
+ForegroundKernels::ThresholdSubtract( const IplImage* gray, const IplImage* background, int threshold, IplImage* mask )
+{
+	CvRect gray_roi = cvGetImageROI( gray );
+	CvRect mask_roi = cvGetImageROI( mask );
+	CvRect background_roi = background ? cvGetImageROI( background ) : mask_roi;
+
+	for( int y = 0; y < mask_roi.height; y++ )
+	{
+		g_dispatch.threshold_row( Row( gray, gray_roi, y ),
+								  background ? Row( background, background_roi, y ) : NULL,
+								  ClampThreshold( threshold ), Row( mask, mask_roi, y ), mask_roi.width );
+	}
+}
+
+void
+ForegroundKernels::ForegroundMask( const IplImage* bgr, const IplImage* background, int threshold,
+								   IplImage* mask, unsigned int* histogram )
+{
+	CvRect bgr_roi = cvGetImageROI( bgr );
+	CvRect mask_roi = cvGetImageROI( mask );
+	CvRect background_roi = background ? cvGetImageROI( background ) : mask_roi;
+
+	if( histogram )
+	{
+		memset( histogram, 0, 256 * sizeof( unsigned int ) );
+	}
+
+	for( int y = 0; y < mask_roi.height; y++ )
+	{
+		g_dispatch.foreground_row( Row( bgr, bgr_roi, y ),
+								   background ? Row( background, background_roi, y ) : NULL,
+								   ClampThreshold( threshold ), Row( mask, mask_roi, y ),
+								   histogram, mask_roi.width );
+	}
+}
+
+void
+ForegroundKernels::AdaptiveSubtract( const IplImage* gray, IplImage* model, int threshold, int shift,
+									 bool update, CvRect frozen, IplImage* mask )
+{
+	CvRect gray_roi = cvGetImageROI( gray );
+	CvRect model_roi = cvGetImageROI( model );
+	CvRect mask_roi = cvGetImageROI( mask );
+	unsigned char clamped = ClampThreshold( threshold );
+	shift = std::min( 15, std::max( 0, shift ) );
+
+	// The frozen columns relative to the region of interest, clipped to it.
+	int frozen_begin = std::min( mask_roi.width, std::max( 0, frozen.x - model_roi.x ) );
+	int frozen_end = std::min( mask_roi.width, std::max( frozen_begin, frozen.x + frozen.width - model_roi.x ) );
+
+	for( int y = 0; y < mask_roi.height; y++ )
+	{
+		const unsigned char* gray_row = Row( gray, gray_roi, y );
+		unsigned short* model_row = Row16( model, model_roi, y );
+		unsigned char* mask_row = Row( mask, mask_roi, y );
+
+		int model_y = model_roi.y + y;
+		if( !update || model_y < frozen.y || model_y >= frozen.y + frozen.height || frozen_begin == frozen_end )
+		{
+			g_dispatch.adaptive_row( gray_row, model_row, clamped, shift, update, mask_row, mask_roi.width );
+			continue;
+		}
+
+		// The row crosses the frozen rectangle, which is masked but not learnt from.
+		g_dispatch.adaptive_row( gray_row, model_row, clamped, shift, true, mask_row, frozen_begin );
+		g_dispatch.adaptive_row( gray_row + frozen_begin, model_row + frozen_begin, clamped, shift, false,
+								 mask_row + frozen_begin, frozen_end - frozen_begin );
+		g_dispatch.adaptive_row( gray_row + frozen_end, model_row + frozen_end, clamped, shift, true,
+								 mask_row + frozen_end, mask_roi.width - frozen_end );
+	}
+}
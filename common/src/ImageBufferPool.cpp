@@ -0,0 +1,105 @@
+/*
+ * ImageBufferPool.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ImageBufferPool.h"
+
+#include <algorithm>
+
+ImageBufferPool::ImageBufferPool()
+{
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+	for( unsigned int i = 0; i < m_images.size(); i++ )
+	{
+		cvReleaseImage( &m_images[i] );
+	}
+}
+
+IplImage*
+ImageBufferPool::Acquire( CvSize size, int depth, int channels, unsigned int* allocations )
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+
+	for( unsigned int i = 0; i < m_free_images.size(); i++ )
+	{
+		IplImage* image = m_free_images[i];
+
+		if( image->width == size.width && image->height == size.height &&
+			image->depth == depth && image->nChannels == channels )
+		{
+			m_free_images[i] = m_free_images.back();
+			m_free_images.pop_back();
+			return image;
+		}
+	}
+
+	/**
+	 * Nothing suitable is free so we need a new image. The free list is grown at the same time so
+	 * that returning the image later never has to reallocate it.
+	 */
+	IplImage* image = cvCreateImage( size, depth, channels );
+	cvSetZero( image );
+	cvSetImageROI( image, cvRect( 0, 0, size.width, size.height ) );
+	m_images.push_back( image );
+	m_free_images.reserve( m_images.size() );
+
+	if( allocations )
+	{
+		( *allocations )++;
+	}
+
+	return image;
+}
+
+void
+ImageBufferPool::Release( IplImage* image )
+{
+	if( !image )
+	{
+		return;
+	}
+
+	ResetRegion( image );
+
+	boost::mutex::scoped_lock lock( m_mutex );
+	m_free_images.push_back( image );
+}
+
+unsigned int
+ImageBufferPool::GetTotalAllocations() const
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	return m_images.size();
+}
+
+void
+ImageBufferPool::SetRegion( IplImage* image, CvRect rect )
+{
+	if( !image->roi )
+	{
+		cvSetImageROI( image, rect );
+		return;
+	}
+
+	int x0 = std::max( 0, rect.x );
+	int y0 = std::max( 0, rect.y );
+	int x1 = std::min( image->width, rect.x + rect.width );
+	int y1 = std::min( image->height, rect.y + rect.height );
+
+	image->roi->coi = 0;
+	image->roi->xOffset = x0;
+	image->roi->yOffset = y0;
+	image->roi->width = std::max( 0, x1 - x0 );
+	image->roi->height = std::max( 0, y1 - y0 );
+}
+
+void
+ImageBufferPool::ResetRegion( IplImage* image )
+{
+	SetRegion( image, cvRect( 0, 0, image->width, image->height ) );
+}
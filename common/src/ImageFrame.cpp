@@ -0,0 +1,235 @@
+/*
+ * ImageFrame.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ImageFrame.h"
+#include "ForegroundKernels.h"
+
+#include <cstring>
+
+ImageFrame::ImageFrame()
+{
+	m_encoding = UNSUPPORTED;
+	m_stamp = 0;
+	memset( &m_image, 0, sizeof( m_image ) );
+}
+
+ImageFrame::~ImageFrame()
+{
+}
+
+ImageFrame::Encoding
+ImageFrame::ParseEncoding( const std::string& encoding )
+{
+	if( encoding == "bgr8" )
+	{
+		return BGR8;
+	}
+	else if( encoding == "rgb8" )
+	{
+		return RGB8;
+	}
+	else if( encoding == "mono8" || encoding == "8UC1" )
+	{
+		return MONO8;
+	}
+	else if( encoding == "yuv422_yuy2" || encoding == "yuyv" )
+	{
+		return YUYV;
+	}
+	else if( encoding == "yuv422" || encoding == "uyvy" )
+	{
+		return UYVY;
+	}
+
+	return UNSUPPORTED;
+}
+
+bool
+ImageFrame::Wrap( const unsigned char* data, int width, int height, int step, Encoding encoding )
+{
+	int channels = 0;
+	switch( encoding )
+	{
+		case BGR8:
+		case RGB8:
+			channels = 3;
+			break;
+		case MONO8:
+			channels = 1;
+			break;
+		case YUYV:
+		case UYVY:
+			channels = 2;
+			break;
+		default:
+			break;
+	}
+
+	if( !data || channels == 0 || width <= 0 || height <= 0 || step < width * channels )
+	{
+		m_encoding = UNSUPPORTED;
+		return false;
+	}
+
+	// Only the header is set up, the pixels stay where they are.
+	cvInitImageHeader( &m_image, cvSize( width, height ), IPL_DEPTH_8U, channels );
+	m_image.imageData = (char*)data;
+	m_image.imageDataOrigin = (char*)data;
+	m_image.widthStep = step;
+	m_image.imageSize = step * height;
+	m_encoding = encoding;
+
+	return true;
+}
+
+bool
+ImageFrame::Wrap( const IplImage* image )
+{
+	if( !image || image->depth != IPL_DEPTH_8U )
+	{
+		m_encoding = UNSUPPORTED;
+		return false;
+	}
+
+	Encoding encoding = UNSUPPORTED;
+	if( image->nChannels == 3 )
+	{
+		encoding = BGR8;
+	}
+	else if( image->nChannels == 1 )
+	{
+		encoding = MONO8;
+	}
+
+	return Wrap( (const unsigned char*)image->imageData, image->width, image->height, image->widthStep, encoding );
+}
+
+bool
+ImageFrame::IsValid() const
+{
+	return m_encoding != UNSUPPORTED;
+}
+
+ImageFrame::Encoding
+ImageFrame::GetEncoding() const
+{
+	return m_encoding;
+}
+
+CvSize
+ImageFrame::GetSize() const
+{
+	return cvSize( m_image.width, m_image.height );
+}
+
+void
+ImageFrame::SetStamp( double stamp )
+{
+	m_stamp = stamp;
+}
+
+double
+ImageFrame::GetStamp() const
+{
+	return m_stamp;
+}
+
+void
+ImageFrame::ExtractGray( IplImage* gray ) const
+{
+	IplImage window = Window( cvGetImageROI( gray ) );
+
+	switch( m_encoding )
+	{
+		case MONO8:
+			cvCopy( &window, gray );
+			break;
+		case YUYV:
+			ForegroundKernels::ExtractLuma( &window, 0, gray );
+			break;
+		case UYVY:
+			ForegroundKernels::ExtractLuma( &window, 1, gray );
+			break;
+		case BGR8:
+			ForegroundKernels::ConvertToGray( &window, gray );
+			break;
+		case RGB8:
+			cvCvtColor( &window, gray, CV_RGB2GRAY );
+			break;
+		default:
+			break;
+	}
+}
+
+bool
+ImageFrame::ExtractForeground( const IplImage* background, int threshold, IplImage* mask, unsigned int* histogram ) const
+{
+	if( m_encoding != BGR8 )
+	{
+		return false;
+	}
+
+	IplImage window = Window( cvGetImageROI( mask ) );
+	ForegroundKernels::ForegroundMask( &window, background, threshold, mask, histogram );
+
+	return true;
+}
+
+void
+ImageFrame::ConvertToBgr( IplImage* bgr ) const
+{
+	IplImage* image = const_cast<IplImage*>( &m_image );
+
+	switch( m_encoding )
+	{
+		case BGR8:
+			cvCopy( image, bgr );
+			break;
+		case RGB8:
+			cvCvtColor( image, bgr, CV_RGB2BGR );
+			break;
+		case MONO8:
+			cvCvtColor( image, bgr, CV_GRAY2BGR );
+			break;
+		case YUYV:
+			cvCvtColor( image, bgr, CV_YUV2BGR_YUYV );
+			break;
+		case UYVY:
+			cvCvtColor( image, bgr, CV_YUV2BGR_UYVY );
+			break;
+		default:
+			break;
+	}
+}
+
+void
+ImageFrame::CopyTo( std::vector<unsigned char>& buffer, ImageFrame& copy ) const
+{
+	if( !IsValid() )
+	{
+		copy.m_encoding = UNSUPPORTED;
+		return;
+	}
+
+	buffer.resize( m_image.widthStep * m_image.height );
+	memcpy( &buffer[0], m_image.imageData, buffer.size() );
+
+	copy.Wrap( &buffer[0], m_image.width, m_image.height, m_image.widthStep, m_encoding );
+	copy.SetStamp( m_stamp );
+}
+
+IplImage
+ImageFrame::Window( CvRect window ) const
+{
+	IplImage header;
+	cvInitImageHeader( &header, cvSize( window.width, window.height ), IPL_DEPTH_8U, m_image.nChannels );
+	header.imageData = m_image.imageData + window.y * m_image.widthStep + window.x * m_image.nChannels;
+	header.imageDataOrigin = header.imageData;
+	header.widthStep = m_image.widthStep;
+	header.imageSize = m_image.widthStep * window.height;
+
+	return header;
+}
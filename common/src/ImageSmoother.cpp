@@ -0,0 +1,383 @@
+/*
+ * ImageSmoother.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ImageSmoother.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	/**
+	 * The coefficients of the recursive Gaussian of Young and van Vliet, normalised so that the
+	 * filter has a gain of one.
+	 */
+	struct RecursiveCoefficients
+	{
+		float										b;
+		float										a1;
+		float										a2;
+		float										a3;
+	};
+
+	RecursiveCoefficients
+	MakeRecursiveCoefficients( double sigma )
+	{
+		double q;
+		if( sigma >= 2.5 )
+		{
+			q = 0.98711 * sigma - 0.96330;
+		}
+		else
+		{
+			q = 3.97156 - 4.14554 * sqrt( 1.0 - 0.26891 * std::max( sigma, 0.5 ) );
+		}
+
+		double q2 = q * q;
+		double q3 = q2 * q;
+		double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+		double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+		double b2 = -( 1.4281 * q2 + 1.26661 * q3 );
+		double b3 = 0.422205 * q3;
+
+		RecursiveCoefficients coefficients;
+		coefficients.a1 = b1 / b0;
+		coefficients.a2 = b2 / b0;
+		coefficients.a3 = b3 / b0;
+		coefficients.b = 1.0 - ( b1 + b2 + b3 ) / b0;
+
+		return coefficients;
+	}
+
+	/**
+	 * Runs the causal and then the anti-causal filter over n values spaced step apart. The border
+	 * values are repeated so that a constant signal stays constant.
+	 */
+	void
+	RecursiveLine( float* data, int n, int step, const RecursiveCoefficients& c )
+	{
+		float w1 = data[0];
+		float w2 = w1;
+		float w3 = w1;
+		for( int i = 0; i < n; i++ )
+		{
+			float w = c.b * data[i * step] + c.a1 * w1 + c.a2 * w2 + c.a3 * w3;
+			data[i * step] = w;
+			w3 = w2;
+			w2 = w1;
+			w1 = w;
+		}
+
+		w1 = data[( n - 1 ) * step];
+		w2 = w1;
+		w3 = w1;
+		for( int i = n - 1; i >= 0; i-- )
+		{
+			float w = c.b * data[i * step] + c.a1 * w1 + c.a2 * w2 + c.a3 * w3;
+			data[i * step] = w;
+			w3 = w2;
+			w2 = w1;
+			w1 = w;
+		}
+	}
+
+	/**
+	 * Runs the vertical filter over all columns of a width x height float image at once, row by
+	 * row, so that the memory is read in order.
+	 */
+	void
+	RecursiveColumns( float* data, int width, int height, const RecursiveCoefficients& c )
+	{
+		for( int y = 0; y < height; y++ )
+		{
+			float* row = data + y * width;
+			const float* w1 = data + std::max( y - 1, 0 ) * width;
+			const float* w2 = data + std::max( y - 2, 0 ) * width;
+			const float* w3 = data + std::max( y - 3, 0 ) * width;
+			if( y == 0 )
+			{
+				// The first row has no history, it is its own steady state.
+				continue;
+			}
+
+			for( int x = 0; x < width; x++ )
+			{
+				row[x] = c.b * row[x] + c.a1 * w1[x] + c.a2 * w2[x] + c.a3 * w3[x];
+			}
+		}
+
+		for( int y = height - 1; y >= 0; y-- )
+		{
+			float* row = data + y * width;
+			const float* w1 = data + std::min( y + 1, height - 1 ) * width;
+			const float* w2 = data + std::min( y + 2, height - 1 ) * width;
+			const float* w3 = data + std::min( y + 3, height - 1 ) * width;
+			if( y == height - 1 )
+			{
+				continue;
+			}
+
+			for( int x = 0; x < width; x++ )
+			{
+				row[x] = c.b * row[x] + c.a1 * w1[x] + c.a2 * w2[x] + c.a3 * w3[x];
+			}
+		}
+	}
+
+	/**
+	 * Fixed point reciprocal of the box size, so that averaging a sum is a multiply and a shift.
+	 */
+	int
+	BoxReciprocal( int radius )
+	{
+		int size = 2 * radius + 1;
+		return ( ( 1 << 16 ) + size / 2 ) / size;
+	}
+
+	/**
+	 * Box filters every row of a width x height image with a kernel of 2 * radius + 1 pixels using
+	 * a running sum. Pixels beyond the border repeat the border pixel.
+	 */
+	void
+	BoxRows( const unsigned char* src, int src_step, unsigned char* dst, int dst_step,
+			 int width, int height, int radius )
+	{
+		int reciprocal = BoxReciprocal( radius );
+
+		for( int y = 0; y < height; y++ )
+		{
+			const unsigned char* in = src + y * src_step;
+			unsigned char* out = dst + y * dst_step;
+
+			int sum = ( radius + 1 ) * in[0];
+			for( int i = 1; i <= radius; i++ )
+			{
+				sum += in[std::min( i, width - 1 )];
+			}
+
+			for( int x = 0; x < width; x++ )
+			{
+				out[x] = ( sum * reciprocal + ( 1 << 15 ) ) >> 16;
+				sum += in[std::min( x + radius + 1, width - 1 )] - in[std::max( x - radius, 0 )];
+			}
+		}
+	}
+
+	/**
+	 * Box filters every column of a width x height image. One running sum is kept per column and
+	 * all of them are updated row by row.
+	 */
+	void
+	BoxColumns( const unsigned char* src, int src_step, unsigned char* dst, int dst_step,
+				int width, int height, int radius, std::vector<int>& sums )
+	{
+		int reciprocal = BoxReciprocal( radius );
+		sums.resize( width );
+
+		for( int x = 0; x < width; x++ )
+		{
+			sums[x] = ( radius + 1 ) * src[x];
+		}
+		for( int i = 1; i <= radius; i++ )
+		{
+			const unsigned char* in = src + std::min( i, height - 1 ) * src_step;
+			for( int x = 0; x < width; x++ )
+			{
+				sums[x] += in[x];
+			}
+		}
+
+		for( int y = 0; y < height; y++ )
+		{
+			unsigned char* out = dst + y * dst_step;
+			const unsigned char* entering = src + std::min( y + radius + 1, height - 1 ) * src_step;
+			const unsigned char* leaving = src + std::max( y - radius, 0 ) * src_step;
+
+			for( int x = 0; x < width; x++ )
+			{
+				out[x] = ( sums[x] * reciprocal + ( 1 << 15 ) ) >> 16;
+				sums[x] += entering[x] - leaving[x];
+			}
+		}
+	}
+}
+
+ImageSmoother::ImageSmoother()
+{
+	m_method = GAUSSIAN;
+	m_size = 11;
+}
+
+ImageSmoother::~ImageSmoother()
+{
+}
+
+void
+ImageSmoother::SetMethod( int method )
+{
+	switch( method )
+	{
+		case NONE:
+		case GAUSSIAN:
+		case RECURSIVE:
+		case BOX:
+			m_method = (Method)method;
+			break;
+		default:
+			m_method = GAUSSIAN;
+			break;
+	}
+}
+
+ImageSmoother::Method
+ImageSmoother::GetMethod() const
+{
+	return m_method;
+}
+
+void
+ImageSmoother::SetSize( int size )
+{
+	if( size > 1 && size % 2 == 0 )
+	{
+		size++;
+	}
+
+	m_size = size;
+}
+
+int
+ImageSmoother::GetSize() const
+{
+	return m_size;
+}
+
+const char*
+ImageSmoother::GetName( Method method )
+{
+	switch( method )
+	{
+		case NONE:
+			return "None";
+		case GAUSSIAN:
+			return "Gaussian";
+		case RECURSIVE:
+			return "Recursive";
+		case BOX:
+			return "Box";
+	}
+
+	return "Unknown";
+}
+
+void
+ImageSmoother::Smooth( IplImage* image )
+{
+	CvRect roi = cvGetImageROI( image );
+	if( m_method == NONE || m_size <= 1 || roi.width == 0 || roi.height == 0 )
+	{
+		return;
+	}
+
+	switch( m_method )
+	{
+		case GAUSSIAN:
+			cvSmooth( image, image, CV_GAUSSIAN, m_size, m_size );
+			break;
+		case RECURSIVE:
+			SmoothRecursive( image );
+			break;
+		case BOX:
+			SmoothBox( image );
+			break;
+		default:
+			break;
+	}
+}
+
+double
+ImageSmoother::Sigma() const
+{
+	return 0.3 * ( ( m_size - 1 ) * 0.5 - 1 ) + 0.8;
+}
+
+void
+ImageSmoother::SmoothRecursive( IplImage* image )
+{
+	CvRect roi = cvGetImageROI( image );
+	int width = roi.width;
+	int height = roi.height;
+	RecursiveCoefficients coefficients = MakeRecursiveCoefficients( Sigma() );
+
+	m_float_buffer.resize( width * height );
+	float* data = &m_float_buffer[0];
+
+	for( int y = 0; y < height; y++ )
+	{
+		const unsigned char* pixels = (const unsigned char*)( image->imageData + ( roi.y + y ) * image->widthStep + roi.x );
+		float* row = data + y * width;
+
+		for( int x = 0; x < width; x++ )
+		{
+			row[x] = pixels[x];
+		}
+		RecursiveLine( row, width, 1, coefficients );
+	}
+
+	RecursiveColumns( data, width, height, coefficients );
+
+	for( int y = 0; y < height; y++ )
+	{
+		unsigned char* pixels = (unsigned char*)( image->imageData + ( roi.y + y ) * image->widthStep + roi.x );
+		const float* row = data + y * width;
+
+		for( int x = 0; x < width; x++ )
+		{
+			pixels[x] = (unsigned char)std::min( 255.0f, std::max( 0.0f, row[x] + 0.5f ) );
+		}
+	}
+}
+
+void
+ImageSmoother::SmoothBox( IplImage* image )
+{
+	CvRect roi = cvGetImageROI( image );
+	int width = roi.width;
+	int height = roi.height;
+
+	/**
+	 * Three boxes of width w_l or w_l + 2 are picked so that their combined variance matches the
+	 * variance of the Gaussian as closely as possible (Kovesi, "Fast almost-Gaussian filtering").
+	 */
+	double variance = 12.0 * Sigma() * Sigma();
+	int lower = (int)floor( sqrt( variance / 3.0 + 1.0 ) );
+	if( lower % 2 == 0 )
+	{
+		lower--;
+	}
+	int lower_count = (int)floor( ( variance - 3.0 * lower * lower - 12.0 * lower - 9.0 ) / ( -4.0 * lower - 4.0 ) + 0.5 );
+
+	int radius[3];
+	for( int i = 0; i < 3; i++ )
+	{
+		radius[i] = ( i < lower_count ? lower : lower + 2 ) / 2;
+	}
+
+	m_first_buffer.resize( width * height );
+	m_second_buffer.resize( width * height );
+	unsigned char* first = &m_first_buffer[0];
+	unsigned char* second = &m_second_buffer[0];
+	unsigned char* pixels = (unsigned char*)( image->imageData + roi.y * image->widthStep + roi.x );
+	int step = image->widthStep;
+
+	// The passes alternate between the two buffers, reading from and writing to the image only once.
+	BoxRows( pixels, step, first, width, width, height, radius[0] );
+	BoxRows( first, width, second, width, width, height, radius[1] );
+	BoxRows( second, width, first, width, width, height, radius[2] );
+	BoxColumns( first, width, second, width, width, height, radius[0], m_column_sums );
+	BoxColumns( second, width, first, width, width, height, radius[1], m_column_sums );
+	BoxColumns( first, width, pixels, step, width, height, radius[2], m_column_sums );
+}
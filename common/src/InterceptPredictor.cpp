@@ -0,0 +1,99 @@
+/*
+ * InterceptPredictor.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "InterceptPredictor.h"
+
+#include <cmath>
+
+InterceptPredictor::InterceptPredictor()
+{
+	m_min_speed = 20.0;
+	m_alpha = 0.2;
+	m_horizon = 10.0;
+
+	Reset();
+}
+
+InterceptPredictor::~InterceptPredictor()
+{
+}
+
+void
+InterceptPredictor::SetParameters( double min_speed, double alpha, double horizon )
+{
+	m_min_speed = min_speed;
+	m_alpha = alpha;
+	m_horizon = horizon;
+}
+
+void
+InterceptPredictor::Reset()
+{
+	m_has_velocity = false;
+	m_velocity_x = 0;
+	m_velocity_y = 0;
+}
+
+void
+InterceptPredictor::AddVelocity( double velocity_x, double velocity_y )
+{
+	if( !m_has_velocity )
+	{
+		m_velocity_x = velocity_x;
+		m_velocity_y = velocity_y;
+		m_has_velocity = true;
+		return;
+	}
+
+	m_velocity_x += m_alpha * ( velocity_x - m_velocity_x );
+	m_velocity_y += m_alpha * ( velocity_y - m_velocity_y );
+}
+
+bool
+InterceptPredictor::IsMoving() const
+{
+	return m_has_velocity && sqrt( m_velocity_x * m_velocity_x + m_velocity_y * m_velocity_y ) >= m_min_speed;
+}
+
+double
+InterceptPredictor::GetVelocityX() const
+{
+	return m_velocity_x;
+}
+
+double
+InterceptPredictor::GetVelocityY() const
+{
+	return m_velocity_y;
+}
+
+bool
+InterceptPredictor::Predict( double x, double y, double grasp_x, double grasp_y,
+							 double& intercept_x, double& intercept_y, double& time_to_intercept ) const
+{
+	if( !IsMoving() )
+	{
+		return false;
+	}
+
+	/**
+	 * The distance to the grasp line is measured along the belt, the object covers it at the belt
+	 * speed. The point where it crosses the line is where the object is carried in that time.
+	 */
+	double speed_squared = m_velocity_x * m_velocity_x + m_velocity_y * m_velocity_y;
+	double time = ( ( grasp_x - x ) * m_velocity_x + ( grasp_y - y ) * m_velocity_y ) / speed_squared;
+
+	if( time < 0 || time > m_horizon )
+	{
+		return false;
+	}
+
+	intercept_x = x + m_velocity_x * time;
+	intercept_y = y + m_velocity_y * time;
+	time_to_intercept = time;
+
+	return true;
+}
@@ -0,0 +1,126 @@
+/*
+ * LatencyMonitor.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "LatencyMonitor.h"
+
+LatencyMonitor::LatencyMonitor()
+{
+	memset( (void*)m_histograms, 0, sizeof( m_histograms ) );
+	m_active = 0;
+}
+
+LatencyMonitor::~LatencyMonitor()
+{
+}
+
+void
+LatencyMonitor::Snapshot( LatencySummary* summaries )
+{
+	memset( summaries, 0, sizeof( LatencySummary ) * STAGE_COUNT );
+
+#ifdef VISUAL_SERVOING_INSTRUMENTATION
+	/**
+	 * A thread that picked the old histograms just before the switch may still add its latency to
+	 * them after they have been summarised. That latency is then counted in the next snapshot but
+	 * one, or lost if it races with the clearing, which does not matter for a rolling summary.
+	 */
+	int previous = m_active;
+	__sync_lock_test_and_set( &m_active, 1 - previous );
+
+	for( int stage = 0; stage < STAGE_COUNT; stage++ )
+	{
+		Histogram& histogram = m_histograms[previous][stage];
+		LatencySummary& summary = summaries[stage];
+
+		uint64_t count = 0;
+		for( unsigned int i = 0; i < m_bucket_count; i++ )
+		{
+			count += histogram.buckets[i];
+		}
+
+		if( count > 0 )
+		{
+			uint64_t p50_rank = ( count + 1 ) / 2;
+			uint64_t p99_rank = count - count / 100;
+			uint64_t seen = 0;
+
+			for( unsigned int i = 0; i < m_bucket_count; i++ )
+			{
+				if( histogram.buckets[i] == 0 )
+				{
+					continue;
+				}
+
+				// The middle of the bucket, in milliseconds.
+				double value = ( BucketStart( i ) + BucketStart( i + 1 ) ) / 2000.0;
+
+				if( seen < p50_rank && seen + histogram.buckets[i] >= p50_rank )
+				{
+					summary.p50 = value;
+				}
+				if( seen < p99_rank && seen + histogram.buckets[i] >= p99_rank )
+				{
+					summary.p99 = value;
+				}
+				seen += histogram.buckets[i];
+			}
+
+			summary.count = count;
+			summary.mean = histogram.sum / 1000.0 / count;
+			summary.max = histogram.max / 1000.0;
+		}
+
+		memset( (void*)&histogram, 0, sizeof( histogram ) );
+	}
+#endif
+}
+
+const char*
+LatencyMonitor::GetName( Stage stage )
+{
+	switch( stage )
+	{
+		case INGEST:		return "ingest";
+		case CONVERT:		return "convert";
+		case SMOOTH:		return "smooth";
+		case THRESHOLD:		return "threshold";
+		case SUBTRACT:		return "subtract";
+		case LABEL:			return "label";
+		case SELECT:		return "select";
+		case DETECT:		return "detect";
+		case QUEUE:			return "queue";
+		case CONTROL:		return "control";
+		case BASE_COMMAND:	return "base_command";
+		case ARM_COMMAND:	return "arm_command";
+		default:			return "unknown";
+	}
+}
+
+unsigned int
+LatencyMonitor::Bucket( uint64_t microseconds )
+{
+	if( microseconds < 4 )
+	{
+		return microseconds;
+	}
+
+	// Four buckets per power of two: the exponent picks the group, the next two bits the bucket.
+	int exponent = 63 - __builtin_clzll( microseconds );
+	unsigned int bucket = 4 * ( exponent - 1 ) + ( ( microseconds >> ( exponent - 2 ) ) & 3 );
+
+	return bucket < m_bucket_count ? bucket : m_bucket_count - 1;
+}
+
+uint64_t
+LatencyMonitor::BucketStart( unsigned int bucket )
+{
+	if( bucket < 4 )
+	{
+		return bucket;
+	}
+
+	return (uint64_t)( 4 + bucket % 4 ) << ( bucket / 4 - 1 );
+}
@@ -0,0 +1,302 @@
+/*
+ * ObjectTracker.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ObjectTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+ObjectTracker::ObjectTracker()
+{
+	m_acceleration_noise = 500.0;
+	m_measurement_noise = 5.0;
+	m_gate = 13.8;
+	m_max_coast_frames = 5;
+	m_max_deviation = 48.0;
+	m_max_unseen_time = 2.0;
+
+	m_cell_size = 64;
+	m_grid_width = 0;
+	m_grid_height = 0;
+
+	Reset();
+}
+
+ObjectTracker::~ObjectTracker()
+{
+}
+
+void
+ObjectTracker::SetParameters( double acceleration_noise, double measurement_noise, double gate, int max_coast_frames )
+{
+	m_acceleration_noise = acceleration_noise;
+	m_measurement_noise = measurement_noise;
+	m_gate = gate;
+	m_max_coast_frames = max_coast_frames;
+
+	for( unsigned int i = 0; i < m_tracks.size(); i++ )
+	{
+		m_tracks[i].filter.SetParameters( acceleration_noise, measurement_noise, gate, max_coast_frames );
+	}
+}
+
+void
+ObjectTracker::SetCellSize( int cell_size )
+{
+	m_cell_size = std::max( 8, cell_size );
+}
+
+void
+ObjectTracker::SetLimits( double max_deviation, double max_unseen_time )
+{
+	m_max_deviation = max_deviation;
+	m_max_unseen_time = max_unseen_time;
+
+	for( unsigned int i = 0; i < m_tracks.size(); i++ )
+	{
+		m_tracks[i].filter.SetMaxDeviation( max_deviation );
+	}
+}
+
+void
+ObjectTracker::Reset()
+{
+	m_tracks.clear();
+	m_blob_tracks.clear();
+	m_next_id = 0;
+}
+
+void
+ObjectTracker::Predict( double stamp )
+{
+	for( unsigned int i = 0; i < m_tracks.size(); i++ )
+	{
+		m_tracks[i].filter.Predict( stamp );
+		m_tracks[i].blob = -1;
+	}
+}
+
+void
+ObjectTracker::Associate( const BlobTable& blobs, CvSize frame_size, CvRect window )
+{
+	BuildGrid( blobs, frame_size );
+
+	/**
+	 * Every track collects the blobs inside its gate from the grid cells that the box around the
+	 * gate overlaps.
+	 */
+	m_candidates.clear();
+	for( unsigned int t = 0; t < m_tracks.size(); t++ )
+	{
+		const TargetTracker& filter = m_tracks[t].filter;
+		m_tracks[t].blob = -1;
+
+		// A track outside of the window could not have been seen, it must not take a blob from one inside.
+		if( !IsInWindow( m_tracks[t], window ) )
+		{
+			continue;
+		}
+
+		double half_width;
+		double half_height;
+		filter.GetGateBox( half_width, half_height );
+
+		int min_cell_x = std::max( 0, (int)floor( ( filter.GetX() - half_width ) / m_cell_size ) );
+		int max_cell_x = std::min( m_grid_width - 1, (int)floor( ( filter.GetX() + half_width ) / m_cell_size ) );
+		int min_cell_y = std::max( 0, (int)floor( ( filter.GetY() - half_height ) / m_cell_size ) );
+		int max_cell_y = std::min( m_grid_height - 1, (int)floor( ( filter.GetY() + half_height ) / m_cell_size ) );
+
+		for( int cell_y = min_cell_y; cell_y <= max_cell_y; cell_y++ )
+		{
+			for( int cell_x = min_cell_x; cell_x <= max_cell_x; cell_x++ )
+			{
+				int cell = cell_y * m_grid_width + cell_x;
+				for( int k = m_cell_start[cell]; k < m_cell_start[cell + 1]; k++ )
+				{
+					int b = m_cell_blobs[k];
+					double distance = filter.Distance( blobs.BoxCenterX( b ), blobs.BoxCenterY( b ) );
+					if( distance <= m_gate )
+					{
+						Candidate candidate = { distance, (int)t, b };
+						m_candidates.push_back( candidate );
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * The closest pairs are matched first, each track and each blob only once.
+	 */
+	std::sort( m_candidates.begin(), m_candidates.end() );
+
+	m_blob_assigned.assign( blobs.Size(), false );
+	for( unsigned int i = 0; i < m_candidates.size(); i++ )
+	{
+		const Candidate& candidate = m_candidates[i];
+		if( m_tracks[candidate.track].blob < 0 && !m_blob_assigned[candidate.blob] )
+		{
+			m_tracks[candidate.track].blob = candidate.blob;
+			m_blob_assigned[candidate.blob] = true;
+		}
+	}
+}
+
+int
+ObjectTracker::GetAssignedBlob( int id ) const
+{
+	int index = FindIndex( id );
+	return ( index < 0 ) ? -1 : m_tracks[index].blob;
+}
+
+bool
+ObjectTracker::CanCoast( int id ) const
+{
+	int index = FindIndex( id );
+	return index >= 0 && m_tracks[index].filter.GetCoastedFrames() < m_max_coast_frames;
+}
+
+void
+ObjectTracker::Update( const BlobTable& blobs, CvRect window, double stamp )
+{
+	m_blob_assigned.resize( blobs.Size(), false );
+
+	unsigned int kept = 0;
+	for( unsigned int t = 0; t < m_tracks.size(); t++ )
+	{
+		ObjectTrack& track = m_tracks[t];
+		int b = track.blob;
+
+		if( b >= 0 && b < (int)blobs.Size() )
+		{
+			track.filter.Correct( blobs.BoxCenterX( b ), blobs.BoxCenterY( b ) );
+			track.width = blobs.max_x[b] - blobs.min_x[b] + 1;
+			track.height = blobs.max_y[b] - blobs.min_y[b] + 1;
+			track.last_seen = stamp;
+		}
+		else
+		{
+			track.blob = -1;
+
+			// Only objects that should have been in the processed window count as missed.
+			if( IsInWindow( track, window ) ? !track.filter.Coast() : stamp - track.last_seen > m_max_unseen_time )
+			{
+				continue;
+			}
+		}
+
+		if( kept != t )
+		{
+			m_tracks[kept] = track;
+		}
+		kept++;
+	}
+	m_tracks.resize( kept );
+
+	for( unsigned int b = 0; b < blobs.Size(); b++ )
+	{
+		if( m_blob_assigned[b] )
+		{
+			continue;
+		}
+
+		ObjectTrack track;
+		track.id = m_next_id++;
+		track.filter.SetParameters( m_acceleration_noise, m_measurement_noise, m_gate, m_max_coast_frames );
+		track.filter.SetMaxDeviation( m_max_deviation );
+		track.filter.Initialize( blobs.BoxCenterX( b ), blobs.BoxCenterY( b ), stamp );
+		track.width = blobs.max_x[b] - blobs.min_x[b] + 1;
+		track.height = blobs.max_y[b] - blobs.min_y[b] + 1;
+		track.blob = b;
+		track.last_seen = stamp;
+		m_tracks.push_back( track );
+	}
+
+	m_blob_tracks.assign( blobs.Size(), -1 );
+	for( unsigned int t = 0; t < m_tracks.size(); t++ )
+	{
+		if( m_tracks[t].blob >= 0 )
+		{
+			m_blob_tracks[m_tracks[t].blob] = m_tracks[t].id;
+		}
+	}
+}
+
+int
+ObjectTracker::GetBlobTrack( unsigned int blob ) const
+{
+	return ( blob < m_blob_tracks.size() ) ? m_blob_tracks[blob] : -1;
+}
+
+const ObjectTrack*
+ObjectTracker::FindTrack( int id ) const
+{
+	int index = FindIndex( id );
+	return ( index < 0 ) ? NULL : &m_tracks[index];
+}
+
+const std::vector<ObjectTrack>&
+ObjectTracker::GetTracks() const
+{
+	return m_tracks;
+}
+
+void
+ObjectTracker::BuildGrid( const BlobTable& blobs, CvSize frame_size )
+{
+	m_grid_width = std::max( 1, ( frame_size.width + m_cell_size - 1 ) / m_cell_size );
+	m_grid_height = std::max( 1, ( frame_size.height + m_cell_size - 1 ) / m_cell_size );
+	int cells = m_grid_width * m_grid_height;
+
+	/**
+	 * A counting sort: count the blobs per cell, sum the counts up to the end of every cell and then
+	 * drop every blob into its cell from the end, which leaves the start of every cell behind.
+	 */
+	m_cell_start.assign( cells + 1, 0 );
+	m_blob_cells.resize( blobs.Size() );
+	for( unsigned int b = 0; b < blobs.Size(); b++ )
+	{
+		int cell_x = std::min( std::max( 0, (int)( blobs.BoxCenterX( b ) / m_cell_size ) ), m_grid_width - 1 );
+		int cell_y = std::min( std::max( 0, (int)( blobs.BoxCenterY( b ) / m_cell_size ) ), m_grid_height - 1 );
+		m_blob_cells[b] = cell_y * m_grid_width + cell_x;
+		m_cell_start[m_blob_cells[b]]++;
+	}
+
+	for( int c = 1; c < cells; c++ )
+	{
+		m_cell_start[c] += m_cell_start[c - 1];
+	}
+	m_cell_start[cells] = blobs.Size();
+
+	m_cell_blobs.resize( blobs.Size() );
+	for( unsigned int b = 0; b < blobs.Size(); b++ )
+	{
+		m_cell_blobs[--m_cell_start[m_blob_cells[b]]] = b;
+	}
+}
+
+bool
+ObjectTracker::IsInWindow( const ObjectTrack& track, CvRect window )
+{
+	double x = track.filter.GetX();
+	double y = track.filter.GetY();
+
+	return x >= window.x && x < window.x + window.width && y >= window.y && y < window.y + window.height;
+}
+
+int
+ObjectTracker::FindIndex( int id ) const
+{
+	for( unsigned int i = 0; i < m_tracks.size(); i++ )
+	{
+		if( m_tracks[i].id == id )
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
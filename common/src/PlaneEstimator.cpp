@@ -0,0 +1,292 @@
+/*
+ * PlaneEstimator.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "PlaneEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * The share of the points a plane needs as inliers, the probability with which the plane is to be
+ * found and the least number of points to look for a plane in.
+ */
+const static double g_min_inlier_ratio = 0.2;
+const static double g_confidence = 0.99;
+const static unsigned int g_min_points = 50;
+
+PlaneEstimator::PlaneEstimator()
+{
+	m_inlier_distance = 0.01;
+	m_max_iterations = 200;
+	m_random = 12345;
+
+	Reset();
+}
+
+PlaneEstimator::~PlaneEstimator()
+{
+}
+
+void
+PlaneEstimator::SetParameters( double inlier_distance, int max_iterations )
+{
+	m_inlier_distance = inlier_distance;
+	m_max_iterations = std::max( 1, max_iterations );
+}
+
+void
+PlaneEstimator::Reset()
+{
+	m_has_plane = false;
+	m_inlier_ratio = 0;
+	m_iterations = 0;
+
+	Plane plane = { 0, 0, 0, 0 };
+	m_plane = plane;
+}
+
+bool
+PlaneEstimator::Estimate( const std::vector<CvPoint3D32f>& points )
+{
+	m_iterations = 0;
+
+	if( points.size() < g_min_points )
+	{
+		Reset();
+		return false;
+	}
+
+	Plane best = m_plane;
+	unsigned int best_inliers = m_has_plane ? CountInliers( points, m_plane ) : 0;
+	int required = m_has_plane ? RequiredIterations( (double)best_inliers / points.size() ) : m_max_iterations;
+
+	while( m_iterations < required )
+	{
+		m_iterations++;
+
+		unsigned int i0 = Random( points.size() );
+		unsigned int i1 = Random( points.size() );
+		unsigned int i2 = Random( points.size() );
+
+		Plane plane;
+		if( i0 == i1 || i0 == i2 || i1 == i2 || !PlaneThrough( points[i0], points[i1], points[i2], plane ) )
+		{
+			continue;
+		}
+
+		unsigned int inliers = CountInliers( points, plane );
+		if( inliers > best_inliers )
+		{
+			best = plane;
+			best_inliers = inliers;
+			required = RequiredIterations( (double)best_inliers / points.size() );
+		}
+	}
+
+	if( best_inliers < g_min_inlier_ratio * points.size() || !Refine( points, best ) )
+	{
+		Reset();
+		return false;
+	}
+
+	// The normal is turned towards the camera, which is at the origin.
+	if( best.d < 0 )
+	{
+		best.a = -best.a;
+		best.b = -best.b;
+		best.c = -best.c;
+		best.d = -best.d;
+	}
+
+	m_plane = best;
+	m_has_plane = true;
+	m_inlier_ratio = (double)CountInliers( points, m_plane ) / points.size();
+	return true;
+}
+
+bool
+PlaneEstimator::HasPlane() const
+{
+	return m_has_plane;
+}
+
+const Plane&
+PlaneEstimator::GetPlane() const
+{
+	return m_plane;
+}
+
+double
+PlaneEstimator::GetInlierRatio() const
+{
+	return m_inlier_ratio;
+}
+
+int
+PlaneEstimator::GetIterations() const
+{
+	return m_iterations;
+}
+
+unsigned int
+PlaneEstimator::CountInliers( const std::vector<CvPoint3D32f>& points, const Plane& plane ) const
+{
+	unsigned int inliers = 0;
+	for( unsigned int i = 0; i < points.size(); i++ )
+	{
+		if( fabs( plane.Distance( points[i].x, points[i].y, points[i].z ) ) <= m_inlier_distance )
+		{
+			inliers++;
+		}
+	}
+
+	return inliers;
+}
+
+bool
+PlaneEstimator::PlaneThrough( const CvPoint3D32f& p0, const CvPoint3D32f& p1, const CvPoint3D32f& p2, Plane& plane )
+{
+	double ux = p1.x - p0.x;
+	double uy = p1.y - p0.y;
+	double uz = p1.z - p0.z;
+	double vx = p2.x - p0.x;
+	double vy = p2.y - p0.y;
+	double vz = p2.z - p0.z;
+
+	double a = uy * vz - uz * vy;
+	double b = uz * vx - ux * vz;
+	double c = ux * vy - uy * vx;
+	double length = sqrt( a * a + b * b + c * c );
+	if( length < 1e-9 )
+	{
+		return false;
+	}
+
+	plane.a = a / length;
+	plane.b = b / length;
+	plane.c = c / length;
+	plane.d = -( plane.a * p0.x + plane.b * p0.y + plane.c * p0.z );
+	return true;
+}
+
+bool
+PlaneEstimator::Refine( const std::vector<CvPoint3D32f>& points, Plane& plane ) const
+{
+	double n = 0;
+	double sum_x = 0, sum_y = 0, sum_z = 0;
+	for( unsigned int i = 0; i < points.size(); i++ )
+	{
+		const CvPoint3D32f& p = points[i];
+		if( fabs( plane.Distance( p.x, p.y, p.z ) ) <= m_inlier_distance )
+		{
+			sum_x += p.x;
+			sum_y += p.y;
+			sum_z += p.z;
+			n++;
+		}
+	}
+
+	if( n < 3 )
+	{
+		return false;
+	}
+
+	double mean_x = sum_x / n;
+	double mean_y = sum_y / n;
+	double mean_z = sum_z / n;
+
+	double xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+	for( unsigned int i = 0; i < points.size(); i++ )
+	{
+		const CvPoint3D32f& p = points[i];
+		if( fabs( plane.Distance( p.x, p.y, p.z ) ) <= m_inlier_distance )
+		{
+			double x = p.x - mean_x;
+			double y = p.y - mean_y;
+			double z = p.z - mean_z;
+			xx += x * x;
+			xy += x * y;
+			xz += x * z;
+			yy += y * y;
+			yz += y * z;
+			zz += z * z;
+		}
+	}
+
+	/**
+	 * The normal is the direction in which the inliers vary least. It is found by solving for the
+	 * two other coordinates with the coordinate whose 2x2 system is best conditioned set to one.
+	 */
+	double det_x = yy * zz - yz * yz;
+	double det_y = xx * zz - xz * xz;
+	double det_z = xx * yy - xy * xy;
+
+	double a, b, c;
+	if( det_x >= det_y && det_x >= det_z )
+	{
+		a = det_x;
+		b = xz * yz - xy * zz;
+		c = xy * yz - xz * yy;
+	}
+	else if( det_y >= det_z )
+	{
+		a = xz * yz - xy * zz;
+		b = det_y;
+		c = xy * xz - yz * xx;
+	}
+	else
+	{
+		a = xy * yz - xz * yy;
+		b = xy * xz - yz * xx;
+		c = det_z;
+	}
+
+	double length = sqrt( a * a + b * b + c * c );
+	if( length <= 0 )
+	{
+		return false;
+	}
+
+	// Keep the side the plane was facing.
+	if( a * plane.a + b * plane.b + c * plane.c < 0 )
+	{
+		length = -length;
+	}
+
+	plane.a = a / length;
+	plane.b = b / length;
+	plane.c = c / length;
+	plane.d = -( plane.a * mean_x + plane.b * mean_y + plane.c * mean_z );
+	return true;
+}
+
+int
+PlaneEstimator::RequiredIterations( double inlier_ratio ) const
+{
+	double all_inliers = inlier_ratio * inlier_ratio * inlier_ratio;
+	if( all_inliers <= 0 )
+	{
+		return m_max_iterations;
+	}
+	if( all_inliers >= 1 )
+	{
+		return 1;
+	}
+
+	double required = ceil( log( 1 - g_confidence ) / log( 1 - all_inliers ) );
+	return (int)std::min( required, (double)m_max_iterations );
+}
+
+unsigned int
+PlaneEstimator::Random( unsigned int n )
+{
+	// xorshift32
+	m_random ^= m_random << 13;
+	m_random ^= m_random >> 17;
+	m_random ^= m_random << 5;
+
+	return m_random % n;
+}
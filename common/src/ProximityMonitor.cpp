@@ -0,0 +1,120 @@
+/*
+ * ProximityMonitor.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ProximityMonitor.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+ProximityMonitor::ProximityMonitor( ros::NodeHandle& node_handler, const std::string& service_name ) :
+	m_node_handler( node_handler ),
+	m_service_name( service_name )
+{
+	m_running = false;
+	m_too_close = true;
+	m_rate = 10.0;
+	m_staleness_bound = 0.5;
+}
+
+ProximityMonitor::~ProximityMonitor()
+{
+	Stop();
+}
+
+void
+ProximityMonitor::Start()
+{
+	Stop();
+
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_running = true;
+		m_too_close = true;
+		m_stamp = ros::WallTime();
+	}
+
+	m_thread = boost::thread( boost::bind( &ProximityMonitor::Run, this ) );
+}
+
+void
+ProximityMonitor::Stop()
+{
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_running = false;
+	}
+	m_condition.notify_all();
+
+	if( m_thread.joinable() )
+	{
+		m_thread.join();
+	}
+}
+
+void
+ProximityMonitor::SetTiming( double rate, double staleness_bound )
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	m_rate = std::max( rate, 0.1 );
+	m_staleness_bound = staleness_bound;
+}
+
+ProximityMonitor::Answer
+ProximityMonitor::GetAnswer() const
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+
+	if( m_stamp.isZero() || ( ros::WallTime::now() - m_stamp ).toSec() > m_staleness_bound )
+	{
+		return UNKNOWN;
+	}
+
+	return m_too_close ? TOO_CLOSE : CLEAR;
+}
+
+bool
+ProximityMonitor::IsTooClose() const
+{
+	return GetAnswer() != CLEAR;
+}
+
+void
+ProximityMonitor::Run()
+{
+	// A persistent connection saves setting one up for every call, it is only rebuilt after a failure.
+	ros::ServiceClient client = m_node_handler.serviceClient<hbrs_srvs::ReturnBool>( m_service_name, true );
+	hbrs_srvs::ReturnBool service_msg;
+
+	boost::mutex::scoped_lock lock( m_mutex );
+	while( m_running )
+	{
+		double period = 1.0 / m_rate;
+
+		lock.unlock();
+		bool answered = client.call( service_msg );
+		lock.lock();
+
+		if( answered )
+		{
+			m_too_close = service_msg.response.value;
+			m_stamp = ros::WallTime::now();
+		}
+		else
+		{
+			ROS_ERROR_THROTTLE( 1.0, "Visual Servoing call to %s has failed", m_service_name.c_str() );
+
+			lock.unlock();
+			client = m_node_handler.serviceClient<hbrs_srvs::ReturnBool>( m_service_name, true );
+			lock.lock();
+		}
+
+		if( m_running )
+		{
+			m_condition.timed_wait( lock, boost::posix_time::microseconds( (long)( period * 1e6 ) ) );
+		}
+	}
+}
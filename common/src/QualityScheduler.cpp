@@ -0,0 +1,131 @@
+/*
+ * QualityScheduler.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "QualityScheduler.h"
+
+#include <algorithm>
+
+/**
+ * The weight of a new frame in the moving average, the number of frames a level is kept at least,
+ * the number of frames a level that was stepped up to has to keep up for and the most frames that
+ * stepping up to a level that was too slow is put off for.
+ */
+const static double g_alpha = 0.1;
+const static unsigned int g_hold_frames = 15;
+const static unsigned int g_probe_frames = 60;
+const static unsigned int g_max_up_frames = 480;
+
+QualityScheduler::QualityScheduler()
+{
+	m_budget = 0;
+	m_headroom = 0.6;
+
+	Reset();
+}
+
+QualityScheduler::~QualityScheduler()
+{
+}
+
+void
+QualityScheduler::SetBudget( double budget, double headroom )
+{
+	if( budget != m_budget )
+	{
+		m_budget = budget;
+		Reset();
+	}
+
+	m_headroom = headroom;
+}
+
+bool
+QualityScheduler::IsEnabled() const
+{
+	return m_budget > 0;
+}
+
+void
+QualityScheduler::Reset()
+{
+	m_level = FULL_FRAME;
+	m_average = 0;
+	m_frames = 0;
+	m_up_frames = g_hold_frames;
+	m_probing = false;
+}
+
+bool
+QualityScheduler::Update( double milliseconds )
+{
+	if( !IsEnabled() )
+	{
+		return false;
+	}
+
+	m_average = ( m_frames == 0 ) ? milliseconds : m_average + g_alpha * ( milliseconds - m_average );
+	m_frames++;
+
+	if( m_frames < g_hold_frames )
+	{
+		return false;
+	}
+
+	if( m_average > m_budget && m_level < NO_SMOOTHING )
+	{
+		if( m_probing )
+		{
+			m_up_frames = std::min( 2 * m_up_frames, g_max_up_frames );
+			m_probing = false;
+		}
+
+		m_level = (Level)( m_level + 1 );
+		m_frames = 0;
+		return true;
+	}
+
+	if( m_probing && m_frames >= g_probe_frames )
+	{
+		// The level that was stepped up to has kept up, it may be tried again right away next time.
+		m_probing = false;
+		m_up_frames = g_hold_frames;
+	}
+
+	if( m_average < m_headroom * m_budget && m_level > FULL_FRAME && m_frames >= m_up_frames )
+	{
+		m_level = (Level)( m_level - 1 );
+		m_frames = 0;
+		m_probing = true;
+		return true;
+	}
+
+	return false;
+}
+
+QualityScheduler::Level
+QualityScheduler::GetLevel() const
+{
+	return m_level;
+}
+
+double
+QualityScheduler::GetAverage() const
+{
+	return m_average;
+}
+
+const char*
+QualityScheduler::GetName( Level level )
+{
+	switch( level )
+	{
+		case FULL_FRAME:		return "full frame";
+		case TRACKING_WINDOW:	return "tracking window";
+		case HALF_RESOLUTION:	return "half resolution";
+		case NO_SMOOTHING:		return "no smoothing";
+		default:				return "unknown";
+	}
+}
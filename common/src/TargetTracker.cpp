@@ -0,0 +1,213 @@
+/*
+ * TargetTracker.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "TargetTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+TargetTracker::TargetTracker()
+{
+	m_acceleration_noise = 500.0;
+	m_measurement_noise = 5.0;
+	m_initial_velocity = 300.0;
+	m_gate = 13.8;
+	m_max_coast_frames = 5;
+	m_max_deviation = 0;
+
+	Reset();
+}
+
+TargetTracker::~TargetTracker()
+{
+}
+
+void
+TargetTracker::SetParameters( double acceleration_noise, double measurement_noise, double gate, int max_coast_frames )
+{
+	m_acceleration_noise = acceleration_noise;
+	m_measurement_noise = measurement_noise;
+	m_gate = gate;
+	m_max_coast_frames = max_coast_frames;
+}
+
+void
+TargetTracker::SetMaxDeviation( double deviation )
+{
+	m_max_deviation = std::max( 0.0, deviation );
+}
+
+void
+TargetTracker::Reset()
+{
+	m_tracking = false;
+	m_stamp = 0;
+	m_coasted_frames = 0;
+	m_corrected_frames = 0;
+
+	Axis axis = { 0, 0, 0, 0, 0 };
+	m_x = axis;
+	m_y = axis;
+}
+
+bool
+TargetTracker::IsTracking() const
+{
+	return m_tracking;
+}
+
+void
+TargetTracker::Initialize( double x, double y, double stamp )
+{
+	double r = m_measurement_noise * m_measurement_noise;
+	double v = m_initial_velocity * m_initial_velocity;
+
+	Axis axis_x = { x, 0, r, 0, v };
+	Axis axis_y = { y, 0, r, 0, v };
+	m_x = axis_x;
+	m_y = axis_y;
+
+	m_stamp = stamp;
+	m_coasted_frames = 0;
+	m_corrected_frames = 0;
+	m_tracking = true;
+}
+
+void
+TargetTracker::Predict( double stamp )
+{
+	double dt = stamp - m_stamp;
+	if( !m_tracking || dt <= 0 )
+	{
+		return;
+	}
+
+	PredictAxis( m_x, dt );
+	PredictAxis( m_y, dt );
+	m_stamp = stamp;
+}
+
+double
+TargetTracker::Distance( double x, double y ) const
+{
+	double r = m_measurement_noise * m_measurement_noise;
+	double dx = x - m_x.position;
+	double dy = y - m_y.position;
+
+	return ( dx * dx ) / ( m_x.p_pp + r ) + ( dy * dy ) / ( m_y.p_pp + r );
+}
+
+bool
+TargetTracker::IsInGate( double x, double y ) const
+{
+	return Distance( x, y ) <= m_gate;
+}
+
+void
+TargetTracker::GetGateBox( double& half_width, double& half_height ) const
+{
+	double r = m_measurement_noise * m_measurement_noise;
+
+	half_width = sqrt( m_gate * ( m_x.p_pp + r ) );
+	half_height = sqrt( m_gate * ( m_y.p_pp + r ) );
+}
+
+void
+TargetTracker::Correct( double x, double y )
+{
+	CorrectAxis( m_x, x );
+	CorrectAxis( m_y, y );
+	m_coasted_frames = 0;
+	m_corrected_frames++;
+}
+
+bool
+TargetTracker::Coast()
+{
+	m_coasted_frames++;
+	if( m_coasted_frames > m_max_coast_frames )
+	{
+		Reset();
+		return false;
+	}
+
+	return true;
+}
+
+double
+TargetTracker::GetX() const
+{
+	return m_x.position;
+}
+
+double
+TargetTracker::GetY() const
+{
+	return m_y.position;
+}
+
+double
+TargetTracker::GetVelocityX() const
+{
+	return m_x.velocity;
+}
+
+double
+TargetTracker::GetVelocityY() const
+{
+	return m_y.velocity;
+}
+
+int
+TargetTracker::GetCoastedFrames() const
+{
+	return m_coasted_frames;
+}
+
+int
+TargetTracker::GetCorrectedFrames() const
+{
+	return m_corrected_frames;
+}
+
+void
+TargetTracker::PredictAxis( Axis& axis, double dt ) const
+{
+	/**
+	 * The target keeps its velocity, the unknown acceleration is white noise which makes the
+	 * position and velocity less certain the longer the prediction reaches.
+	 */
+	double q = m_acceleration_noise * m_acceleration_noise;
+
+	axis.position += axis.velocity * dt;
+	axis.p_pp += dt * ( 2 * axis.p_pv + dt * axis.p_vv ) + q * dt * dt * dt / 3;
+	axis.p_pv += dt * axis.p_vv + q * dt * dt / 2;
+	axis.p_vv += q * dt;
+
+	// The position variance is capped, the covariance is scaled with it so that it stays valid.
+	double max_pp = m_max_deviation * m_max_deviation;
+	if( max_pp > 0 && axis.p_pp > max_pp )
+	{
+		axis.p_pv *= sqrt( max_pp / axis.p_pp );
+		axis.p_pp = max_pp;
+	}
+}
+
+void
+TargetTracker::CorrectAxis( Axis& axis, double measurement ) const
+{
+	double s = axis.p_pp + m_measurement_noise * m_measurement_noise;
+	double gain_p = axis.p_pp / s;
+	double gain_v = axis.p_pv / s;
+	double innovation = measurement - axis.position;
+
+	axis.position += gain_p * innovation;
+	axis.velocity += gain_v * innovation;
+
+	axis.p_vv -= gain_v * axis.p_pv;
+	axis.p_pv -= gain_p * axis.p_pv;
+	axis.p_pp -= gain_p * axis.p_pp;
+}
@@ -0,0 +1,309 @@
+/*
+ * ThresholdEstimator.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ThresholdEstimator.h"
+#include "ForegroundKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+ThresholdEstimator::ThresholdEstimator()
+{
+	m_mode = OTSU;
+
+	m_fixed_threshold = 50;
+	m_threshold = 0;
+
+	m_interval = 10;
+	m_subsample = 4;
+	m_drift = 8.0;
+	m_alpha = 0.3;
+
+	m_initialized = false;
+	m_first_look = true;
+	m_updated = false;
+	m_learn_pending = false;
+	m_frames_since_update = 0;
+	m_look_share = 0;
+	m_frame_updated = false;
+	m_threshold_before = 0;
+	m_initialized_before = false;
+	m_mean_at_update = 0;
+	m_mean_region = cvRect( 0, 0, 0, 0 );
+	m_mean_size = cvSize( 0, 0 );
+}
+
+ThresholdEstimator::~ThresholdEstimator()
+{
+}
+
+void
+ThresholdEstimator::SetMode( int mode )
+{
+	switch( mode )
+	{
+		case FIXED:
+		case OTSU:
+		case AMORTIZED:
+			if( mode != m_mode )
+			{
+				m_initialized = false;
+			}
+			m_mode = (Mode)mode;
+			break;
+		default:
+			m_mode = OTSU;
+			break;
+	}
+}
+
+ThresholdEstimator::Mode
+ThresholdEstimator::GetMode() const
+{
+	return m_mode;
+}
+
+void
+ThresholdEstimator::SetFixedThreshold( double threshold )
+{
+	m_fixed_threshold = threshold;
+}
+
+void
+ThresholdEstimator::SetAmortization( int interval, int subsample, double drift, double alpha )
+{
+	m_interval = std::max( 1, interval );
+	m_subsample = std::max( 1, subsample );
+	m_drift = drift;
+	m_alpha = std::min( 1.0, std::max( 0.0, alpha ) );
+}
+
+void
+ThresholdEstimator::BeginFrame()
+{
+	m_first_look = true;
+	m_look_share = 0;
+	m_frame_updated = false;
+}
+
+int
+ThresholdEstimator::Estimate( const IplImage* gray )
+{
+	m_updated = false;
+	bool wider = IsWider( gray );
+
+	if( m_mode == FIXED )
+	{
+		m_threshold = m_fixed_threshold;
+	}
+	else if( m_mode == OTSU && ( m_first_look || wider ) )
+	{
+		unsigned int histogram[256];
+		ForegroundKernels::Histogram( gray, histogram );
+		m_threshold = ForegroundKernels::OtsuThreshold( histogram );
+		m_look_share = Share( gray );
+		m_updated = true;
+	}
+	else if( m_mode == AMORTIZED && m_first_look )
+	{
+		m_threshold_before = m_threshold;
+		m_initialized_before = m_initialized;
+
+		double mean = SampleMean( gray, m_subsample );
+		if( IsDue( mean, gray ) )
+		{
+			unsigned int histogram[256];
+			SampleHistogram( gray, m_subsample, histogram );
+			Update( histogram );
+			m_frame_updated = true;
+		}
+		m_look_share = Share( gray );
+	}
+	else if( m_mode == AMORTIZED && wider && m_frame_updated )
+	{
+		// The update of this frame is made again from the larger region, not blended in twice.
+		m_threshold = m_threshold_before;
+		m_initialized = m_initialized_before;
+
+		unsigned int histogram[256];
+		SampleHistogram( gray, m_subsample, histogram );
+		Update( histogram );
+		m_look_share = Share( gray );
+	}
+
+	m_first_look = false;
+	m_learn_pending = false;
+
+	return (int)floor( m_threshold + 0.5 );
+}
+
+bool
+ThresholdEstimator::NeedsImage( const IplImage* gray ) const
+{
+	if( m_mode == OTSU )
+	{
+		return m_first_look || IsWider( gray );
+	}
+	if( m_mode == AMORTIZED )
+	{
+		return ( m_first_look && !m_initialized ) || ( m_frame_updated && IsWider( gray ) );
+	}
+
+	return false;
+}
+
+int
+ThresholdEstimator::EstimateAhead()
+{
+	m_updated = false;
+
+	if( m_mode == FIXED )
+	{
+		m_threshold = m_fixed_threshold;
+	}
+
+	// The first look at a frame in AMORTIZED mode checks the histogram of this frame for the next.
+	m_learn_pending = m_mode == AMORTIZED && m_first_look;
+	if( m_learn_pending )
+	{
+		m_threshold_before = m_threshold;
+		m_initialized_before = m_initialized;
+	}
+	m_first_look = false;
+
+	return (int)floor( m_threshold + 0.5 );
+}
+
+bool
+ThresholdEstimator::WantsHistogram() const
+{
+	return m_learn_pending;
+}
+
+void
+ThresholdEstimator::Learn( const IplImage* mask, const unsigned int* histogram )
+{
+	if( !m_learn_pending )
+	{
+		return;
+	}
+	m_learn_pending = false;
+
+	double sum = 0;
+	double count = 0;
+	for( int i = 0; i < 256; i++ )
+	{
+		sum += (double)i * histogram[i];
+		count += histogram[i];
+	}
+	double mean = count > 0 ? sum / count : 0;
+
+	if( IsDue( mean, mask ) )
+	{
+		Update( histogram );
+		m_frame_updated = true;
+	}
+	m_look_share = Share( mask );
+}
+
+double
+ThresholdEstimator::GetThreshold() const
+{
+	return m_threshold;
+}
+
+bool
+ThresholdEstimator::WasUpdated() const
+{
+	return m_updated;
+}
+
+double
+ThresholdEstimator::SampleMean( const IplImage* gray, int subsample ) const
+{
+	CvRect roi = cvGetImageROI( gray );
+	double sum = 0;
+	int count = 0;
+
+	for( int y = 0; y < roi.height; y += subsample )
+	{
+		const unsigned char* pixels = (const unsigned char*)( gray->imageData + ( roi.y + y ) * gray->widthStep + roi.x );
+		for( int x = 0; x < roi.width; x += subsample )
+		{
+			sum += pixels[x];
+			count++;
+		}
+	}
+
+	return count ? sum / count : 0;
+}
+
+bool
+ThresholdEstimator::IsDue( double mean, const IplImage* gray )
+{
+	CvRect region = cvGetImageROI( gray );
+	bool same_region = gray->width == m_mean_size.width && gray->height == m_mean_size.height &&
+					   region.x == m_mean_region.x && region.y == m_mean_region.y &&
+					   region.width == m_mean_region.width && region.height == m_mean_region.height;
+
+	/**
+	 * The mean depends on what is in the region, so it only shows a change of the lighting if it is
+	 * compared with the mean of the same region. When the region has moved (the tracking window
+	 * follows the target) the drift is measured from the new region on, until then only the
+	 * interval triggers an estimate.
+	 */
+	bool due = !m_initialized || ++m_frames_since_update >= m_interval ||
+			   ( same_region && fabs( mean - m_mean_at_update ) > m_drift );
+
+	if( due || !same_region )
+	{
+		m_mean_at_update = mean;
+		m_mean_region = region;
+		m_mean_size = cvSize( gray->width, gray->height );
+	}
+
+	return due;
+}
+
+void
+ThresholdEstimator::Update( const unsigned int* histogram )
+{
+	double threshold = ForegroundKernels::OtsuThreshold( histogram );
+
+	m_threshold = m_initialized ? m_alpha * threshold + ( 1.0 - m_alpha ) * m_threshold : threshold;
+	m_frames_since_update = 0;
+	m_initialized = true;
+	m_updated = true;
+}
+
+double
+ThresholdEstimator::Share( const IplImage* gray )
+{
+	CvRect roi = cvGetImageROI( gray );
+	return ( (double)roi.width * roi.height ) / ( (double)gray->width * gray->height );
+}
+
+bool
+ThresholdEstimator::IsWider( const IplImage* gray ) const
+{
+	return !m_first_look && Share( gray ) > m_look_share;
+}
+
+void
+ThresholdEstimator::SampleHistogram( const IplImage* gray, int subsample, unsigned int* histogram ) const
+{
+	CvRect roi = cvGetImageROI( gray );
+	std::fill( histogram, histogram + 256, 0 );
+
+	for( int y = 0; y < roi.height; y += subsample )
+	{
+		const unsigned char* pixels = (const unsigned char*)( gray->imageData + ( roi.y + y ) * gray->widthStep + roi.x );
+		for( int x = 0; x < roi.width; x += subsample )
+		{
+			histogram[pixels[x]]++;
+		}
+	}
+}
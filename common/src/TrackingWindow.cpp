@@ -0,0 +1,132 @@
+/*
+ * TrackingWindow.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "TrackingWindow.h"
+
+#include <algorithm>
+
+TrackingWindow::TrackingWindow()
+{
+	m_margin = 1.5;
+	m_padding = 32;
+	m_growth = 2.0;
+	m_max_steps = 2;
+
+	Reset();
+}
+
+TrackingWindow::~TrackingWindow()
+{
+}
+
+void
+TrackingWindow::SetParameters( double margin, int padding, double growth, int max_steps )
+{
+	m_margin = margin;
+	m_padding = padding;
+	m_growth = growth;
+	m_max_steps = max_steps;
+}
+
+void
+TrackingWindow::Reset()
+{
+	m_has_target = false;
+	m_has_motion = false;
+	m_step = 0;
+
+	m_center_x = 0;
+	m_center_y = 0;
+	m_velocity_x = 0;
+	m_velocity_y = 0;
+	m_target_width = 0;
+	m_target_height = 0;
+}
+
+void
+TrackingWindow::Update( double center_x, double center_y, int target_width, int target_height )
+{
+	if( m_has_target )
+	{
+		m_velocity_x = center_x - m_center_x;
+		m_velocity_y = center_y - m_center_y;
+		m_has_motion = true;
+	}
+
+	m_center_x = center_x;
+	m_center_y = center_y;
+	m_target_width = target_width;
+	m_target_height = target_height;
+
+	m_has_target = true;
+	m_step = 0;
+}
+
+bool
+TrackingWindow::Widen()
+{
+	if( IsFullFrame() )
+	{
+		return false;
+	}
+
+	m_step++;
+	return true;
+}
+
+bool
+TrackingWindow::IsFullFrame() const
+{
+	return !m_has_target || m_step > m_max_steps;
+}
+
+CvRect
+TrackingWindow::GetRect( CvSize frame_size ) const
+{
+	if( IsFullFrame() )
+	{
+		return cvRect( 0, 0, frame_size.width, frame_size.height );
+	}
+
+	double scale = m_margin;
+	for( int i = 0; i < m_step; i++ )
+	{
+		scale *= m_growth;
+	}
+
+	double predicted_x = m_center_x;
+	double predicted_y = m_center_y;
+	if( m_has_motion )
+	{
+		predicted_x += m_velocity_x;
+		predicted_y += m_velocity_y;
+	}
+
+	int half_width = (int)( m_target_width * scale / 2.0 ) + m_padding;
+	int half_height = (int)( m_target_height * scale / 2.0 ) + m_padding;
+
+	int x0 = std::max( 0, (int)predicted_x - half_width );
+	int y0 = std::max( 0, (int)predicted_y - half_height );
+	int x1 = std::min( frame_size.width, (int)predicted_x + half_width );
+	int y1 = std::min( frame_size.height, (int)predicted_y + half_height );
+
+	if( x1 <= x0 || y1 <= y0 )
+	{
+		// The prediction left the frame, there is nothing sensible to crop to.
+		return cvRect( 0, 0, frame_size.width, frame_size.height );
+	}
+
+	return cvRect( x0, y0, x1 - x0, y1 - y0 );
+}
+
+bool
+TrackingWindow::IsOnBorder( CvRect window, CvSize frame_size, int min_x, int min_y, int max_x, int max_y ) const
+{
+	return ( min_x <= window.x && window.x > 0 ) ||
+		   ( min_y <= window.y && window.y > 0 ) ||
+		   ( max_x >= window.x + window.width - 1 && window.x + window.width < frame_size.width ) ||
+		   ( max_y >= window.y + window.height - 1 && window.y + window.height < frame_size.height );
+}
@@ -0,0 +1,189 @@
+/*
+ * VelocityCommandOutput.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "VelocityCommandOutput.h"
+
+#include <boost/units/systems/si.hpp>
+#include <boost/units/io.hpp>
+
+VelocityCommandOutput::VelocityCommandOutput()
+{
+	m_base_sent = false;
+	m_arm_sent = false;
+	m_period = 0;
+}
+
+VelocityCommandOutput::~VelocityCommandOutput()
+{
+}
+
+void
+VelocityCommandOutput::Advertise( ros::NodeHandle& node_handler, bool arm, const std::vector<std::string>& arm_joint_names )
+{
+	m_base_publisher = node_handler.advertise<geometry_msgs::Twist>( "/cmd_vel", 1 );
+	m_base_command = geometry_msgs::Twist();
+	m_base_sent = false;
+
+	m_arm_command.velocities.clear();
+	m_arm_sent = false;
+
+	if( arm )
+	{
+		m_arm_publisher = node_handler.advertise<brics_actuator::JointVelocities>( "/arm_controller/velocity_command", 1 );
+
+		/**
+		 * Every joint gets an entry, the ones we do not move are kept at 0. If we do not do this we
+		 * could get uncontrolled movements from values that had previously been sent.
+		 */
+		std::string unit = boost::units::to_string( boost::units::si::radian_per_second );
+		for( unsigned int i = 0; i < arm_joint_names.size(); i++ )
+		{
+			brics_actuator::JointValue joint_value;
+			joint_value.joint_uri = arm_joint_names[i];
+			joint_value.unit = unit;
+			joint_value.value = 0.0;
+
+			m_arm_command.velocities.push_back( joint_value );
+		}
+	}
+
+	m_sent_arm_velocities.assign( m_arm_command.velocities.size(), 0.0 );
+}
+
+void
+VelocityCommandOutput::Shutdown()
+{
+	if( m_base_publisher )
+	{
+		m_base_publisher.publish( geometry_msgs::Twist() );
+		m_base_publisher.shutdown();
+	}
+
+	if( m_arm_publisher )
+	{
+		ros::Time now = ros::Time::now();
+		for( unsigned int i = 0; i < m_arm_command.velocities.size(); i++ )
+		{
+			m_arm_command.velocities[i].value = 0.0;
+			m_arm_command.velocities[i].timeStamp = now;
+		}
+
+		m_arm_publisher.publish( m_arm_command );
+		m_arm_publisher.shutdown();
+	}
+}
+
+void
+VelocityCommandOutput::SetRate( double rate )
+{
+	m_period = ( rate > 0 ) ? 1.0 / rate : 0;
+}
+
+void
+VelocityCommandOutput::SetBaseLinearX( double velocity )
+{
+	m_base_command.linear.x = velocity;
+}
+
+void
+VelocityCommandOutput::SetBaseLinearY( double velocity )
+{
+	m_base_command.linear.y = velocity;
+}
+
+void
+VelocityCommandOutput::SetArmJointVelocity( unsigned int joint, double velocity )
+{
+	if( joint < m_arm_command.velocities.size() )
+	{
+		m_arm_command.velocities[joint].value = velocity;
+	}
+}
+
+double
+VelocityCommandOutput::GetBaseLinearX() const
+{
+	return m_base_command.linear.x;
+}
+
+double
+VelocityCommandOutput::GetBaseLinearY() const
+{
+	return m_base_command.linear.y;
+}
+
+double
+VelocityCommandOutput::GetArmJointVelocity( unsigned int joint ) const
+{
+	return ( joint < m_arm_command.velocities.size() ) ? m_arm_command.velocities[joint].value : 0.0;
+}
+
+int
+VelocityCommandOutput::Flush()
+{
+	int sent = 0;
+	ros::WallTime now = ros::WallTime::now();
+
+	if( m_base_publisher )
+	{
+		const geometry_msgs::Twist& base = m_base_command;
+		const geometry_msgs::Twist& last = m_sent_base_command;
+
+		bool is_zero = base.linear.x == 0 && base.linear.y == 0 && base.linear.z == 0 &&
+					   base.angular.x == 0 && base.angular.y == 0 && base.angular.z == 0;
+		bool was_zero = last.linear.x == 0 && last.linear.y == 0 && last.linear.z == 0 &&
+						last.angular.x == 0 && last.angular.y == 0 && last.angular.z == 0;
+
+		if( !m_base_sent || ShouldSend( is_zero, was_zero, m_base_sent_time, now ) )
+		{
+			m_base_publisher.publish( m_base_command );
+			m_sent_base_command = m_base_command;
+			m_base_sent_time = now;
+			m_base_sent = true;
+			sent |= BASE;
+		}
+	}
+
+	if( m_arm_publisher )
+	{
+		bool is_zero = true;
+		bool was_zero = true;
+		for( unsigned int i = 0; i < m_arm_command.velocities.size(); i++ )
+		{
+			is_zero = is_zero && m_arm_command.velocities[i].value == 0;
+			was_zero = was_zero && m_sent_arm_velocities[i] == 0;
+		}
+
+		if( !m_arm_sent || ShouldSend( is_zero, was_zero, m_arm_sent_time, now ) )
+		{
+			// One time stamp for all of the joints.
+			ros::Time stamp = ros::Time::now();
+			for( unsigned int i = 0; i < m_arm_command.velocities.size(); i++ )
+			{
+				m_arm_command.velocities[i].timeStamp = stamp;
+				m_sent_arm_velocities[i] = m_arm_command.velocities[i].value;
+			}
+
+			m_arm_publisher.publish( m_arm_command );
+			m_arm_sent_time = now;
+			m_arm_sent = true;
+			sent |= ARM;
+		}
+	}
+
+	return sent;
+}
+
+bool
+VelocityCommandOutput::ShouldSend( bool is_zero, bool was_zero, const ros::WallTime& last_sent, const ros::WallTime& now ) const
+{
+	if( is_zero )
+	{
+		return !was_zero;
+	}
+
+	return ( now - last_sent ).toSec() >= m_period;
+}
@@ -7,15 +7,19 @@
 
 #include "VisualServoing2D.h"
 
+#include <cstring>
+
 VisualServoing2D::VisualServoing2D( bool debugging,
 									int mode,
-									std::vector<std::string> arm_joint_names )
+									std::vector<std::string> arm_joint_names,
+									ImageBufferPool* buffer_pool ) :
+	m_proximity_monitor( m_node_handler, "/is_robot_to_close_to_obstacle" ),
+	m_debug_renderer( m_node_handler ),
+	m_buffer_pool( buffer_pool ? *buffer_pool : m_own_buffer_pool )
 {
 	g_debugging = debugging;
 	g_operating_mode = mode;
 
-	m_first_pass = true;
-	m_is_blob_lost = false;
 	m_done_base_x_adjustment = true;
 	m_done_base_y_adjustment = true;
 	m_done_arm_rot_adjustment = true;
@@ -24,11 +28,42 @@ VisualServoing2D::VisualServoing2D( bool debugging,
 	m_head_left = false;
 	m_head_right = true;
 
+	m_tracked_x = 0;
+	m_tracked_y = 0;
+
+	m_gripper_position = 0;
+	m_config_changed = false;
+	m_control_config_changed = false;
+	m_too_close = false;
+
+	m_requested_target_id = -1;
+	m_frame_allocations = 0;
+
+	// Until a configuration arrives the controllers move as the visual servoing always did.
+	m_x_controller.SetLimits( m_x_velocity, 0, 0 );
+	m_x_controller.SetDeadBand( m_x_threshold );
+	m_y_controller.SetLimits( m_y_velocity, 0, 0 );
+	m_y_controller.SetDeadBand( m_y_threshold );
+	m_rot_controller.SetLimits( m_rot_velocity, 0, 0 );
+	m_rot_controller.SetDeadBand( m_rot_tolerance );
+	m_control_dt = m_nominal_control_period;
+	m_grasp_lead = 1.0;
+
+	memset( &m_timings, 0, sizeof( m_timings ) );
+	memset( &m_command_timestamps, 0, sizeof( m_command_timestamps ) );
+
 	m_background_image = LoadBackgroundImage();
+	m_background_mask.SetBackground( m_background_image );
+	m_debug_renderer.SetBackground( m_background_image );
+	m_debug_topic = "visual_servoing_hud";
+
+	ResetSession();
+
+	m_blob_labeler.SetAreaLimits( m_min_blob_area, m_max_blob_area );
 
 	m_arm_joint_names = arm_joint_names;
 
-	m_safe_cmd_vel_service = m_node_handler.serviceClient<hbrs_srvs::ReturnBool>("/is_robot_to_close_to_obstacle");
+	ROS_INFO( "Foreground kernels use %s", ForegroundKernels::GetName( ForegroundKernels::GetInstructionSet() ) );
 
 	if( g_debugging )
 	{
@@ -50,47 +85,81 @@ VisualServoing2D::VisualServoing2D( bool debugging,
 
 VisualServoing2D::~VisualServoing2D()
 {
-	cvDestroyWindow( "Original" );
-	cvDestroyWindow( "Thresholding" );
-	cvDestroyWindow( "Found Blobs" );
-	cvDestroyWindow( "Background Image" );
+	m_debug_renderer.Stop();
 
 	DestroyPublishers();
+
+	if( m_background_image )
+	{
+		cvReleaseImage( &m_background_image );
+	}
 }
 
 int
 VisualServoing2D::VisualServoing( IplImage* input_image )
 {
-	bool return_val = 0;
+	// Kept across frames so that the table of tracked objects is not allocated again every frame.
+	TargetObservation& observation = m_observation;
+	ImageFrame frame;
+	frame.Wrap( input_image );
 
+	observation.timestamps.image = LatencyMonitor::Now();
+	observation.timestamps.ingest = observation.timestamps.image;
+
+	if( !DetectTarget( frame, observation ) )
+	{
+		return 0;
+	}
+	observation.timestamps.detected = m_latency_monitor.RecordSince( LatencyMonitor::DETECT, observation.timestamps.ingest );
+
+	return ServoToTarget( observation );
+}
+
+bool
+VisualServoing2D::DetectTarget( const ImageFrame& frame, TargetObservation& observation )
+{
 	double x_offset = 0;
 	double y_offset = 0;
 	double rot_offset = 0;
 
-	IplImage* cv_image  ;
-	IplImage* blob_image;
-
-	CBlobGetOrientation get_orientation;
+	int     tracked_blob = -1;
 
-	CBlob   temp_tracked_blob;
-	double  temp_tracked_blob_distance = 0;
+	observation.status = 0;
+	observation.found = false;
+	observation.x_offset = 0;
+	observation.y_offset = 0;
+	observation.rot_offset = 0;
+	observation.time_to_intercept = -1;
+	observation.target_id = -1;
+	observation.stamp = 0;
+	observation.blob_count = 0;
+	observation.tracked_x = 0;
+	observation.tracked_y = 0;
+	observation.quality_level = m_quality_scheduler.GetLevel();
 
-	double maxx;
-	double minx;
-	double maxy;
-	double miny;
-	double temp_x;
-	double temp_y;
-	double dist_x;
-	double dist_y;
-	double distance;
+	memset( &m_timings, 0, sizeof( m_timings ) );
 
-	if( !input_image )
+	if( !frame.IsValid() )
 	{
 		ROS_ERROR( "Error in input image!" );
 		return false;
 	}
 
+	ApplyDynamicVariables();
+
+	/**
+	 * Every scratch image used below comes from the buffer pool, so after the first few frames no
+	 * image memory should be allocated at all. The pool may be shared with other streams, so the
+	 * allocations of this one are counted here.
+	 */
+	m_threshold_estimator.BeginFrame();
+	ROS_DEBUG( "Image buffer allocations in last frame: %u (total %u)",
+			   m_frame_allocations, m_buffer_pool.GetTotalAllocations() );
+	m_frame_allocations = 0;
+
+	int64 frame_ticks = cvGetTickCount();
+	QualityScheduler::Level quality = m_quality_scheduler.GetLevel();
+
 	/**
 	 * We now need to check and see if we have been lost for longer than the lost timeout.
 	 */
@@ -98,7 +167,8 @@ VisualServoing2D::VisualServoing( IplImage* input_image )
 	{
 		if( ( ros::Time::now() - m_time_when_lost ).toSec() < m_lost_blob_timeout )
 		{
-			return 2;
+			observation.status = 2;
+			return true;
 		}
 	}
 
@@ -120,37 +190,105 @@ g only at a region of interest instead of the whole image.
 		cv_image = input_image;
 	}
 |*/					
-	cv_image = input_image;
+	CvSize frame_size = frame.GetSize();
+
+	m_image_height = frame_size.height;
+	m_image_width = frame_size.width;
+
+	/**
+	 * On high resolution cameras the blobs can be found on a downscaled copy of the image. The
+	 * tracked blob is then refined at full resolution inside its bounding box only.
+	 */
+	int scale = std::max( 1, m_dynamic_variables.detection_scale );
+	if( quality >= QualityScheduler::HALF_RESOLUTION )
+	{
+		scale = std::max( 2, scale );
+	}
+	CvSize detection_size = cvSize( m_image_width / scale, m_image_height / scale );
 
-	m_image_height = cv_image->height;
-	m_image_width = cv_image->width;
+	PooledImage gray( m_buffer_pool, detection_size, IPL_DEPTH_8U, 1, &m_frame_allocations );
+	IplImage* luma = NULL;
+	if( scale > 1 )
+	{
+		luma = m_buffer_pool.Acquire( frame_size, IPL_DEPTH_8U, 1, &m_frame_allocations );
+	}
 
-	// TODO: Modify the program so that it can still run without a background image!
-	IplImage* background_threshold = cvCreateImage( cvGetSize( m_background_image ), 8, 1 );
-	cvCvtColor( m_background_image, background_threshold, CV_BGR2GRAY );
-	cvSmooth( background_threshold, background_threshold, CV_GAUSSIAN, 11, 11 );
-	cvThreshold( background_threshold, background_threshold, m_dynamic_variables.binary_threshold , 255, CV_THRESH_BINARY_INV | CV_THRESH_OTSU );
+	/**
+	 * While we are tracking a blob we only process a window around the position where we expect to
+	 * find it. If the blob is not in the window, or might have been cut off by it, the window is
+	 * widened step by step until we end up searching the full frame. With a latency budget the
+	 * quality scheduler decides whether the window is used.
+	 */
+	bool tracking_window = m_quality_scheduler.IsEnabled() ? ( quality >= QualityScheduler::TRACKING_WINDOW )
+														   : m_dynamic_variables.tracking_window;
+	if( m_first_pass || !tracking_window )
+	{
+		m_tracking_window.Reset();
+	}
 
-	blob_image = cvCreateImage( cvGetSize( cv_image ), IPL_DEPTH_8U, cv_image->nChannels );
+	/**
+	 * All tracked objects are predicted to the time the frame was taken, blobs are then only matched
+	 * with objects whose prediction they are close to. Frames without a time stamp are taken to be
+	 * from now.
+	 */
+	double stamp = frame.GetStamp();
+	if( stamp <= 0 )
+	{
+		stamp = ros::WallTime::now().toSec();
+	}
 
-	IplImage* gray = cvCreateImage( cvGetSize( cv_image ), 8, 1 );
-	cvCvtColor( cv_image, gray, CV_BGR2GRAY );
-	cvSmooth( gray, gray, CV_GAUSSIAN, 11, 11 );
+	m_object_tracker.Predict( stamp );
+	ApplyTargetSelection();
 
-	ROS_WARN_STREAM( "Dynamic Var: " << m_dynamic_variables.binary_threshold ); 
-	cvThreshold( gray, gray, m_dynamic_variables.binary_threshold, 255, CV_THRESH_BINARY_INV | CV_THRESH_OTSU );
+	const ObjectTrack* target = m_object_tracker.FindTrack( m_target_id );
+	if( target )
+	{
+		m_tracked_x = target->filter.GetX();
+		m_tracked_y = target->filter.GetY();
+	}
 
-	//    This takes a background image (the gripper on a white background) and removes
-	//  it from the current image (cv_image). The results are stored again in cv_image.
-	cvSub( gray, background_threshold, gray );
+	/**
+	 * The adaptive background only learns while there is a target, and never from the area where
+	 * the target may be. It learns from the first window of the frame only, so that no pixel is
+	 * learnt from twice when the window is widened.
+	 */
+	CvRect frozen;
+	const CvRect* learn_outside = NULL;
+	if( target )
+	{
+		double half_width;
+		double half_height;
+		target->filter.GetGateBox( half_width, half_height );
+		half_width += target->width / 2;
+		half_height += target->height / 2;
+
+		frozen = cvRect( cvRound( m_tracked_x - half_width ), cvRound( m_tracked_y - half_height ),
+						cvRound( 2 * half_width ) + 1, cvRound( 2 * half_height ) + 1 );
+		learn_outside = &frozen;
+	}
 
-	cvShowImage( "GRAY", gray ); 
+	CvRect window = m_tracking_window.GetRect( frame_size );
+	DetectBlobs( frame, luma, gray, window, scale, m_blobs, learn_outside );
 
-	// Find any blobs that are not white.
-	CBlobResult blobs = CBlobResult( gray, NULL, 0 );
+	int64 ticks = cvGetTickCount();
+	tracked_blob = SelectBlob( window );
+	m_timings.select += Lap( ticks );
 
-	blobs.Filter( blobs, B_EXCLUDE, CBlobGetArea(), B_LESS, m_min_blob_area );
-	blobs.Filter( blobs, B_EXCLUDE, CBlobGetArea(), B_GREATER, m_max_blob_area );
+	while( !m_tracking_window.IsFullFrame() &&
+		   ( tracked_blob < 0 || m_tracking_window.IsOnBorder( window, frame_size,
+															   m_blobs.min_x[tracked_blob], m_blobs.min_y[tracked_blob],
+															   m_blobs.max_x[tracked_blob], m_blobs.max_y[tracked_blob] ) ) )
+	{
+		m_tracking_window.Widen();
+		window = m_tracking_window.GetRect( frame_size );
+		DetectBlobs( frame, luma, gray, window, scale, m_blobs );
+
+		ticks = cvGetTickCount();
+		tracked_blob = SelectBlob( window );
+		m_timings.select += Lap( ticks );
+	}
+
+	ROS_DEBUG( "Processed %d of %d pixels", window.width * window.height, m_image_width * m_image_height );
 
 	//  We will only grab the largest blob on the first pass from that point on we will look for the centroid
 	//  of a blob that is closest to the centroid of the largest blob.
@@ -158,28 +296,48 @@ g only at a region of interest instead of the whole image.
 	{
 	  ROS_DEBUG( "First pass through visual servoing." );
 
-	  CBlob largest_blob;
-	  blobs.GetNthBlob( CBlobGetPerimeter(), 0, largest_blob );
-	  maxx = largest_blob.MaxX();
-	  minx = largest_blob.MinX();
-	  maxy = largest_blob.MaxY();
-	  miny = largest_blob.MinY();
-	  m_tracked_x = ( ( minx + maxx ) / 2 );
-	  m_tracked_y = ( ( miny + maxy ) / 2 );
+	  ticks = cvGetTickCount();
+	  int largest_blob = m_blobs.LargestPerimeter();
+	  if( largest_blob >= 0 )
+	  {
+		m_tracked_x = m_blobs.BoxCenterX( largest_blob );
+		m_tracked_y = m_blobs.BoxCenterY( largest_blob );
+		tracked_blob = largest_blob;
+	  }
+	  m_timings.select += Lap( ticks );
 
 	  m_first_pass = false;
 	}
 
+	/**
+	 * If no blob is close enough to where the target is expected, the target coasts on its
+	 * prediction for a few frames. Once it has coasted for too long the nearest blob is taken again.
+	 */
+	bool coasting = false;
+	if( tracked_blob < 0 && target )
+	{
+		coasting = m_object_tracker.CanCoast( m_target_id );
+		if( !coasting )
+		{
+			ROS_WARN( "The target has not been seen for too long, picking the nearest blob" );
+			tracked_blob = NearestBlob( m_tracked_x, m_tracked_y );
+		}
+	}
+
 	std_msgs::String msg;
-	if( blobs.GetNumBlobs() == 0 )
+	if( tracked_blob < 0 )
 	{
 		std::stringstream ss;
 		ss << "NOT FOUND";
 		msg.data = ss.str();
 
-		ROS_WARN( "We have lost the blob" );
-		m_time_when_lost = ros::Time::now();
-		m_is_blob_lost = true;
+		// A coasting target is not lost yet.
+		if( !coasting )
+		{
+			ROS_WARN( "We have lost the blob" );
+			m_time_when_lost = ros::Time::now();
+			m_is_blob_lost = true;
+		}
 	}
 	else
 	{
@@ -190,71 +348,228 @@ g only at a region of interest instead of the whole image.
 		m_is_blob_lost = false;
 	}
 
-	m_pub_visual_servoing_status.publish( msg );
+	// The publishers only exist while a visual servoing session is running (not in the benchmark).
+	if( m_pub_visual_servoing_status )
+	{
+		m_pub_visual_servoing_status.publish( msg );
+	}
 
-	//  Go through all of the blobs and find the one that is the closest to the previously tracked blob.
-	for( int x = 0; x < blobs.GetNumBlobs(); x++ )
+	if( m_threshold_publisher )
 	{
-	  CBlob  temp_blob;
+		std_msgs::Float64 threshold_msg;
+		threshold_msg.data = m_threshold_estimator.GetThreshold();
+		m_threshold_publisher.publish( threshold_msg );
+	}
 
-	  temp_blob = blobs.GetBlob( x );
+	PooledImage full_gray( m_buffer_pool, frame_size, IPL_DEPTH_8U, 1, &m_frame_allocations );
+	CvRect refined_window = window;
 
-	  maxx = temp_blob.MaxX();
-	  minx = temp_blob.MinX();
-	  maxy = temp_blob.MaxY();
-	  miny = temp_blob.MinY();
-	  temp_x = ( ( minx + maxx ) / 2 );
-	  temp_y = ( ( miny + maxy ) / 2 );
-	  dist_x = ( temp_x ) - ( m_tracked_x );
-	  dist_y = ( temp_y ) - ( m_tracked_y );
-	  distance = sqrt( ( dist_x * dist_x ) + ( dist_y * dist_y ) );
+	if( scale > 1 && tracked_blob >= 0 )
+	{
+		refined_window = RefineBlob( frame, full_gray, tracked_blob );
+	}
 
-	  if( temp_tracked_blob_distance == 0 )
-	  {
-		temp_tracked_blob = temp_blob;
-		temp_tracked_blob_distance = distance;
-		m_tracked_x = temp_x;
-		m_tracked_y = temp_y;
-	  }
-	  else
-	  {
-		if( distance < temp_tracked_blob_distance )
+	// Every blob now belongs to a tracked object, the target among them.
+	m_object_tracker.Update( m_blobs, window, stamp );
+
+	if( tracked_blob >= 0 )
+	{
+		m_tracked_x = m_blobs.BoxCenterX( tracked_blob );
+		m_tracked_y = m_blobs.BoxCenterY( tracked_blob );
+		m_target_id = m_object_tracker.GetBlobTrack( tracked_blob );
+		m_tracking_window.Update( m_tracked_x, m_tracked_y,
+								  m_blobs.max_x[tracked_blob] - m_blobs.min_x[tracked_blob] + 1,
+								  m_blobs.max_y[tracked_blob] - m_blobs.min_y[tracked_blob] + 1 );
+	}
+	else
+	{
+		m_tracking_window.Reset();
+	}
+
+	x_offset = ( m_tracked_x ) - ( m_image_width / 2 );
+	y_offset = ( m_tracked_y ) - ( (m_image_height/2) + m_verticle_offset );
+	if( tracked_blob >= 0 )
+	{
+	  rot_offset = m_blobs.Orientation( tracked_blob );
+	}
+
+	/**
+	 * On the conveyer belt the object cannot be caught up with, so once the belt velocity is known
+	 * the robot is sent to where the object will cross the grasp line and waits for it there.
+	 */
+	target = m_object_tracker.FindTrack( m_target_id );
+	bool has_intercept = false;
+	double intercept_x = 0;
+	double intercept_y = 0;
+
+	if( g_operating_mode == 1 && target )
+	{
+		if( tracked_blob >= 0 && target->filter.GetCorrectedFrames() >= m_min_belt_frames )
 		{
-		  temp_tracked_blob = temp_blob;
-		  temp_tracked_blob_distance = distance;
-		  m_tracked_x = temp_x;
-		  m_tracked_y = temp_y;
+			m_intercept_predictor.AddVelocity( target->filter.GetVelocityX(), target->filter.GetVelocityY() );
+		}
+
+		double grasp_x = m_image_width / 2;
+		double grasp_y = ( m_image_height / 2 ) + m_verticle_offset;
+		double time_to_intercept = 0;
+
+		has_intercept = m_intercept_predictor.Predict( target->filter.GetX(), target->filter.GetY(), grasp_x, grasp_y,
+													   intercept_x, intercept_y, time_to_intercept );
+		if( has_intercept )
+		{
+			x_offset = intercept_x - grasp_x;
+			y_offset = intercept_y - grasp_y;
+			observation.time_to_intercept = time_to_intercept;
 		}
-	  }
 	}
 
-	if( g_debugging )
+	observation.found = ( tracked_blob >= 0 );
+	observation.x_offset = x_offset;
+	observation.y_offset = y_offset;
+	observation.rot_offset = rot_offset;
+	observation.target_id = target ? m_target_id : -1;
+	/**
+	 * The tracker keeps its tracks, so they are copied. The observations are reused from frame to
+	 * frame (see LatestSlot), so the copy goes into storage that is already large enough.
+	 */
+	const std::vector<ObjectTrack>& tracks = m_object_tracker.GetTracks();
+	observation.objects.assign( tracks.begin(), tracks.end() );
+	observation.stamp = stamp;
+	observation.blob_count = m_blobs.Size();
+	observation.tracked_x = m_tracked_x;
+	observation.tracked_y = m_tracked_y;
+
+	m_latency_monitor.Record( LatencyMonitor::CONVERT, (int64_t)( m_timings.convert * 1e6 ) );
+	m_latency_monitor.Record( LatencyMonitor::SMOOTH, (int64_t)( m_timings.smooth * 1e6 ) );
+	m_latency_monitor.Record( LatencyMonitor::THRESHOLD, (int64_t)( m_timings.threshold * 1e6 ) );
+	m_latency_monitor.Record( LatencyMonitor::SUBTRACT, (int64_t)( m_timings.subtract * 1e6 ) );
+	m_latency_monitor.Record( LatencyMonitor::LABEL, (int64_t)( m_timings.label * 1e6 ) );
+	m_latency_monitor.Record( LatencyMonitor::SELECT, (int64_t)( m_timings.select * 1e6 ) );
+
+	/**
+	 * The debug display is drawn by a thread of its own, all that is done here is to hand over a
+	 * copy of the frame every now and then.
+	 */
+	if( m_debug_renderer.IsSnapshotDue() )
 	{
-		//  Draw the blob we are tracking as well as a circle to represent the centroid of that object.
-		temp_tracked_blob.FillBlob( blob_image, CV_RGB( 0, 0, 255 ) );
-		cvCircle( blob_image, cvPoint( m_tracked_x, m_tracked_y ), 10, CV_RGB( 255, 0, 0 ), 2 );
+		m_debug_overlay.x_offset = x_offset;
+		m_debug_overlay.y_offset = y_offset;
+		m_debug_overlay.rot_offset = rot_offset;
+		m_debug_overlay.window = window;
+		m_debug_overlay.center = cvPoint( m_image_width / 2, ( m_image_height / 2 ) + m_verticle_offset );
+		m_debug_overlay.has_target = ( tracked_blob >= 0 );
+		m_debug_overlay.target_id = m_target_id;
+		if( tracked_blob >= 0 )
+		{
+			m_debug_overlay.target_box = cvRect( m_blobs.min_x[tracked_blob], m_blobs.min_y[tracked_blob],
+												 m_blobs.max_x[tracked_blob] - m_blobs.min_x[tracked_blob] + 1,
+												 m_blobs.max_y[tracked_blob] - m_blobs.min_y[tracked_blob] + 1 );
+			m_debug_overlay.tracked = cvPoint( m_tracked_x, m_tracked_y );
+		}
+		m_debug_overlay.has_intercept = has_intercept;
+		m_debug_overlay.intercept = cvPoint( intercept_x, intercept_y );
+
+		m_debug_overlay.object_boxes.clear();
+		m_debug_overlay.object_ids.clear();
+		for( unsigned int i = 0; i < tracks.size(); i++ )
+		{
+			int b = tracks[i].blob;
+			if( b >= 0 )
+			{
+				m_debug_overlay.object_boxes.push_back( cvRect( m_blobs.min_x[b], m_blobs.min_y[b],
+																m_blobs.max_x[b] - m_blobs.min_x[b] + 1,
+																m_blobs.max_y[b] - m_blobs.min_y[b] + 1 ) );
+				m_debug_overlay.object_ids.push_back( tracks[i].id );
+			}
+		}
+
+		m_debug_renderer.TakeSnapshot( frame, gray, m_debug_overlay );
 	}
 
-	x_offset = ( m_tracked_x ) - ( m_image_width / 2 );
-	y_offset = ( m_tracked_y ) - ( (m_image_height/2) + m_verticle_offset );
-	rot_offset = get_orientation( temp_tracked_blob );
-	if( rot_offset > 180 )
+
+	// Only the windows have been written to, everything outside of them is still zero from earlier frames.
+	RegionOfInterest( gray, cvRect( window.x / scale, window.y / scale, window.width / scale, window.height / scale ) );
+	cvSetZero( gray );
+	ImageBufferPool::ResetRegion( gray );
+
+	if( scale > 1 )
+	{
+		RegionOfInterest( full_gray, refined_window );
+		cvSetZero( full_gray );
+		ImageBufferPool::ResetRegion( full_gray );
+
+		m_buffer_pool.Release( luma );
+	}
+
+	/**
+	 * The processing time of the frame decides on the quality of the next ones. The frames that
+	 * return early (while the blob is lost) are not counted, as they are not processed.
+	 */
+	double frame_time = Lap( frame_ticks );
+	if( m_quality_scheduler.Update( frame_time ) )
 	{
-	  rot_offset = rot_offset - 180;
+		ROS_INFO( "Detection quality %s to %s (%.1f ms per frame, budget %.1f ms)",
+				  m_quality_scheduler.GetLevel() > quality ? "lowered" : "raised",
+				  QualityScheduler::GetName( m_quality_scheduler.GetLevel() ),
+				  m_quality_scheduler.GetAverage(), m_dynamic_variables.latency_budget );
 	}
 
+	return true;
+}
+
+int
+VisualServoing2D::ServoToTarget( const TargetObservation& observation )
+{
+	int return_val = 0;
+
+	if( observation.status != 0 )
+	{
+		RecordFlight( observation, observation.status, 0 );
+		return observation.status;
+	}
+
+	m_command_timestamps = observation.timestamps;
+
+	ApplyControlVariables();
+
+	/**
+	 * The controllers need the time since the last control cycle. The first cycle of a run and a
+	 * cycle after a long gap (the blob was lost for a while) assume the nominal camera period.
+	 */
+	ros::WallTime now = ros::WallTime::now();
+	m_control_dt = m_nominal_control_period;
+	if( !m_control_time.isZero() )
+	{
+		double elapsed = ( now - m_control_time ).toSec();
+		if( elapsed > 0 && elapsed < m_max_control_period )
+		{
+			m_control_dt = elapsed;
+		}
+	}
+	m_control_time = now;
+
+	double x_offset = observation.x_offset;
+	double y_offset = observation.y_offset;
+	double rot_offset = observation.rot_offset;
+
 	bool done_x = false;
 	bool done_y = false;
 	bool done_t = false;
 
-	if( m_gripper_position < 1.91622 )
+	float gripper_position;
+	{
+		boost::mutex::scoped_lock lock( m_gripper_mutex );
+		gripper_position = m_gripper_position;
+	}
+
+	if( gripper_position < 1.91622 )
 	{
 		m_head_left = false;
 		m_head_right = true;
 		done_x = BaseAdjustmentX( y_offset );
 		done_y = BaseAdjustmentY( x_offset );
 	}
-	else if( m_gripper_position > 3.9277 )
+	else if( gripper_position > 3.9277 )
 	{
 		m_head_left = true;
 		m_head_right = false;
@@ -270,51 +585,42 @@ g only at a region of interest instead of the whole image.
 	}
 	done_t = ArmAdjustment( rot_offset );
 
-	if( done_x && done_y && done_t )
+	// A single base and arm command for the whole control cycle.
+	int sent = m_command_output.Flush();
+	if( sent & VelocityCommandOutput::BASE )
 	{
-		return_val = 1;
-		DestroyPublishers();
-		ROS_INFO( "Visual Servoing Completed." );
+		RecordCommand( LatencyMonitor::BASE_COMMAND );
 	}
-
-
-	if( g_debugging )
+	if( sent & VelocityCommandOutput::ARM )
 	{
-		// Setting up fonts for overlay information.
-		CvFont font;
-		cvInitFont(&font, CV_FONT_HERSHEY_SIMPLEX, 1.0, 1.0, 0, 1, CV_AA);
-
-		cvLine( blob_image,   cvPoint( 0, (m_image_height/2) + m_verticle_offset ), cvPoint( m_image_width, (m_image_height/2) + m_verticle_offset ), CV_RGB( 255, 0, 0 ), 2, 0 );
-		cvLine( blob_image,   cvPoint( (m_image_width/2), 0 ), cvPoint( (m_image_width/2), m_image_height ), CV_RGB( 255, 0, 0 ), 2, 0 );
-		cvRectangle( blob_image, cvPoint( 0, blob_image->height-m_verticle_offset ), cvPoint( blob_image->width, blob_image->height ), CV_RGB( 0, 0, 0 ), -1 );
-
-		std::string x_str = "X: ";
-		x_str += boost::lexical_cast<std::string>( x_offset );
-
-		std::string y_str = "Y: ";
-		y_str += boost::lexical_cast<std::string>( y_offset );
-
-		std::string rot_str = "Rotation: ";
-		rot_str += boost::lexical_cast<std::string>( rot_offset );
-
-		cvPutText( blob_image, x_str.c_str(), cvPoint( 10, blob_image->height - 10 ), &font, CV_RGB( 255, 0, 0 ) );
-		cvPutText( blob_image, y_str.c_str(),  cvPoint( 185, blob_image->height - 10 ), &font, CV_RGB( 255, 0, 0 ) );
-		cvPutText( blob_image, rot_str.c_str(), cvPoint( 350, blob_image->height - 10 ), &font, CV_RGB( 255, 0, 0 ) );
-
-		HUD("b-it-bots Visual Servoing", 3, cv_image, m_background_image, blob_image );
-		cvSetZero( blob_image );
-		cvWaitKey( 10 );
+		RecordCommand( LatencyMonitor::ARM_COMMAND );
 	}
 
+	/**
+	 * On the conveyer belt the robot may be in place long before the object arrives. The grasp is
+	 * only started when the object is due at the grasp line within the time the grasp takes.
+	 */
+	if( done_x && done_y && done_t && observation.time_to_intercept > m_grasp_lead )
+	{
+		ROS_DEBUG( "Waiting for the object, it crosses the grasp line in %.2f s", observation.time_to_intercept );
+	}
+	else if( done_x && done_y && done_t )
+	{
+		return_val = 1;
+		DestroyPublishers();
+		ROS_INFO( "Visual Servoing Completed in %.2f s (%s control).", ( now - m_start_time ).toSec(),
+				  AxisController::GetName( m_x_controller.GetMode() ) );
+	}
 
-	cvSetZero( gray );
-	cvSetZero( cv_image );
-	cvSetZero( blob_image );
-
-	cvReleaseImage( &gray );
-	cvReleaseImage( &blob_image );
+	int flags = ( m_too_close ? FlightRecorder::TOO_CLOSE : 0 ) |
+				( done_x ? FlightRecorder::DONE_X : 0 ) |
+				( done_y ? FlightRecorder::DONE_Y : 0 ) |
+				( done_t ? FlightRecorder::DONE_ROTATION : 0 ) |
+				( ( sent & VelocityCommandOutput::BASE ) ? FlightRecorder::BASE_SENT : 0 ) |
+				( ( sent & VelocityCommandOutput::ARM ) ? FlightRecorder::ARM_SENT : 0 );
+	RecordFlight( observation, return_val, flags );
 
-	return return_val; 
+	return return_val;
 }
 
 bool
@@ -323,25 +629,28 @@ VisualServoing2D::BaseAdjustmentX( double x_offset )
 	bool return_val = false; 
 	double move_speed = 0.0;
 
+	// The velocity has the sign of the offset, the branches below turn it into the base direction.
+	double velocity = m_x_controller.Update( x_offset, m_control_dt );
+
 	if( m_head_left )
 	{
 		if( x_offset > m_x_threshold )
 		{
 			// move the robot base right
-			move_speed = -m_x_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( x_offset < -m_x_threshold )
 		{
 			// move the robot left
-			move_speed = m_x_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( fabs( x_offset ) < m_x_threshold )
 		{
 			move_speed = 0.0;
 			return_val = true;
-			ROS_INFO( "Base Adjustment in X Finished" );
+			ROS_DEBUG( "Base Adjustment in X Finished" );
 		}
 		else
 		{
@@ -354,20 +663,20 @@ VisualServoing2D::BaseAdjustmentX( double x_offset )
 		if( x_offset > m_x_threshold )
 		{
 			// move the robot base right
-			move_speed = m_x_velocity;
+			move_speed = velocity;
 			return_val = false;
 		}
 		else if( x_offset < -m_x_threshold )
 		{
 			// move the robot left
-			move_speed = -m_x_velocity;
+			move_speed = velocity;
 			return_val = false;
 		}
 		else if( fabs( x_offset ) < m_x_threshold )
 		{
 			move_speed = 0.0;
 			return_val = true;
-			ROS_INFO( "Base Adjustment in X Finished" );
+			ROS_DEBUG( "Base Adjustment in X Finished" );
 		}
 		else
 		{
@@ -380,20 +689,20 @@ VisualServoing2D::BaseAdjustmentX( double x_offset )
 		if( x_offset > m_x_threshold )
 		{
 			// move the robot base right
-			move_speed = -m_x_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( x_offset < -m_x_threshold )
 		{
 			// move the robot left
-			move_speed = m_x_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( fabs( x_offset ) < m_x_threshold )
 		{
 			move_speed = 0.0;
 			return_val = true;
-			ROS_INFO( "Base Adjustment in X Finished" );
+			ROS_DEBUG( "Base Adjustment in X Finished" );
 		}
 		else
 		{
@@ -401,9 +710,8 @@ VisualServoing2D::BaseAdjustmentX( double x_offset )
 			move_speed = 0.0;
 		}
 	}
-	// Prepare and then send the base movement commands.
-	m_youbot_base_velocities.linear.y = move_speed;
-	m_base_velocities_publisher.publish( m_youbot_base_velocities );
+	// Prepare the base movement commands, they are sent at the end of the control cycle.
+	m_command_output.SetBaseLinearY( move_speed );
 	return return_val;
 }
 
@@ -413,48 +721,62 @@ VisualServoing2D::BaseAdjustmentY( double y_offset )
 	bool return_val = false; 
 	double move_speed = 0.0;
 
-	if( !m_safe_cmd_vel_service.call( m_service_msg ) )
+	// The proximity is kept up to date in the background, without a recent answer the base must not move closer.
+	ProximityMonitor::Answer proximity = m_proximity_monitor.GetAnswer();
+	m_too_close = ( proximity == ProximityMonitor::TOO_CLOSE );
+
+	// The velocity has the sign of the offset, the branches below turn it into the base direction.
+	double velocity = m_y_controller.Update( y_offset, m_control_dt );
+	double forward_speed = m_head_left ? velocity : -velocity;
+
+	/**
+	 * TODO: Change this so that we only return true when we can no longer line the object up in the
+	 * y direction but the centroid of the blobHelp is still within an emergency range (praying we can
+	 * grasp it). Otherwise we need to return that the object is not able to be grasped due to its
+	 * distance on the platform. We could deal with this either by returning that we cannot move the
+	 * object or to implement a grasp and drag scenario where we grab the last little bit and drag
+	 * it into the frame. This would be the best idea as it would allow us to grab objects which are
+	 * barely in our range and would not be normally graspable.
+	 */
+	if( proximity != ProximityMonitor::CLEAR && fabs( y_offset ) >= m_y_threshold && forward_speed > 0 )
 	{
-		ROS_ERROR( "Visual Servoing call to is_robot_to_close_to_obstacle has failed" );
-		m_service_msg.response.value = false;
-	}
+		// The base does not move towards the obstacle, backing away is still allowed. The controller
+		// starts from standstill again once the way is clear.
+		m_y_controller.Reset();
+		move_speed = 0.0;
 
-	if( m_head_left )
+		if( proximity == ProximityMonitor::TOO_CLOSE )
+		{
+			// The safety node does not allow for movement any longer, so this is as close as the base gets.
+			return_val = true;
+			ROS_DEBUG( "Base Adjustment in Y Finished, too close to an obstacle" );
+		}
+		else
+		{
+			// Without an answer the offset is not known to be unreachable, so we wait for one.
+			return_val = false;
+			ROS_WARN_THROTTLE( 1.0, "Base Adjustment in Y waiting for the obstacle proximity" );
+		}
+	}
+	else if( m_head_left )
 	{
 		if( y_offset >= m_y_threshold )
 		{
 			// move the robot base right
-			move_speed = m_y_velocity;
+			move_speed = velocity;
 			return_val = false;
 		}
 		else if( y_offset <= -m_y_threshold )
 		{
 			// move the robot left
-			move_speed = -m_y_velocity;
+			move_speed = velocity;
 			return_val = false;
 		}
 		else if( fabs( y_offset ) < m_y_threshold )
 		{
 			move_speed = 0.0;
 			return_val = true;
-			ROS_INFO( "Base Adjustment in Y Finished" );
-		}
-		/**
-		 * TODO: Change this so that we only return true when we can no longer line the object up in the
-		 * y direction but the centroid of the blobHelp is still within an emergency range (praying we can
-		 * grasp it). Otherwise we need to return that the object is not able to be grasped due to its
-		 * distance on the platform. We could deal with this either by returning that we cannot move the
-		 * object or to implement a grasp and drag scenario where we grab the last little bit and drag
-		 * it into the frame. This would be the best idea as it would allow us to grab objects which are
-		 * barely in our range and would not be normally graspable.
-		 */
-		else if( m_service_msg.response.value == true )
-		{
-			// This will only be set when the safe_cmd_vel is telling us that it cannot
-			//  allow for movement any longer in this direction.
-			move_speed = 0.0;
-			return_val = true;
-			ROS_INFO( "Base Adjustment in Y Finished" );
+			ROS_DEBUG( "Base Adjustment in Y Finished" );
 		}
 		else
 		{
@@ -468,37 +790,20 @@ VisualServoing2D::BaseAdjustmentY( double y_offset )
 		if( y_offset >= m_y_threshold )
 		{
 			// move the robot base right
-			move_speed = -m_y_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( y_offset <= -m_y_threshold )
 		{
 			// move the robot left
-			move_speed = m_y_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( fabs( y_offset ) < m_y_threshold )
 		{
 			move_speed = 0.0;
 			return_val = true;
-			ROS_INFO( "Base Adjustment in Y Finished" );
-		}
-		/**
-		 * TODO: Change this so that we only return true when we can no longer line the object up in the
-		 * y direction but the centroid of the blobHelp is still within an emergency range (praying we can
-		 * grasp it). Otherwise we need to return that the object is not able to be grasped due to its
-		 * distance on the platform. We could deal with this either by returning that we cannot move the
-		 * object or to implement a grasp and drag scenario where we grab the last little bit and drag
-		 * it into the frame. This would be the best idea as it would allow us to grab objects which are
-		 * barely in our range and would not be normally graspable.
-		 */
-		else if( m_service_msg.response.value == true )
-		{
-			// This will only be set when the safe_cmd_vel is telling us that it cannot
-			//  allow for movement any longer in this direction.
-			move_speed = 0.0;
-			return_val = true;
-			ROS_INFO( "Base Adjustment in Y Finished" );
+			ROS_DEBUG( "Base Adjustment in Y Finished" );
 		}
 		else
 		{
@@ -512,37 +817,20 @@ VisualServoing2D::BaseAdjustmentY( double y_offset )
 		if( y_offset >= m_y_threshold )
 		{
 			// move the robot base right
-			move_speed = -m_y_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( y_offset <= -m_y_threshold )
 		{
 			// move the robot left
-			move_speed = m_y_velocity;
+			move_speed = -velocity;
 			return_val = false;
 		}
 		else if( fabs( y_offset ) < m_y_threshold )
 		{
 			move_speed = 0.0;
 			return_val = true;
-			ROS_INFO( "Base Adjustment in Y Finished" );
-		}
-		/**
-		 * TODO: Change this so that we only return true when we can no longer line the object up in the
-		 * y direction but the centroid of the blobHelp is still within an emergency range (praying we can
-		 * grasp it). Otherwise we need to return that the object is not able to be grasped due to its
-		 * distance on the platform. We could deal with this either by returning that we cannot move the
-		 * object or to implement a grasp and drag scenario where we grab the last little bit and drag
-		 * it into the frame. This would be the best idea as it would allow us to grab objects which are
-		 * barely in our range and would not be normally graspable.
-		 */
-		else if( m_service_msg.response.value == true )
-		{
-			// This will only be set when the safe_cmd_vel is telling us that it cannot
-			//  allow for movement any longer in this direction.
-			move_speed = 0.0;
-			return_val = true;
-			ROS_INFO( "Base Adjustment in Y Finished" );
+			ROS_DEBUG( "Base Adjustment in Y Finished" );
 		}
 		else
 		{
@@ -554,9 +842,8 @@ VisualServoing2D::BaseAdjustmentY( double y_offset )
 
 
 
-	// Prepare and then send the base movement commands.
-	m_youbot_base_velocities.linear.x = move_speed;
-	m_base_velocities_publisher.publish( m_youbot_base_velocities );
+	// Prepare the base movement commands, they are sent at the end of the control cycle.
+	m_command_output.SetBaseLinearX( move_speed );
 
 	return return_val;
 }
@@ -567,6 +854,7 @@ VisualServoing2D::ArmAdjustment( double orientation )
 	bool return_val = false; 
 	double difference = fabs( orientation - m_rot_target );
 	double rotational_speed = 0.0;
+	double velocity = m_rot_controller.Update( orientation - m_rot_target, m_control_dt );
 
 
 	if( orientation > m_rot_target && difference > m_rot_tolerance )
@@ -574,7 +862,7 @@ VisualServoing2D::ArmAdjustment( double orientation )
 		/**
 		 * We are not to far to the right of the object and our difference is not small enough yet.
 		 */
-		rotational_speed = m_rot_velocity;
+		rotational_speed = velocity;
 		return_val = false;
 	}
 	else if( orientation < m_rot_target && difference > m_rot_tolerance )
@@ -582,14 +870,14 @@ VisualServoing2D::ArmAdjustment( double orientation )
 		/**
 		 * we are to far to the left of the object and our difference is still to large.
 		 */
-		rotational_speed = -m_rot_velocity;
+		rotational_speed = velocity;
 		return_val = false;
 	}
 	else if( difference < m_rot_tolerance )
 	{
 		rotational_speed = 0.0;
 		return_val = true;
-		ROS_INFO( "Arm Rotation Finished" );
+		ROS_DEBUG( "Arm Rotation Finished" );
 	}
 	else
 	{
@@ -600,37 +888,11 @@ VisualServoing2D::ArmAdjustment( double orientation )
 		return_val = false;
 	}
 
-	ROS_INFO( "Orientation\t%f", orientation );
-	ROS_INFO( "Difference\t%f", difference );
-
 	/**
-	 * we need to loop though all of the joint states because we need to set anything we do not want
-	 * to move to 0. If we do not do this we could get uncontrolled movements from values that it
-	 * had previously been sent.
+	 * Only the gripper joint is rotated, all other joints are kept at 0 by the command output.
 	 */
-	m_youbot_arm_velocities.velocities.clear();
-	for(unsigned int i=0; i < m_arm_joint_names.size(); ++i)
-	{
-		brics_actuator::JointValue joint_value;
+	m_command_output.SetArmJointVelocity( 4, rotational_speed );
 
-		joint_value.timeStamp = ros::Time::now();
-		joint_value.joint_uri = m_arm_joint_names[i];
-		joint_value.unit = to_string(boost::units::si::radian_per_second);
-
-		if( i == 4 )
-		{
-		  joint_value.value = rotational_speed;
-		}
-		else
-		{
-		  joint_value.value = 0.0;
-		}
-
-		m_youbot_arm_velocities.velocities.push_back(joint_value);
-		
-	}
-
-	m_arm_velocities_publisher.publish( m_youbot_arm_velocities );
 	return return_val;
 }
 
@@ -638,13 +900,27 @@ void
 VisualServoing2D::UpdateGripperPosition( float new_position )
 {
 	ROS_DEBUG( "Gripper position updated inside of VisualServoing2D" );
+	boost::mutex::scoped_lock lock( m_gripper_mutex );
 	m_gripper_position = new_position;
 }
 
+void
+VisualServoing2D::SelectTarget( int id )
+{
+	boost::mutex::scoped_lock lock( m_config_mutex );
+	m_requested_target_id = id;
+}
+
+void
+VisualServoing2D::SetDebugTopic( const std::string& topic )
+{
+	m_debug_topic = topic;
+}
+
 IplImage*
 VisualServoing2D::LoadBackgroundImage()
 {
-	IplImage* background_image;
+	IplImage* background_image = NULL;
 	std::string mode;
 
 	if( g_operating_mode == 0 )
@@ -689,33 +965,364 @@ VisualServoing2D::RegionOfInterest( IplImage* input_image, double scale )
 	int x = ( (input_image->width - width) / 2 );
 	int y = ( (input_image->height - height) / 2 );
 
-	cvSetImageROI( input_image, cvRect( x, y, width, height ) );
+	return RegionOfInterest( input_image, cvRect( x, y, width, height ) );
+}
 
-	if( g_debugging )
+IplImage*
+VisualServoing2D::RegionOfInterest( IplImage* input_image, CvRect window )
+{
+	// The header of the region of interest is kept, so that no memory is allocated for it per frame.
+	ImageBufferPool::SetRegion( input_image, window );
+
+	return input_image;
+}
+
+void
+VisualServoing2D::DetectBlobs( const ImageFrame& frame, IplImage* luma, IplImage* gray, CvRect& window, int scale, BlobTable& blobs,
+							   const CvRect* learn_outside )
+{
+	/**
+	 * The window is aligned to whole pixels of the downscaled image so that it maps exactly onto a
+	 * window of the gray image.
+	 */
+	CvRect detection_window = cvRect( window.x / scale, window.y / scale,
+									  ( window.x + window.width + scale - 1 ) / scale - window.x / scale,
+									  ( window.y + window.height + scale - 1 ) / scale - window.y / scale );
+	detection_window.width = std::min( detection_window.width, gray->width - detection_window.x );
+	detection_window.height = std::min( detection_window.height, gray->height - detection_window.y );
+	window = cvRect( detection_window.x * scale, detection_window.y * scale,
+					 detection_window.width * scale, detection_window.height * scale );
+
+	int64 ticks = cvGetTickCount();
+	int smoothing_size = SmoothingSize( scale );
+	m_smoother.SetMethod( m_dynamic_variables.smoothing_method );
+	m_smoother.SetSize( smoothing_size );
+	IplImage* background_threshold = m_background_mask.GetMask( cvGetSize( gray ), smoothing_size, m_smoother.GetMethod() );
+	RegionOfInterest( gray, detection_window );
+
+	/**
+	 * A BGR window that is neither downscaled nor smoothed is turned into the foreground mask in a
+	 * single pass over the colour pixels, without a gray image in between. The threshold has to be
+	 * known before that pass, so the histogram it counts is only used for the next estimate.
+	 */
+	if( scale == 1 && ( smoothing_size <= 1 || m_smoother.GetMethod() == ImageSmoother::NONE ) &&
+		m_dynamic_variables.background_mode != AdaptiveBackground::ADAPTIVE &&
+		frame.GetEncoding() == ImageFrame::BGR8 && !m_threshold_estimator.NeedsImage( gray ) )
 	{
+		if( background_threshold )
+		{
+			RegionOfInterest( background_threshold, detection_window );
+		}
+
+		int threshold = m_threshold_estimator.EstimateAhead();
+		unsigned int histogram[256];
+		frame.ExtractForeground( background_threshold, threshold,
+								 gray, m_threshold_estimator.WantsHistogram() ? histogram : NULL );
+		m_threshold_estimator.Learn( gray, histogram );
+		ROS_DEBUG_STREAM( "Binary threshold: " << threshold << ( m_threshold_estimator.WasUpdated() ? " (updated)" : "" ) );
+
+		if( background_threshold )
+		{
+			ImageBufferPool::ResetRegion( background_threshold );
+		}
+		m_timings.subtract += Lap( ticks );
 
+		LabelBlobs( gray, scale, blobs );
+		return;
 	}
 
-	return input_image;
+	/**
+	 * Only the gray values of the window are taken from the frame. When detecting at a lower
+	 * resolution the single channel window is downscaled, which is cheaper than scaling the colour
+	 * image.
+	 */
+	if( scale > 1 )
+	{
+		RegionOfInterest( luma, window );
+		frame.ExtractGray( luma );
+		cvResize( luma, gray, CV_INTER_AREA );
+		ImageBufferPool::ResetRegion( luma );
+	}
+	else
+	{
+		frame.ExtractGray( gray );
+	}
+	m_timings.convert += Lap( ticks );
+
+	m_smoother.Smooth( gray );
+	m_timings.smooth += Lap( ticks );
+
+	/**
+	 * The threshold is picked from the smoothed image (or taken from the configuration), after which
+	 * the thresholding and the background removal are done together in a single pass.
+	 */
+	int threshold = m_threshold_estimator.Estimate( gray );
+	ROS_DEBUG_STREAM( "Binary threshold: " << threshold << ( m_threshold_estimator.WasUpdated() ? " (updated)" : "" ) );
+	m_timings.threshold += Lap( ticks );
+
+	//    This takes a background image (the gripper on a white background) and removes
+	//  it from the current image (cv_image). The results are stored again in cv_image.
+	if( m_dynamic_variables.background_mode == AdaptiveBackground::ADAPTIVE )
+	{
+		// The adaptive model starts out as the static mask, the rectangle is scaled to the gray image.
+		CvRect frozen = learn_outside ? cvRect( learn_outside->x / scale, learn_outside->y / scale,
+												learn_outside->width / scale + 1, learn_outside->height / scale + 1 )
+									  : cvRect( 0, 0, 0, 0 );
+		m_adaptive_background.Subtract( gray, background_threshold, threshold, learn_outside != NULL, frozen, gray );
+	}
+	else
+	{
+		if( background_threshold )
+		{
+			RegionOfInterest( background_threshold, detection_window );
+		}
+
+		ForegroundKernels::ThresholdSubtract( gray, background_threshold, threshold, gray );
+
+		if( background_threshold )
+		{
+			ImageBufferPool::ResetRegion( background_threshold );
+		}
+	}
+	m_timings.subtract += Lap( ticks );
+
+	LabelBlobs( gray, scale, blobs );
 }
 
 void
-VisualServoing2D::CreatePublishers( int arm_model )
+VisualServoing2D::LabelBlobs( IplImage* mask, int scale, BlobTable& blobs )
 {
-	// Set up the base velocities publisher:
-	m_base_velocities_publisher = m_node_handler.advertise<geometry_msgs::Twist>( "/cmd_vel", 1 );
-	ROS_INFO( "Robot Base Publisher Setup" );
+	// Find any blobs that are not black, blobs outside of the area limits are dropped while labeling.
+	int64 ticks = cvGetTickCount();
+	m_blob_labeler.SetAreaLimits( m_min_blob_area / ( scale * scale ), m_max_blob_area / ( scale * scale ) );
+	m_blob_labeler.Label( mask, blobs );
+	blobs.Scale( scale );
+	m_timings.label += Lap( ticks );
+
+	ImageBufferPool::ResetRegion( mask );
+}
+
+CvRect
+VisualServoing2D::RefineBlob( const ImageFrame& frame, IplImage* full_gray, int blob )
+{
+	/**
+	 * The bounding box found at the lower resolution can be off by up to a downscaled pixel, so
+	 * the refinement window gets a small margin on every side.
+	 */
+	const int margin = 8;
+	int x0 = std::max( 0, m_blobs.min_x[blob] - margin );
+	int y0 = std::max( 0, m_blobs.min_y[blob] - margin );
+	int x1 = std::min( frame.GetSize().width, m_blobs.max_x[blob] + margin + 1 );
+	int y1 = std::min( frame.GetSize().height, m_blobs.max_y[blob] + margin + 1 );
+	CvRect window = cvRect( x0, y0, x1 - x0, y1 - y0 );
+
+	DetectBlobs( frame, NULL, full_gray, window, 1, m_refined_blobs );
+
+	// Other blobs may poke into the window, the tracked one is the largest blob inside of it.
+	int refined_blob = m_refined_blobs.LargestArea();
+	if( refined_blob >= 0 )
+	{
+		m_blobs.Set( blob, m_refined_blobs, refined_blob );
+	}
 
+	return window;
+}
+
+int
+VisualServoing2D::SmoothingSize( int scale ) const
+{
+	if( m_dynamic_variables.smoothing_size <= 1 || m_quality_scheduler.GetLevel() >= QualityScheduler::NO_SMOOTHING )
+	{
+		return 1;
+	}
+
+	// The kernel shrinks with the image so that it covers the same part of the scene.
+	int size = m_dynamic_variables.smoothing_size / scale;
+	if( size % 2 == 0 )
+	{
+		size++;
+	}
+
+	return std::max( 3, size );
+}
+
+int
+VisualServoing2D::NearestBlob( double x, double y ) const
+{
+	int nearest_blob = -1;
+	double nearest_distance = 0;
+
+	//  Go through all of the blobs and find the one that is the closest to the provided position.
+	for( unsigned int i = 0; i < m_blobs.Size(); i++ )
+	{
+		double dist_x = m_blobs.BoxCenterX( i ) - x;
+		double dist_y = m_blobs.BoxCenterY( i ) - y;
+		double distance = sqrt( ( dist_x * dist_x ) + ( dist_y * dist_y ) );
+
+		if( nearest_blob < 0 || distance < nearest_distance )
+		{
+			nearest_blob = i;
+			nearest_distance = distance;
+		}
+	}
+
+	return nearest_blob;
+}
+
+int
+VisualServoing2D::SelectBlob( CvRect window )
+{
+	m_object_tracker.Associate( m_blobs, cvSize( m_image_width, m_image_height ), window );
+
+	if( !m_object_tracker.FindTrack( m_target_id ) )
+	{
+		return NearestBlob( m_tracked_x, m_tracked_y );
+	}
+
+	return m_object_tracker.GetAssignedBlob( m_target_id );
+}
+
+void
+VisualServoing2D::ApplyTargetSelection()
+{
+	int id;
+	{
+		boost::mutex::scoped_lock lock( m_config_mutex );
+		id = m_requested_target_id;
+		m_requested_target_id = -1;
+	}
+
+	if( id < 0 )
+	{
+		return;
+	}
+
+	if( !m_object_tracker.FindTrack( id ) )
+	{
+		ROS_WARN( "There is no tracked object with ID %d, keeping target %d", id, m_target_id );
+		return;
+	}
+
+	// The new target may be anywhere in the image.
+	m_target_id = id;
+	m_tracking_window.Reset();
+	ROS_INFO( "Switched the target to object %d", id );
+}
+
+void
+VisualServoing2D::ResetSession()
+{
+	m_first_pass = true;
+	m_is_blob_lost = false;
+
+	m_object_tracker.Reset();
+	m_tracking_window.Reset();
+	m_intercept_predictor.Reset();
+	m_adaptive_background.Reset();
+	m_target_id = -1;
+}
+
+double
+VisualServoing2D::Lap( int64& ticks ) const
+{
+	int64 now = cvGetTickCount();
+	double elapsed = ( now - ticks ) / ( cvGetTickFrequency() * 1000.0 );
+	ticks = now;
+
+	return elapsed;
+}
+
+const DetectionTimings&
+VisualServoing2D::GetDetectionTimings() const
+{
+	return m_timings;
+}
+
+LatencyMonitor&
+VisualServoing2D::GetLatencyMonitor()
+{
+	return m_latency_monitor;
+}
+
+FlightRecorder&
+VisualServoing2D::GetFlightRecorder()
+{
+	return m_flight_recorder;
+}
+
+void
+VisualServoing2D::RecordCommand( LatencyMonitor::Stage stage )
+{
+	// Frames that were handed over without timestamps are not counted.
+	if( m_command_timestamps.image != 0 )
+	{
+		m_latency_monitor.RecordSince( stage, m_command_timestamps.image );
+	}
+}
+
+void
+VisualServoing2D::RecordFlight( const TargetObservation& observation, int status, int flags )
+{
+	FlightRecord record;
+	memset( &record, 0, sizeof( record ) );
+
+	record.stamp = observation.stamp;
+	record.image_time = observation.timestamps.image;
+	record.detected_time = observation.timestamps.detected;
+	record.control_time = LatencyMonitor::Now();
+	record.status = status;
+	record.target_id = observation.target_id;
+	record.blob_count = std::min( observation.blob_count, 0xffffu );
+	record.flags = flags | ( observation.found ? FlightRecorder::FOUND : 0 );
+	record.tracked_x = observation.tracked_x;
+	record.tracked_y = observation.tracked_y;
+	record.x_offset = observation.x_offset;
+	record.y_offset = observation.y_offset;
+	record.rot_offset = observation.rot_offset;
+
+	// Nothing is commanded for an observation that ends the visual servoing.
+	if( observation.status == 0 )
+	{
+		record.base_x = m_command_output.GetBaseLinearX();
+		record.base_y = m_command_output.GetBaseLinearY();
+		record.arm_rotation = m_command_output.GetArmJointVelocity( 4 );
+	}
+
+	m_flight_recorder.Record( record );
+}
+
+void
+VisualServoing2D::CreatePublishers( int arm_model )
+{
 	m_pub_visual_servoing_status = m_node_handler.advertise<std_msgs::String>( "/visual_servoing_status", 1 );
 	ROS_INFO( "VISUAL SERVOING STATUS PUBLSHING" );
 
+	// The binary threshold that is in use, which is only fixed if the threshold mode is Fixed.
+	m_threshold_publisher = m_node_handler.advertise<std_msgs::Float64>( "/visual_servoing_threshold", 1 );
+
+	m_flight_recorder.BeginSession();
+	ResetSession();
+
+	// Only ask the safety node about obstacles while the base may be moved.
+	m_proximity_monitor.Start();
+
+	// A new run starts from standstill.
+	m_x_controller.Reset();
+	m_y_controller.Reset();
+	m_rot_controller.Reset();
+	m_control_time = ros::WallTime();
+	m_start_time = ros::WallTime::now();
+
+	// Set up the base (and arm) velocities publishers:
+	m_command_output.Advertise( m_node_handler, arm_model == 1, m_arm_joint_names );
+	ROS_INFO( "Robot Base Publisher Setup" );
+
 	if( arm_model == 0 )
 	{
 		ROS_INFO( "The robot has no arm to move." );
 	}
 	else if( arm_model == 1 )
 	{
-		m_arm_velocities_publisher = m_node_handler.advertise<brics_actuator::JointVelocities>( "/arm_controller/velocity_command", 1 );
 		ROS_INFO( "KUKA YouBot Arm Publisher is set up" );
 	}
 	else if( arm_model == 2 )
@@ -732,145 +1339,91 @@ void
 VisualServoing2D::DestroyPublishers()
 {
 	/**
-	 * Zero and shutdown the base velcoity publisher.
-	 */
-	geometry_msgs::Twist zero_vel;
-	m_base_velocities_publisher.publish( zero_vel );
-	m_base_velocities_publisher.shutdown();
-	ROS_INFO( "Base velocity publisher zeroed and shutdown" );
-
-	/**
-	 * Zero and shutdown the arm velocity publisher.
+	 * Zero and shutdown the base and arm velocity publishers.
 	 */
-	brics_actuator::JointVelocities zero_arm_vel;
-	m_arm_velocities_publisher.publish( zero_arm_vel );
-	m_arm_velocities_publisher.shutdown();
-	ROS_INFO( "Arm velcoity publisher zeroed and shutdown" );
-}
+	m_command_output.Shutdown();
+	ROS_INFO( "Base and arm velocity publishers zeroed and shutdown" );
 
-void
-VisualServoing2D::HUD(char* title, int nArgs, ...) {
-
-    // img - Used for getting the arguments
-    IplImage *img;
-
-    // DispImage - the image in which input images are to be copied
-    IplImage *DispImage;
-
-    int size;
-    int i;
-    int m, n;
-    int x, y;
-
-    // w - Maximum number of images in a row
-    // h - Maximum number of images in a column
-    int w, h;
-
-    // scale - How much we have to resize the image
-    float scale;
-    int max;
-
-    // If the number of arguments is lesser than 0 or greater than 12
-    // return without displaying
-    if(nArgs <= 0) {
-        printf("Number of arguments too small....\n");
-        return;
-    }
-    else if(nArgs > 12) {
-        printf("Number of arguments too large....\n");
-        return;
-    }
-    // Determine the size of the image,
-    // and the number of rows/cols
-    // from number of arguments
-    else if (nArgs == 1) {
-        w = h = 1;
-        size = 300;
-    }
-    else if (nArgs == 2) {
-        w = 2; h = 1;
-        size = 300;
-    }
-    else if (nArgs == 3 || nArgs == 4) {
-        w = 2; h = 2;
-        size = 350;
-    }
-    else if (nArgs == 5 || nArgs == 6) {
-        w = 3; h = 2;
-        size = 200;
-    }
-    else if (nArgs == 7 || nArgs == 8) {
-        w = 4; h = 2;
-        size = 200;
-    }
-    else {
-        w = 4; h = 3;
-        size = 150;
-    }
-
-    // Create a new 3 channel image
-    DispImage = cvCreateImage( cvSize( 50 + size*w, 60 + size*h), 8, 3 );
-
-    // Used to get the arguments passed
-    va_list args;
-    va_start(args, nArgs);
-
-    // Loop for nArgs number of arguments
-    for (i = 0, m = 20, n = 20; i < nArgs; i++, m += (20 + size)) {
-
-        // Get the Pointer to the IplImage
-        img = va_arg(args, IplImage*);
-
-        // Check whether it is NULL or not
-        // If it is NULL, release the image, and return
-        if(img == 0) {
-            printf("Invalid arguments");
-            cvReleaseImage(&DispImage);
-            return;
-        }
-
-        // Find the width and height of the image
-        x = img->width;
-        y = img->height;
-
-        // Find whether height or width is greater in order to resize the image
-        max = (x > y)? x: y;
-
-        // Find the scaling factor to resize the image
-        scale = (float) ( (float) max / size );
-
-        // Used to Align the images
-        if( i % w == 0 && m!= 20) {
-            m = 20;
-            n+= 20 + size;
-        }
-
-        // Set the image ROI to display the current image
-        cvSetImageROI(DispImage, cvRect(m, n, (int)( x/scale ), (int)( y/scale )));
-
-        // Resize the input image and copy the it to the Single Big Image
-        cvResize( img, DispImage );
-
-        // Reset the ROI in order to display the next image
-        cvResetImageROI(DispImage);
-    }
-
-    // Create a new window, and show the Single Big Image
-    cvNamedWindow( title, 1 );
-    cvShowImage( title, DispImage);
-
-    //cvWaitKey();
-    //cvDestroyWindow(title);
-
-    // End the number of arguments
-    va_end(args);
-
-    // Release the Image Memory
-    //cvReleaseImage(&DispImage);
+	m_proximity_monitor.Stop();
 }
 
 void 
 VisualServoing2D::UpdateDynamicVariables( raw_visual_servoing::VisualServoingConfig config )
 {
+	boost::mutex::scoped_lock lock( m_config_mutex );
+	m_pending_config = config;
+	m_config_changed = true;
+	m_control_config_changed = true;
+}
+
+void
+VisualServoing2D::ApplyDynamicVariables()
+{
+	boost::mutex::scoped_lock lock( m_config_mutex );
+	if( !m_config_changed )
+	{
+		return;
+	}
+
+	raw_visual_servoing::VisualServoingConfig config = m_pending_config;
+	m_config_changed = false;
+
+	// A different background model starts from scratch.
+	if( config.background_mode != m_dynamic_variables.background_mode )
+	{
+		m_adaptive_background.Reset();
+	}
+	m_adaptive_background.SetRate( config.background_rate );
+	m_quality_scheduler.SetBudget( config.latency_budget, config.quality_headroom );
+
 	m_dynamic_variables = config; 
+
+	m_proximity_monitor.SetTiming( config.proximity_rate, config.proximity_timeout );
+	m_object_tracker.SetParameters( config.tracker_accel, config.tracker_noise,
+									config.tracker_gate, config.tracker_coast );
+	m_intercept_predictor.SetParameters( config.conveyer_min_speed, config.conveyer_alpha, config.conveyer_horizon );
+
+	m_debug_renderer.SetRate( config.debug_rate );
+	if( g_debugging || config.debugging )
+	{
+		m_debug_renderer.Start( m_debug_topic );
+	}
+	else
+	{
+		m_debug_renderer.Stop();
+	}
+
+	m_threshold_estimator.SetMode( config.threshold_mode );
+	m_threshold_estimator.SetFixedThreshold( config.binary_threshold );
+	m_threshold_estimator.SetAmortization( config.threshold_interval, config.threshold_subsample,
+										   config.threshold_drift, config.threshold_alpha );
+	m_background_mask.SetThreshold( config.binary_threshold, config.threshold_mode != ThresholdEstimator::FIXED );
+}
+
+void
+VisualServoing2D::ApplyControlVariables()
+{
+	boost::mutex::scoped_lock lock( m_config_mutex );
+	if( !m_control_config_changed )
+	{
+		return;
+	}
+
+	raw_visual_servoing::VisualServoingConfig config = m_pending_config;
+	m_control_config_changed = false;
+
+	m_command_output.SetRate( config.command_rate );
+	m_grasp_lead = config.conveyer_grasp_lead;
+
+	m_x_controller.SetMode( config.controller_mode );
+	m_x_controller.SetGains( config.x_kp, config.x_ki, config.x_kd );
+	m_x_controller.SetLimits( m_x_velocity, config.base_max_velocity, config.base_max_accel );
+
+	m_y_controller.SetMode( config.controller_mode );
+	m_y_controller.SetGains( config.y_kp, config.y_ki, config.y_kd );
+	m_y_controller.SetLimits( m_y_velocity, config.base_max_velocity, config.base_max_accel );
+
+	m_rot_controller.SetMode( config.controller_mode );
+	m_rot_controller.SetGains( config.rot_kp, config.rot_ki, config.rot_kd );
+	m_rot_controller.SetLimits( m_rot_velocity, config.arm_max_velocity, config.arm_max_accel );
 }
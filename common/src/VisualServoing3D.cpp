@@ -7,14 +7,397 @@
 
 #include "VisualServoing3D.h"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
 VisualServoing3D::VisualServoing3D()
 {
-	// TODO Auto-generated constructor stub
+	m_fx = 525.0;
+	m_fy = 525.0;
+	m_cx = 319.5;
+	m_cy = 239.5;
+
+	m_target_x = 0;
+	m_target_y = 0;
+	m_target_z = 0.5;
+
+	m_min_height = 0.015;
+	m_max_height = 0.5;
+	m_blob_labeler.SetAreaLimits( 200, INT_MAX );
 
+	m_metric_depth = NULL;
+	m_mask = NULL;
+	m_ray_size = cvSize( 0, 0 );
+
+	memset( &m_timings, 0, sizeof( m_timings ) );
+
+	Reset();
 }
 
 VisualServoing3D::~VisualServoing3D()
 {
-	// TODO Auto-generated destructor stub
+	if( m_metric_depth )
+	{
+		cvReleaseImage( &m_metric_depth );
+	}
+	if( m_mask )
+	{
+		cvReleaseImage( &m_mask );
+	}
+}
+
+void
+VisualServoing3D::SetCamera( double fx, double fy, double cx, double cy )
+{
+	m_fx = fx;
+	m_fy = fy;
+	m_cx = cx;
+	m_cy = cy;
+
+	// The rays are worked out again for the next frame.
+	m_ray_size = cvSize( 0, 0 );
+}
+
+void
+VisualServoing3D::SetTargetPosition( double x, double y, double z )
+{
+	m_target_x = x;
+	m_target_y = y;
+	m_target_z = z;
+}
+
+void
+VisualServoing3D::SetSegmentation( double min_height, double max_height, int min_pixels )
+{
+	m_min_height = min_height;
+	m_max_height = max_height;
+	m_blob_labeler.SetAreaLimits( min_pixels, INT_MAX );
+}
+
+void
+VisualServoing3D::SetPlaneParameters( double inlier_distance, int max_iterations )
+{
+	m_plane_estimator.SetParameters( inlier_distance, max_iterations );
+}
+
+void
+VisualServoing3D::Reset()
+{
+	m_plane_estimator.Reset();
+	m_has_target = false;
+	m_last_x = 0;
+	m_last_y = 0;
+}
+
+bool
+VisualServoing3D::DetectTarget( const IplImage* depth, DepthObservation& observation )
+{
+	memset( &observation, 0, sizeof( observation ) );
+	memset( &m_timings, 0, sizeof( m_timings ) );
+
+	if( !depth || depth->nChannels != 1 || ( depth->depth != IPL_DEPTH_16U && depth->depth != IPL_DEPTH_32F ) )
+	{
+		return false;
+	}
+
+	int64 ticks = cvGetTickCount();
+	const IplImage* metric = MetricDepth( depth );
+	UpdateRays( cvGetSize( metric ) );
+	m_timings.convert += Lap( ticks );
+
+	SamplePoints( metric );
+	observation.plane_found = m_plane_estimator.Estimate( m_samples );
+	m_timings.plane += Lap( ticks );
+
+	if( !observation.plane_found )
+	{
+		return true;
+	}
+
+	const Plane& plane = m_plane_estimator.GetPlane();
+	observation.plane = plane;
+
+	Segment( metric, plane );
+	m_timings.segment += Lap( ticks );
+
+	m_blob_labeler.Label( m_mask, m_blobs );
+	observation.blob_count = m_blobs.Size();
+	m_timings.label += Lap( ticks );
+
+	int blob = SelectBlob();
+	if( blob >= 0 && Measure( metric, plane, blob, observation ) )
+	{
+		observation.found = true;
+		observation.x_offset = observation.x - m_target_x;
+		observation.y_offset = observation.y - m_target_y;
+		observation.z_offset = observation.z - m_target_z;
+
+		m_has_target = true;
+		m_last_x = m_blobs.centroid_x[blob];
+		m_last_y = m_blobs.centroid_y[blob];
+	}
+	m_timings.measure += Lap( ticks );
+
+	return true;
+}
+
+const DepthTimings&
+VisualServoing3D::GetTimings() const
+{
+	return m_timings;
+}
+
+int
+VisualServoing3D::GetPlaneIterations() const
+{
+	return m_plane_estimator.GetIterations();
+}
+
+const IplImage*
+VisualServoing3D::MetricDepth( const IplImage* depth )
+{
+	if( depth->depth == IPL_DEPTH_32F )
+	{
+		return depth;
+	}
+
+	if( m_metric_depth && ( m_metric_depth->width != depth->width || m_metric_depth->height != depth->height ) )
+	{
+		cvReleaseImage( &m_metric_depth );
+	}
+	if( !m_metric_depth )
+	{
+		m_metric_depth = cvCreateImage( cvGetSize( depth ), IPL_DEPTH_32F, 1 );
+	}
+
+	cvConvertScale( depth, m_metric_depth, 0.001 );
+	return m_metric_depth;
+}
+
+void
+VisualServoing3D::UpdateRays( CvSize size )
+{
+	if( size.width == m_ray_size.width && size.height == m_ray_size.height )
+	{
+		return;
+	}
+
+	m_ray_x.resize( size.width );
+	for( int u = 0; u < size.width; u++ )
+	{
+		m_ray_x[u] = ( u - m_cx ) / m_fx;
+	}
+
+	m_ray_y.resize( size.height );
+	for( int v = 0; v < size.height; v++ )
+	{
+		m_ray_y[v] = ( v - m_cy ) / m_fy;
+	}
+
+	m_ray_size = size;
+
+	if( m_mask )
+	{
+		cvReleaseImage( &m_mask );
+	}
+	m_mask = cvCreateImage( size, IPL_DEPTH_8U, 1 );
+}
+
+void
+VisualServoing3D::SamplePoints( const IplImage* depth )
+{
+	m_samples.clear();
+
+	for( int v = m_sample_stride / 2; v < depth->height; v += m_sample_stride )
+	{
+		const float* row = (const float*)( depth->imageData + v * depth->widthStep );
+		for( int u = m_sample_stride / 2; u < depth->width; u += m_sample_stride )
+		{
+			// Pixels without depth are zero or NaN, both of which fail the comparison.
+			float z = row[u];
+			if( z > 0 )
+			{
+				m_samples.push_back( cvPoint3D32f( m_ray_x[u] * z, m_ray_y[v] * z, z ) );
+			}
+		}
+	}
+}
+
+void
+VisualServoing3D::Segment( const IplImage* depth, const Plane& plane )
+{
+	/**
+	 * The height of the point at depth z behind pixel (u, v) is z * ( a * ray_x[u] + b * ray_y[v] + c )
+	 * + d, so per row only the column term changes.
+	 */
+	for( int v = 0; v < depth->height; v++ )
+	{
+		const float* row = (const float*)( depth->imageData + v * depth->widthStep );
+		uchar* mask = (uchar*)( m_mask->imageData + v * m_mask->widthStep );
+		double row_term = plane.b * m_ray_y[v] + plane.c;
+
+		for( int u = 0; u < depth->width; u++ )
+		{
+			float z = row[u];
+			double height = z * ( plane.a * m_ray_x[u] + row_term ) + plane.d;
+			mask[u] = ( z > 0 && height >= m_min_height && height <= m_max_height ) ? 255 : 0;
+		}
+	}
+}
+
+int
+VisualServoing3D::SelectBlob() const
+{
+	if( !m_has_target )
+	{
+		return m_blobs.LargestArea();
+	}
+
+	int nearest = -1;
+	double nearest_distance = 0;
+	for( unsigned int i = 0; i < m_blobs.Size(); i++ )
+	{
+		double dx = m_blobs.centroid_x[i] - m_last_x;
+		double dy = m_blobs.centroid_y[i] - m_last_y;
+		double distance = dx * dx + dy * dy;
+		if( nearest < 0 || distance < nearest_distance )
+		{
+			nearest = i;
+			nearest_distance = distance;
+		}
+	}
+
+	return nearest;
 }
 
+bool
+VisualServoing3D::Measure( const IplImage* depth, const Plane& plane, int blob, DepthObservation& observation )
+{
+	int min_x = m_blobs.min_x[blob];
+	int max_x = m_blobs.max_x[blob];
+	int min_y = m_blobs.min_y[blob];
+	int max_y = m_blobs.max_y[blob];
+
+	/**
+	 * Other objects may reach into the bounding box, so the pixels of the blob are marked by filling
+	 * it from one of its pixels in the top row. A pixel of another blob in that row is told apart by
+	 * the area and the box of what it fills, that blob is then filled once more so that it is
+	 * neither measured nor filled again.
+	 */
+	const uchar blob_value = 128;
+	const uchar other_value = 64;
+	bool marked = false;
+	uchar* top = (uchar*)( m_mask->imageData + min_y * m_mask->widthStep );
+	for( int u = min_x; u <= max_x && !marked; u++ )
+	{
+		if( top[u] != 255 )
+		{
+			continue;
+		}
+
+		CvConnectedComp component;
+		cvFloodFill( m_mask, cvPoint( u, min_y ), cvScalarAll( blob_value ), cvScalarAll( 0 ), cvScalarAll( 0 ), &component, 8 );
+		marked = (int)component.area == m_blobs.area[blob] &&
+				 component.rect.x == min_x && component.rect.y == min_y &&
+				 component.rect.width == max_x - min_x + 1 && component.rect.height == max_y - min_y + 1;
+		if( !marked )
+		{
+			cvFloodFill( m_mask, cvPoint( u, min_y ), cvScalarAll( other_value ), cvScalarAll( 0 ), cvScalarAll( 0 ), NULL, 8 );
+		}
+	}
+
+	if( !marked )
+	{
+		return false;
+	}
+
+	/**
+	 * The orientation is that of the points in the plane, with the camera's x axis projected onto
+	 * the plane as the first axis of the plane.
+	 */
+	double e1_x = 1 - plane.a * plane.a;
+	double e1_y = -plane.a * plane.b;
+	double e1_z = -plane.a * plane.c;
+	double length = sqrt( e1_x * e1_x + e1_y * e1_y + e1_z * e1_z );
+	if( length < 1e-6 )
+	{
+		// The camera looks along the plane, which leaves nothing to measure.
+		return false;
+	}
+	e1_x /= length;
+	e1_y /= length;
+	e1_z /= length;
+
+	double e2_x = plane.b * e1_z - plane.c * e1_y;
+	double e2_y = plane.c * e1_x - plane.a * e1_z;
+	double e2_z = plane.a * e1_y - plane.b * e1_x;
+
+	double n = 0;
+	double sum_x = 0, sum_y = 0, sum_z = 0;
+	double sum_s = 0, sum_t = 0, sum_ss = 0, sum_tt = 0, sum_st = 0;
+	double height = 0;
+
+	for( int v = min_y; v <= max_y; v++ )
+	{
+		const float* row = (const float*)( depth->imageData + v * depth->widthStep );
+		const uchar* mask = (const uchar*)( m_mask->imageData + v * m_mask->widthStep );
+
+		for( int u = min_x; u <= max_x; u++ )
+		{
+			if( mask[u] != blob_value )
+			{
+				continue;
+			}
+
+			double z = row[u];
+			double x = m_ray_x[u] * z;
+			double y = m_ray_y[v] * z;
+
+			sum_x += x;
+			sum_y += y;
+			sum_z += z;
+			n++;
+
+			double s = e1_x * x + e1_y * y + e1_z * z;
+			double t = e2_x * x + e2_y * y + e2_z * z;
+			sum_s += s;
+			sum_t += t;
+			sum_ss += s * s;
+			sum_tt += t * t;
+			sum_st += s * t;
+
+			height = std::max( height, plane.Distance( x, y, z ) );
+		}
+	}
+
+	if( n == 0 )
+	{
+		return false;
+	}
+
+	double mean_s = sum_s / n;
+	double mean_t = sum_t / n;
+	double ss = sum_ss / n - mean_s * mean_s;
+	double tt = sum_tt / n - mean_t * mean_t;
+	double st = sum_st / n - mean_s * mean_t;
+
+	observation.x = sum_x / n;
+	observation.y = sum_y / n;
+	observation.z = sum_z / n;
+	observation.yaw = 0.5 * atan2( 2 * st, ss - tt );
+	observation.height = height;
+	observation.point_count = n;
+	return true;
+}
+
+double
+VisualServoing3D::Lap( int64& ticks ) const
+{
+	int64 now = cvGetTickCount();
+	double elapsed = ( now - ticks ) / ( cvGetTickFrequency() * 1000.0 );
+	ticks = now;
+
+	return elapsed;
+}
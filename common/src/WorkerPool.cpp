@@ -0,0 +1,131 @@
+/*
+ * WorkerPool.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "WorkerPool.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+WorkerPool::WorkerPool( unsigned int threads )
+{
+	if( threads == 0 )
+	{
+		threads = std::max( 1u, boost::thread::hardware_concurrency() );
+	}
+
+	m_pending = 0;
+	m_running = true;
+	m_next_queue = 0;
+
+	for( unsigned int i = 0; i < threads; i++ )
+	{
+		m_queues.push_back( new WorkQueue() );
+	}
+
+	for( unsigned int i = 0; i < threads; i++ )
+	{
+		m_threads.create_thread( boost::bind( &WorkerPool::Run, this, i ) );
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		boost::mutex::scoped_lock lock( m_idle_mutex );
+		m_running = false;
+	}
+	m_idle_condition.notify_all();
+
+	m_threads.join_all();
+
+	for( unsigned int i = 0; i < m_queues.size(); i++ )
+	{
+		delete m_queues[i];
+	}
+}
+
+void
+WorkerPool::Submit( const Task& task )
+{
+	unsigned int* worker = m_worker_index.get();
+	unsigned int queue = worker ? *worker : __sync_fetch_and_add( &m_next_queue, 1 ) % m_queues.size();
+
+	{
+		boost::mutex::scoped_lock lock( m_queues[queue]->mutex );
+		m_queues[queue]->tasks.push_back( task );
+	}
+
+	/**
+	 * The count is raised before the idle mutex is taken, so a worker that is about to go to sleep
+	 * either sees the task or gets the notification.
+	 */
+	__sync_fetch_and_add( &m_pending, 1 );
+	{
+		boost::mutex::scoped_lock lock( m_idle_mutex );
+	}
+	m_idle_condition.notify_one();
+}
+
+unsigned int
+WorkerPool::GetThreadCount() const
+{
+	return m_queues.size();
+}
+
+void
+WorkerPool::Run( unsigned int worker )
+{
+	m_worker_index.reset( new unsigned int( worker ) );
+
+	Task task;
+	while( m_running )
+	{
+		if( Pop( worker, task ) )
+		{
+			task();
+			task.clear();
+			continue;
+		}
+
+		boost::mutex::scoped_lock lock( m_idle_mutex );
+		while( m_running && m_pending == 0 )
+		{
+			m_idle_condition.wait( lock );
+		}
+	}
+}
+
+bool
+WorkerPool::Pop( unsigned int worker, Task& task )
+{
+	{
+		WorkQueue& own = *m_queues[worker];
+		boost::mutex::scoped_lock lock( own.mutex );
+		if( !own.tasks.empty() )
+		{
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			__sync_fetch_and_sub( &m_pending, 1 );
+			return true;
+		}
+	}
+
+	for( unsigned int i = 1; i < m_queues.size(); i++ )
+	{
+		WorkQueue& other = *m_queues[( worker + i ) % m_queues.size()];
+		boost::mutex::scoped_lock lock( other.mutex );
+		if( !other.tasks.empty() )
+		{
+			task = other.tasks.front();
+			other.tasks.pop_front();
+			__sync_fetch_and_sub( &m_pending, 1 );
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,349 @@
+/**
+ * This program replays depth frames through VisualServoing3D and reports how long each stage takes,
+ * the median (p50) and 99th percentile (p99) frame latency and the frames per second.
+ *
+ * It needs neither ROS, a camera nor the robot. It is run from the package folder with a folder of
+ * recorded depth frames (16 bit PNG images in millimetres, as saved from an RGB-D camera) and the
+ * intrinsics of the camera they were recorded with:
+ *
+ * $ bin/depth_benchmark [--camera fx fy cx cy] [depth image folder]
+ *
+ * Without an input the frames are rendered: a table seen from above at an angle with a box moving
+ * and turning on it and a smaller box standing next to it, with noise and missing pixels like
+ * those of a Kinect. As the pose of the box is known in every frame, the errors of the measured
+ * centroid and yaw are printed as well, and the program fails if they are larger than expected.
+ */
+
+// OpenCV
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BenchmarkReplay.h"
+#include "VisualServoing3D.h"
+
+
+/**
+ * The rendered scene: the camera is this high (in metres) above the table and looks down at it
+ * at this angle (in degrees). The moving box is 12 by 6 cm and 5 cm high and moves on a circle of
+ * 8 cm around the point the camera looks at.
+ */
+const static double g_camera_height = 0.6;
+const static double g_camera_pitch = 70.0;
+const static double g_box_length = 0.12;
+const static double g_box_width = 0.06;
+const static double g_box_height = 0.05;
+const static double g_box_radius = 0.08;
+
+/**
+ * The mean errors of the measured centroid (in metres) and yaw (in degrees) on the rendered frames
+ * above which the benchmark fails.
+ */
+const static double g_max_position_error = 0.005;
+const static double g_max_yaw_error = 2.0;
+
+/**
+ * The pose of the moving box in a rendered frame: the centre of its top face in the camera frame
+ * and its yaw as VisualServoing3D measures it.
+ */
+struct FixturePose
+{
+	double											x;
+	double											y;
+	double											z;
+	double											yaw;
+};
+
+/**
+ * A box on the table in the rendered scene, given by the centre of its top face in the coordinates
+ * of the table (along the camera's x axis and away from the camera), its size and its yaw.
+ */
+struct FixtureBox
+{
+	double											s;
+	double											t;
+	double											length;
+	double											width;
+	double											height;
+	double											yaw;
+};
+
+/**
+ * Loads every 16 bit image in the provided folder, in the order of their names.
+ */
+void
+LoadDepthFolder( const std::string& folder, std::vector<IplImage*>& frames )
+{
+	std::vector<IplImage*> images;
+	BenchmarkReplay::LoadFolder( folder, CV_LOAD_IMAGE_ANYDEPTH, images );
+
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		if( images[i]->depth != IPL_DEPTH_16U || images[i]->nChannels != 1 )
+		{
+			fprintf( stderr, "Skipping frame %u, it is not a 16 bit depth image\n", i );
+			cvReleaseImage( &images[i] );
+			continue;
+		}
+
+		frames.push_back( images[i] );
+	}
+}
+
+/**
+ * Returns a pseudo random number in [0, 1). The rendered frames are the same for every run.
+ */
+double
+Uniform( unsigned int& state )
+{
+	state = state * 1664525u + 1013904223u;
+	return ( state >> 8 ) / 16777216.0;
+}
+
+/**
+ * Renders the frames of the scene at the provided camera intrinsics together with the pose of the
+ * moving box in each of them.
+ */
+void
+MakeFixtureFrames( double fx, double fy, double cx, double cy, CvSize size,
+				   std::vector<IplImage*>& frames, std::vector<FixturePose>& poses )
+{
+	// The table normal points up at the camera, which is at the origin.
+	double pitch = g_camera_pitch * CV_PI / 180.0;
+	double n_y = -cos( pitch );
+	double n_z = -sin( pitch );
+	double d = g_camera_height;
+
+	// The axes of the table: the camera's x axis and the direction away from the camera.
+	double e2_y = n_z;
+	double e2_z = -n_y;
+
+	// The point the camera looks at.
+	double look_z = g_camera_height / sin( pitch );
+
+	unsigned int state = 1;
+
+	for( int i = 0; i < BenchmarkReplay::FIXTURE_FRAMES; i++ )
+	{
+		double phase = 2 * CV_PI * i / BenchmarkReplay::FIXTURE_FRAMES;
+
+		FixtureBox boxes[2];
+		FixtureBox moving = { g_box_radius * cos( phase ), g_box_radius * sin( phase ),
+							  g_box_length, g_box_width, g_box_height, 60.0 * sin( 2 * phase ) * CV_PI / 180.0 };
+		FixtureBox standing = { -0.22, 0.10, 0.05, 0.05, 0.08, 0.0 };
+		boxes[0] = moving;
+		boxes[1] = standing;
+
+		FixturePose pose;
+		pose.x = moving.s;
+		pose.y = n_y * moving.height + e2_y * moving.t;
+		pose.z = look_z + n_z * moving.height + e2_z * moving.t;
+		pose.yaw = moving.yaw;
+		poses.push_back( pose );
+
+		IplImage* frame = cvCreateImage( size, IPL_DEPTH_16U, 1 );
+		for( int v = 0; v < size.height; v++ )
+		{
+			unsigned short* row = (unsigned short*)( frame->imageData + v * frame->widthStep );
+			double ray_y = ( v - cy ) / fy;
+
+			for( int u = 0; u < size.width; u++ )
+			{
+				double ray_x = ( u - cx ) / fx;
+				double facing = n_y * ray_y + n_z;
+
+				row[u] = 0;
+				if( facing >= 0 || Uniform( state ) < 0.01 )
+				{
+					continue;
+				}
+
+				// The table, unless the ray hits the top of a box first.
+				double z = -d / facing;
+				for( int b = 0; b < 2; b++ )
+				{
+					const FixtureBox& box = boxes[b];
+					double top = ( box.height - d ) / facing;
+
+					double s = ray_x * top - box.s;
+					double t = e2_y * ray_y * top + e2_z * ( top - look_z ) - box.t;
+					double along = s * cos( box.yaw ) + t * sin( box.yaw );
+					double across = -s * sin( box.yaw ) + t * cos( box.yaw );
+					if( fabs( along ) <= box.length / 2 && fabs( across ) <= box.width / 2 && top < z )
+					{
+						z = top;
+					}
+				}
+
+				// Noise that grows with the square of the depth, summed up from uniform numbers.
+				double noise = ( Uniform( state ) + Uniform( state ) + Uniform( state ) - 1.5 ) * 2.0;
+				z += 0.0015 * z * z * noise;
+
+				row[u] = (unsigned short)( z * 1000.0 + 0.5 );
+			}
+		}
+
+		frames.push_back( frame );
+	}
+}
+
+/**
+ * Runs the detection on the frames and prints the results. If the poses of the box are provided
+ * the errors are printed too. Returns false if they are larger than expected.
+ */
+bool
+Benchmark( const std::vector<IplImage*>& frames, const std::vector<FixturePose>& poses,
+		   double fx, double fy, double cx, double cy )
+{
+	VisualServoing3D visual_servoing;
+	visual_servoing.SetCamera( fx, fy, cx, cy );
+
+	DepthTimings total;
+	memset( &total, 0, sizeof( total ) );
+
+	std::vector<double> latencies;
+	int planes = 0;
+	int found = 0;
+	double iterations = 0;
+	double position_error = 0;
+	double yaw_error = 0;
+	double max_position_error = 0;
+	double max_yaw_error = 0;
+
+	for( unsigned int i = 0; i < frames.size(); i++ )
+	{
+		DepthObservation observation;
+
+		int64 start = cvGetTickCount();
+		visual_servoing.DetectTarget( frames[i], observation );
+		double latency = BenchmarkReplay::MillisecondsSince( start );
+
+		if( (int)i < BenchmarkReplay::WARM_UP_FRAMES )
+		{
+			continue;
+		}
+
+		const DepthTimings& timings = visual_servoing.GetTimings();
+		total.convert += timings.convert;
+		total.plane += timings.plane;
+		total.segment += timings.segment;
+		total.label += timings.label;
+		total.measure += timings.measure;
+
+		latencies.push_back( latency );
+		planes += observation.plane_found ? 1 : 0;
+		found += observation.found ? 1 : 0;
+		iterations += visual_servoing.GetPlaneIterations();
+
+		if( i < poses.size() )
+		{
+			const FixturePose& pose = poses[i];
+
+			double error = observation.found ? sqrt( ( observation.x - pose.x ) * ( observation.x - pose.x ) +
+													 ( observation.y - pose.y ) * ( observation.y - pose.y ) +
+													 ( observation.z - pose.z ) * ( observation.z - pose.z ) ) : 1.0;
+
+			// The yaw of the major axis is only known up to half a turn.
+			double turn = ( observation.yaw - pose.yaw ) * 180.0 / CV_PI;
+			turn -= 180.0 * floor( turn / 180.0 + 0.5 );
+			double turn_error = observation.found ? fabs( turn ) : 90.0;
+
+			position_error += error;
+			yaw_error += turn_error;
+			max_position_error = std::max( max_position_error, error );
+			max_yaw_error = std::max( max_yaw_error, turn_error );
+		}
+	}
+
+	if( latencies.empty() )
+	{
+		printf( "%dx%d: not enough frames\n", frames.empty() ? 0 : frames[0]->width, frames.empty() ? 0 : frames[0]->height );
+		return false;
+	}
+
+	double n = latencies.size();
+	printf( "%dx%d: %d frames, plane found in %d, target found in %d, %.1f RANSAC iterations per frame\n",
+			frames[0]->width, frames[0]->height, (int)n, planes, found, iterations / n );
+	printf( "  %-10s %8.3f ms\n", "convert", total.convert / n );
+	printf( "  %-10s %8.3f ms\n", "plane", total.plane / n );
+	printf( "  %-10s %8.3f ms\n", "segment", total.segment / n );
+	printf( "  %-10s %8.3f ms\n", "label", total.label / n );
+	printf( "  %-10s %8.3f ms\n", "measure", total.measure / n );
+	BenchmarkReplay::PrintLatencies( latencies );
+
+	if( poses.empty() )
+	{
+		printf( "\n" );
+		return true;
+	}
+
+	position_error /= n;
+	yaw_error /= n;
+	printf( "  centroid   mean error %.1f mm, max %.1f mm\n", position_error * 1000.0, max_position_error * 1000.0 );
+	printf( "  yaw        mean error %.2f deg, max %.2f deg\n\n", yaw_error, max_yaw_error );
+
+	return position_error <= g_max_position_error && yaw_error <= g_max_yaw_error;
+}
+
+int
+main( int argc, char** argv )
+{
+	double fx = 525.0;
+	double fy = 525.0;
+	double cx = 319.5;
+	double cy = 239.5;
+	std::string input;
+
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "--camera" ) == 0 && i + 4 < argc )
+		{
+			fx = atof( argv[++i] );
+			fy = atof( argv[++i] );
+			cx = atof( argv[++i] );
+			cy = atof( argv[++i] );
+		}
+		else
+		{
+			input = argv[i];
+		}
+	}
+
+	std::vector<IplImage*> frames;
+	std::vector<FixturePose> poses;
+
+	if( input.empty() )
+	{
+		MakeFixtureFrames( fx, fy, cx, cy, cvSize( 640, 480 ), frames, poses );
+	}
+	else
+	{
+		LoadDepthFolder( input, frames );
+	}
+
+	if( frames.empty() )
+	{
+		fprintf( stderr, "No frames to replay\n" );
+		return 1;
+	}
+
+	bool passed = Benchmark( frames, poses, fx, fy, cx, cy );
+
+	BenchmarkReplay::ReleaseFrames( frames );
+
+	if( !passed )
+	{
+		fprintf( stderr, "The measured poses are off by more than %.1f mm or %.1f deg\n",
+				 g_max_position_error * 1000.0, g_max_yaw_error );
+		return 1;
+	}
+
+	return 0;
+}
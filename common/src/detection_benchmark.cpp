@@ -0,0 +1,292 @@
+/**
+ * This program replays images through the blob detection of VisualServoing2D and reports how long
+ * it takes. The frames go through DetectTarget(), which is exactly what VisualServoing() and the
+ * visual servoing node run for every camera frame, so the numbers include the tracking window,
+ * the downscaling and the refinement. For every resolution it prints the time spent in each stage
+ * of the detection, the median (p50) and 99th percentile (p99) frame latency and the frames per
+ * second.
+ *
+ * Once the target is lost DetectTarget() returns right away for a while (of wall time) without
+ * processing the frame. The replay is far faster than the camera, so such frames are not counted
+ * and the detection is started over with the next frame. Their number is printed.
+ *
+ * It needs neither a ROS master, a camera nor the robot: the publishers and the obstacle service
+ * of VisualServoing2D are only used once a visual servoing session has been started, which the
+ * benchmark never does. It is run from the package folder with either a folder of images or a
+ * video file:
+ *
+ * $ bin/detection_benchmark [--mode 0|1] [--scale n] [--background 0|1] [--budget ms] [image folder | video file]
+ *
+ * The background option picks the static background image or the adaptive background (see
+ * background_mode), the mean number of blobs per frame shows how much of the scene is left over
+ * after the background is removed. With a budget the quality scheduler lowers the detection quality
+ * to keep the frames within it (see latency_budget), the level it ends up at is printed as well.
+ *
+ * Without an input the frames are made from the background images in common/data (background.png
+ * for the normal mode, conveyer_background.png for the conveyer belt mode) with a dark object
+ * moving over them, and both modes are run.
+ */
+
+// ROS
+#include <ros/ros.h>
+
+// OpenCV
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+
+// BOOST
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BenchmarkReplay.h"
+#include "VisualServoing2D.h"
+
+/**
+ * The frames are replayed as if they had been taken at this rate (in Hz), which is what the target
+ * tracker predicts the target's motion by.
+ */
+const static double g_frame_rate = 30.0;
+
+/**
+ * Loads the frames of the provided video file.
+ */
+void
+LoadVideo( const std::string& path, std::vector<IplImage*>& frames )
+{
+	CvCapture* capture = cvCaptureFromFile( path.c_str() );
+	if( !capture )
+	{
+		return;
+	}
+
+	IplImage* image = NULL;
+	while( (int)frames.size() < BenchmarkReplay::MAX_FRAMES && ( image = cvQueryFrame( capture ) ) != NULL )
+	{
+		frames.push_back( cvCloneImage( image ) );
+	}
+
+	cvReleaseCapture( &capture );
+}
+
+/**
+ * Makes frames from the provided background with a dark, slowly turning object moving over the
+ * upper half of it, where the gripper does not cover the background.
+ */
+void
+MakeFixtureFrames( const IplImage* background, std::vector<IplImage*>& frames )
+{
+	int width = background->width;
+	int height = background->height;
+
+	for( int i = 0; i < BenchmarkReplay::FIXTURE_FRAMES; i++ )
+	{
+		double phase = 2 * CV_PI * i / BenchmarkReplay::FIXTURE_FRAMES;
+
+		IplImage* frame = cvCloneImage( background );
+		CvPoint center = cvPoint( width / 2 + (int)( width / 4 * sin( phase ) ),
+								  height / 3 + (int)( height / 12 * sin( 2 * phase ) ) );
+		cvEllipse( frame, center, cvSize( width / 10, height / 16 ), 30 * sin( phase ), 0, 360, CV_RGB( 20, 20, 20 ), -1 );
+
+		frames.push_back( frame );
+	}
+}
+
+/**
+ * Runs the detection on the frames resized to the provided size and prints the results.
+ */
+void
+Benchmark( const std::vector<IplImage*>& frames, int mode, int scale, int background, double budget, CvSize size )
+{
+	// The frames are resized up front so that only the detection is timed.
+	std::vector<IplImage*> resized;
+	for( unsigned int i = 0; i < frames.size(); i++ )
+	{
+		IplImage* image = cvCreateImage( size, IPL_DEPTH_8U, 3 );
+		cvResize( frames[i], image, CV_INTER_LINEAR );
+		resized.push_back( image );
+	}
+
+	VisualServoing2D visual_servoing( false, mode, std::vector<std::string>() );
+
+	raw_visual_servoing::VisualServoingConfig config = raw_visual_servoing::VisualServoingConfig::__getDefault__();
+	config.detection_scale = scale;
+	config.background_mode = background;
+	config.latency_budget = budget;
+	visual_servoing.UpdateDynamicVariables( config );
+
+	DetectionTimings total;
+	memset( &total, 0, sizeof( total ) );
+
+	std::vector<double> latencies;
+	int found = 0;
+	int blob_count = 0;
+	int skipped = 0;
+
+	// Kept across frames so that the table of tracked objects is not allocated again every frame.
+	TargetObservation observation;
+
+	for( unsigned int i = 0; i < resized.size(); i++ )
+	{
+		ImageFrame frame;
+		frame.Wrap( resized[i] );
+		frame.SetStamp( ( i + 1 ) / g_frame_rate );
+
+		int64 start = cvGetTickCount();
+		visual_servoing.DetectTarget( frame, observation );
+		double latency = BenchmarkReplay::MillisecondsSince( start );
+
+		if( (int)i < BenchmarkReplay::WARM_UP_FRAMES )
+		{
+			continue;
+		}
+
+		if( observation.status != 0 )
+		{
+			visual_servoing.ResetSession();
+			skipped++;
+			continue;
+		}
+
+		const DetectionTimings& timings = visual_servoing.GetDetectionTimings();
+		total.convert += timings.convert;
+		total.smooth += timings.smooth;
+		total.threshold += timings.threshold;
+		total.subtract += timings.subtract;
+		total.label += timings.label;
+		total.select += timings.select;
+
+		latencies.push_back( latency );
+		found += observation.found ? 1 : 0;
+		blob_count += observation.blob_count;
+	}
+
+	BenchmarkReplay::ReleaseFrames( resized );
+
+	if( latencies.empty() )
+	{
+		printf( "%dx%d: not enough frames\n", size.width, size.height );
+		return;
+	}
+
+	double n = latencies.size();
+	printf( "%dx%d, mode %d, scale %d, background %d: %d frames, target found in %d, %.1f blobs per frame\n",
+			size.width, size.height, mode, scale, background, (int)n, found, blob_count / n );
+	if( skipped > 0 )
+	{
+		printf( "  %d frames skipped after the target was lost\n", skipped );
+	}
+	if( budget > 0 )
+	{
+		printf( "  budget %.1f ms, quality level %d at the end\n", budget, observation.quality_level );
+	}
+	printf( "  %-10s %8.3f ms\n", "convert", total.convert / n );
+	printf( "  %-10s %8.3f ms\n", "smooth", total.smooth / n );
+	printf( "  %-10s %8.3f ms\n", "threshold", total.threshold / n );
+	printf( "  %-10s %8.3f ms\n", "subtract", total.subtract / n );
+	printf( "  %-10s %8.3f ms\n", "label", total.label / n );
+	printf( "  %-10s %8.3f ms\n", "select", total.select / n );
+	BenchmarkReplay::PrintLatencies( latencies );
+	printf( "\n" );
+}
+
+int
+main( int argc, char** argv )
+{
+	ros::init( argc, argv, "detection_benchmark", ros::init_options::AnonymousName | ros::init_options::NoRosout );
+
+	int mode = -1;
+	int scale = 1;
+	int background = 0;
+	double budget = 0;
+	std::string input;
+
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "--mode" ) == 0 && i + 1 < argc )
+		{
+			mode = atoi( argv[++i] );
+		}
+		else if( strcmp( argv[i], "--scale" ) == 0 && i + 1 < argc )
+		{
+			scale = std::max( 1, atoi( argv[++i] ) );
+		}
+		else if( strcmp( argv[i], "--background" ) == 0 && i + 1 < argc )
+		{
+			background = atoi( argv[++i] );
+		}
+		else if( strcmp( argv[i], "--budget" ) == 0 && i + 1 < argc )
+		{
+			budget = atof( argv[++i] );
+		}
+		else
+		{
+			input = argv[i];
+		}
+	}
+
+	const CvSize sizes[] = { cvSize( 640, 480 ), cvSize( 1280, 720 ) };
+
+	std::vector<int> modes;
+	if( mode >= 0 )
+	{
+		modes.push_back( mode );
+	}
+	else if( input.empty() )
+	{
+		modes.push_back( 0 );
+		modes.push_back( 1 );
+	}
+	else
+	{
+		modes.push_back( 0 );
+	}
+
+	for( unsigned int m = 0; m < modes.size(); m++ )
+	{
+		std::vector<IplImage*> frames;
+
+		if( input.empty() )
+		{
+			std::string fixture = ( modes[m] == 1 ) ? "common/data/conveyer_background.png" : "common/data/background.png";
+			IplImage* background = cvLoadImage( fixture.c_str(), CV_LOAD_IMAGE_COLOR );
+			if( !background )
+			{
+				fprintf( stderr, "Could not load %s\n", fixture.c_str() );
+				return 1;
+			}
+
+			MakeFixtureFrames( background, frames );
+			cvReleaseImage( &background );
+		}
+		else if( boost::filesystem::is_directory( input ) )
+		{
+			BenchmarkReplay::LoadFolder( input, CV_LOAD_IMAGE_COLOR, frames );
+		}
+		else
+		{
+			LoadVideo( input, frames );
+		}
+
+		if( frames.empty() )
+		{
+			fprintf( stderr, "No frames to replay\n" );
+			return 1;
+		}
+
+		for( unsigned int i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ); i++ )
+		{
+			Benchmark( frames, modes[m], scale, background, budget, sizes[i] );
+		}
+
+		BenchmarkReplay::ReleaseFrames( frames );
+	}
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * This program turns the files written by the FlightRecorder of the visual servoing (when a
+ * session fails or on request, see README.md) into CSV, with one line per control cycle and a
+ * column per flag. The times are in milliseconds since the first image in the file.
+ *
+ * It does not depend on ROS and prints to the standard output:
+ *
+ * $ bin/flight_recorder_decode visual_servoing_20261018-143512_timeout.vsfr > run.csv
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "FlightRecorder.h"
+
+/**
+ * The flags in the order of their columns.
+ */
+const static FlightRecorder::Flag g_flags[] = { FlightRecorder::FOUND,
+												FlightRecorder::TOO_CLOSE,
+												FlightRecorder::DONE_X,
+												FlightRecorder::DONE_Y,
+												FlightRecorder::DONE_ROTATION,
+												FlightRecorder::BASE_SENT,
+												FlightRecorder::ARM_SENT };
+
+const static unsigned int g_flag_count = sizeof( g_flags ) / sizeof( g_flags[0] );
+
+/**
+ * Returns the provided time in milliseconds since the origin, or nothing if it was not recorded.
+ */
+std::string
+Milliseconds( int64_t time, int64_t origin )
+{
+	if( time == 0 )
+	{
+		return "";
+	}
+
+	char text[32];
+	snprintf( text, sizeof( text ), "%.3f", ( time - origin ) / 1e6 );
+	return text;
+}
+
+int
+main( int argc, char** argv )
+{
+	if( argc != 2 )
+	{
+		fprintf( stderr, "Usage: %s <flight record>\n", argv[0] );
+		return 1;
+	}
+
+	std::vector<FlightRecord> records;
+	if( !FlightRecorder::Load( argv[1], records ) )
+	{
+		fprintf( stderr, "Could not read %s, or it was written by another version of the recorder\n", argv[1] );
+		return 1;
+	}
+
+	int64_t origin = 0;
+	for( unsigned int i = 0; i < records.size() && origin == 0; i++ )
+	{
+		origin = records[i].image_time;
+	}
+
+	printf( "session,frame,stamp,image_ms,detected_ms,control_ms,status,target_id,blob_count" );
+	for( unsigned int f = 0; f < g_flag_count; f++ )
+	{
+		printf( ",%s", FlightRecorder::GetFlagName( g_flags[f] ) );
+	}
+	printf( ",tracked_x,tracked_y,x_offset,y_offset,rot_offset,base_x,base_y,arm_rotation\n" );
+
+	for( unsigned int i = 0; i < records.size(); i++ )
+	{
+		const FlightRecord& record = records[i];
+
+		printf( "%u,%u,%.6f,%s,%s,%s,%d,%d,%u", record.session, record.frame, record.stamp,
+				Milliseconds( record.image_time, origin ).c_str(),
+				Milliseconds( record.detected_time, origin ).c_str(),
+				Milliseconds( record.control_time, origin ).c_str(),
+				record.status, record.target_id, record.blob_count );
+
+		for( unsigned int f = 0; f < g_flag_count; f++ )
+		{
+			printf( ",%d", ( record.flags & g_flags[f] ) ? 1 : 0 );
+		}
+
+		printf( ",%.2f,%.2f,%.2f,%.2f,%.4f,%.4f,%.4f,%.4f\n", record.tracked_x, record.tracked_y,
+				record.x_offset, record.y_offset, record.rot_offset,
+				record.base_x, record.base_y, record.arm_rotation );
+	}
+
+	return 0;
+}
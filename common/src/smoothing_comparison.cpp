@@ -0,0 +1,165 @@
+/**
+ * This program compares the smoothing back-ends of the ImageSmoother on a set of images. For every
+ * image, back-end and kernel size it reports the time per image and how far the result is from the
+ * exact Gaussian, both as an image (PSNR and largest error) and as what the blob detection sees
+ * (the fraction of pixels whose Otsu thresholded value differs).
+ *
+ * It does not depend on ROS and can be run from the package folder without any arguments, in which
+ * case the images in common/data are used:
+ *
+ * $ bin/smoothing_comparison [image ...]
+ */
+
+// OpenCV
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ImageSmoother.h"
+
+/**
+ * The number of times each back-end is run per image, the time reported is the average.
+ */
+const static int g_iterations = 50;
+
+/**
+ * Smooths the provided gray image with the provided smoother into the result image and returns the
+ * average time per run in milliseconds.
+ */
+double
+TimeSmoothing( ImageSmoother& smoother, IplImage* gray, IplImage* result )
+{
+	double total = 0;
+
+	for( int i = 0; i < g_iterations; i++ )
+	{
+		cvCopy( gray, result );
+
+		int64 start = cvGetTickCount();
+		smoother.Smooth( result );
+		total += cvGetTickCount() - start;
+	}
+
+	return total / ( cvGetTickFrequency() * 1000.0 ) / g_iterations;
+}
+
+/**
+ * Returns the peak signal to noise ratio of the image against the reference in dB and stores the
+ * largest absolute difference in max_error.
+ */
+double
+PSNR( IplImage* image, IplImage* reference, double& max_error )
+{
+	double squared_error = 0;
+	max_error = 0;
+
+	for( int y = 0; y < image->height; y++ )
+	{
+		const unsigned char* a = (const unsigned char*)( image->imageData + y * image->widthStep );
+		const unsigned char* b = (const unsigned char*)( reference->imageData + y * reference->widthStep );
+
+		for( int x = 0; x < image->width; x++ )
+		{
+			double difference = fabs( (double)a[x] - b[x] );
+			squared_error += difference * difference;
+			max_error = std::max( max_error, difference );
+		}
+	}
+
+	if( squared_error == 0 )
+	{
+		return HUGE_VAL;
+	}
+
+	return 10.0 * log10( 255.0 * 255.0 * image->width * image->height / squared_error );
+}
+
+/**
+ * Thresholds both images the way the detection does and returns the percentage of pixels on which
+ * the two masks disagree.
+ */
+double
+MaskDifference( IplImage* image, IplImage* reference, IplImage* mask, IplImage* reference_mask )
+{
+	cvThreshold( image, mask, 0, 255, CV_THRESH_BINARY_INV | CV_THRESH_OTSU );
+	cvThreshold( reference, reference_mask, 0, 255, CV_THRESH_BINARY_INV | CV_THRESH_OTSU );
+	cvCmp( mask, reference_mask, mask, CV_CMP_NE );
+
+	return 100.0 * cvCountNonZero( mask ) / ( image->width * image->height );
+}
+
+int
+main( int argc, char** argv )
+{
+	std::vector<std::string> image_paths;
+	for( int i = 1; i < argc; i++ )
+	{
+		image_paths.push_back( argv[i] );
+	}
+
+	if( image_paths.empty() )
+	{
+		image_paths.push_back( "common/data/background.png" );
+		image_paths.push_back( "common/data/conveyer_background.png" );
+	}
+
+	const int sizes[] = { 5, 11, 21 };
+	const int methods[] = { ImageSmoother::GAUSSIAN, ImageSmoother::RECURSIVE, ImageSmoother::BOX, ImageSmoother::NONE };
+
+	for( unsigned int i = 0; i < image_paths.size(); i++ )
+	{
+		IplImage* image = cvLoadImage( image_paths[i].c_str(), CV_LOAD_IMAGE_GRAYSCALE );
+		if( !image )
+		{
+			fprintf( stderr, "Could not load %s\n", image_paths[i].c_str() );
+			continue;
+		}
+
+		printf( "%s (%dx%d)\n", image_paths[i].c_str(), image->width, image->height );
+		printf( "  %-10s %4s %10s %8s %10s %10s %12s\n", "Back-end", "Size", "Time [ms]", "Speedup", "PSNR [dB]", "Max error", "Mask diff [%]" );
+
+		IplImage* reference = cvCreateImage( cvGetSize( image ), IPL_DEPTH_8U, 1 );
+		IplImage* result = cvCreateImage( cvGetSize( image ), IPL_DEPTH_8U, 1 );
+		IplImage* mask = cvCreateImage( cvGetSize( image ), IPL_DEPTH_8U, 1 );
+		IplImage* reference_mask = cvCreateImage( cvGetSize( image ), IPL_DEPTH_8U, 1 );
+
+		for( unsigned int s = 0; s < sizeof( sizes ) / sizeof( sizes[0] ); s++ )
+		{
+			ImageSmoother smoother;
+			smoother.SetSize( sizes[s] );
+
+			// The exact Gaussian is the reference for the quality of all other back-ends.
+			smoother.SetMethod( ImageSmoother::GAUSSIAN );
+			double reference_time = TimeSmoothing( smoother, image, reference );
+
+			for( unsigned int m = 0; m < sizeof( methods ) / sizeof( methods[0] ); m++ )
+			{
+				smoother.SetMethod( methods[m] );
+				double time = TimeSmoothing( smoother, image, result );
+
+				double max_error = 0;
+				double psnr = PSNR( result, reference, max_error );
+				double mask_difference = MaskDifference( result, reference, mask, reference_mask );
+
+				printf( "  %-10s %4d %10.3f %7.2fx %10.1f %10.0f %12.3f\n",
+						ImageSmoother::GetName( smoother.GetMethod() ), sizes[s], time, reference_time / time,
+						psnr, max_error, mask_difference );
+			}
+		}
+
+		printf( "\n" );
+
+		cvReleaseImage( &reference_mask );
+		cvReleaseImage( &mask );
+		cvReleaseImage( &result );
+		cvReleaseImage( &reference );
+		cvReleaseImage( &image );
+	}
+
+	return 0;
+}
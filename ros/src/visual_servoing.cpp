@@ -11,6 +11,8 @@
 
 // ROS
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <ros/file_log.h>
 #include <std_srvs/Empty.h>
 #include "std_msgs/String.h"
 #include "geometry_msgs/Twist.h"
@@ -30,14 +32,76 @@
 #include <hbrs_srvs/ReturnBool.h>
 #include <raw_srvs/DoVisualServoing.h>
 #include <raw_msgs/VisualServoing.h>
+#include <raw_visual_servoing/VisualServoingFeedback.h>
+#include <raw_visual_servoing/SelectTarget.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <arm_navigation_msgs/JointLimits.h>
 #include <brics_actuator/JointVelocities.h>
 #include <brics_actuator/JointPositions.h>
 
+// BOOST
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <cstdio>
+#include <ctime>
+
 #include "VisualServoing2D.h"
+#include "LatestSlot.h"
+#include "WorkerPool.h"
 
 namespace enc = sensor_msgs::image_encodings;
 
+/**
+ * A camera image that is handed from the ingest stage to the detection stage. The frame wraps the
+ * pixels of the message in place, so the message is kept alive for as long as the frame is used.
+ */
+struct CameraFrame
+{
+	sensor_msgs::ImageConstPtr						message;
+	ImageFrame										view;
+	ros::Time										stamp;
+	FrameTimestamps									timestamps;
+};
+
+/**
+ * A camera that is processed by the node. Every stream has its own VisualServoing2D, and with it
+ * its own background, tracking state and threshold, but the detection of all streams runs on the
+ * shared worker pool and takes its scratch images from the shared buffer pool.
+ */
+struct CameraStream : private boost::noncopyable
+{
+	CameraStream() : mode( 0 ), visual_servoing( NULL ), scheduled( 0 )
+	{
+	}
+
+	~CameraStream()
+	{
+		delete visual_servoing;
+	}
+
+	std::string										name;
+	std::string										topic;
+	int												mode;
+
+	VisualServoing2D*								visual_servoing;
+	image_transport::Subscriber						subscriber;
+
+	/*
+	 * Streams that do not drive the robot publish their observations here.
+	 */
+	ros::Publisher									feedback_publisher;
+
+	LatestSlot<CameraFrame>							frame_slot;
+	LatestSlot<TargetObservation>					observation_slot;
+
+	/*
+	 * Set while a detection task of the stream is queued or running, so that the frames of one
+	 * stream are never detected concurrently.
+	 */
+	volatile int									scheduled;
+};
+
 /**
  * This is the ROS Node for the visual servoing application. It will get all of the ROS dependent
  * attributes and determine which library should be run 2D or 3D visual servoing.
@@ -50,19 +114,54 @@ public:
 	 * the visual seroving service so that the process can be started and stopped on command. If you
 	 * want to start the visual servoing you need to run the do_visual_servoing service hook.
 	 */
-	VisualServoing( ): m_image_transporter( m_node_handler )
+	VisualServoing( )
 	{
+		// The camera and joint state callbacks are served by their own thread so that they keep
+		// running while a service call waits for the visual servoing to finish. The image transport
+		// keeps a copy of the node handle, so it is only made once the queue is set.
+		m_session_node_handler.setCallbackQueue( &m_session_queue );
+		m_image_transporter = new image_transport::ImageTransport( m_session_node_handler );
+		m_session_spinner = new ros::AsyncSpinner( 1, &m_session_queue );
+		m_session_spinner->start();
+
 		ros::NodeHandle temp( "~" );
 
 		SetupYoubotArm();
+		SetupStreams( temp );
+
+		// Flight records of failed sessions go to the ROS log folder unless told otherwise.
+		temp.param( "flight_recorder_dir", m_flight_recorder_dir, ros::file_log::getLogDirectory() );
+
+		int worker_threads = 0;
+		temp.param( "worker_threads", worker_threads, 0 );
+		m_worker_pool = new WorkerPool( std::max( 0, worker_threads ) );
+		ROS_INFO( "Processing %u camera stream(s) on %u worker threads", (unsigned int)m_streams.size(), m_worker_pool->GetThreadCount() );
 
-		m_visual_servoing = new VisualServoing2D( false, 0, m_arm_joint_names );
+		m_is_visual_servoing_completed = 0;
+		m_pipeline_running = false;
+		m_session_active = false;
+		m_session_cancelled = false;
  
 		m_dynamic_reconfigre_subscriber.setCallback(boost::bind( &VisualServoing::dynamic_reconfig_callback, this, _1, _2 ) );
 
 		// Service commands to allow this node to be started and stopped externally
 		service_do_visual_serv = m_node_handler.advertiseService( "do_visual_servoing", &VisualServoing::do_visual_servoing, this );
 		ROS_INFO( "Advertised 'do_visual_servoing' service for raw_visual_servoing" );
+
+		service_start_visual_serv = m_node_handler.advertiseService( "start_visual_servoing", &VisualServoing::start_visual_servoing, this );
+		service_cancel_visual_serv = m_node_handler.advertiseService( "cancel_visual_servoing", &VisualServoing::cancel_visual_servoing, this );
+		service_select_target = m_node_handler.advertiseService( "select_visual_servoing_target", &VisualServoing::select_target, this );
+		service_dump_flight_recorder = m_node_handler.advertiseService( "dump_visual_servoing_flight_record", &VisualServoing::dump_flight_recorder, this );
+		m_feedback_publisher = m_node_handler.advertise<raw_visual_servoing::VisualServoingFeedback>( "visual_servoing_feedback", 1 );
+
+		// The latencies of all streams are published now and then, if they are being recorded at all.
+		if( LatencyMonitor::IsEnabled() )
+		{
+			double diagnostics_period = 1.0;
+			temp.param( "diagnostics_period", diagnostics_period, 1.0 );
+			m_diagnostics_publisher = m_node_handler.advertise<diagnostic_msgs::DiagnosticArray>( "/diagnostics", 1 );
+			m_diagnostics_timer = m_node_handler.createTimer( ros::Duration( diagnostics_period ), &VisualServoing::diagnosticsCallback, this );
+		}
 		ROS_INFO( "Visual servoing node initialized." );
 	}
 
@@ -71,72 +170,104 @@ public:
 	 */
 	~VisualServoing()
 	{
+		{
+			boost::mutex::scoped_lock lock( m_session_mutex );
+			m_session_cancelled = true;
+		}
+		m_session_condition.notify_all();
+
+		if( m_session_thread.joinable() )
+		{
+			m_session_thread.join();
+		}
+
+		StopPipeline();
+
+		m_session_spinner->stop();
+		delete m_session_spinner;
+
+		delete m_worker_pool;
+		for( unsigned int i = 0; i < m_streams.size(); i++ )
+		{
+			delete m_streams[i];
+		}
+		delete m_image_transporter;
 	}
 
 	/**
 	 * This is the service hook for visual servoing. If you want to run the acutal visual servoing
-	 * you wll need to call the "do_visual_servoing" service call through ROS.
+	 * you wll need to call the "do_visual_servoing" service call through ROS. The call blocks until
+	 * the visual servoing has finished, but the thread that runs it sleeps while it waits.
 	 */
 	bool do_visual_servoing( raw_srvs::DoVisualServoing::Request &req,
 							 raw_srvs::DoVisualServoing::Response &res )
 	{
-		m_is_visual_servoing_completed = 0;
-
-		//  Incoming message from raw_usbs_cam. This must be running in order for this ROS node to run.
-		m_image_subscriber = m_image_transporter.subscribe( "/usb_cam/image_raw", 1, &VisualServoing::imageCallback, this );
-
-		// get joint states and store them to a variable and go through them (arm_link_5) and check to see if the current state is
-		// to close to the min or max value.
-		m_sub_joint_states = m_node_handler.subscribe( "/joint_states", 1, &VisualServoing::jointstateCallback, this );
-
-		// Velocity control for the YouBot base.
-		base_velocities_publisher = m_node_handler.advertise<geometry_msgs::Twist>( "/cmd_vel_safe", 1 );
-
-		m_visual_servoing->CreatePublishers( 1 );
-
-		ros::Time start_time = ros::Time::now();
-
-		ROS_INFO("VisualServoing: Starting Blob Detection");
-
-		while( ( m_is_visual_servoing_completed == 0 ) && ros::ok() && ( (ros::Time::now() - start_time).toSec() < m_visual_servoing_timeout ) )
-		{
-			ros::spinOnce();
-		}
-
-		/**
-		 * TODO: set visual servoing output to an enumeration.
-		 */
-		if( m_is_visual_servoing_completed == 2 )
+		if( !StartSession() )
 		{
-			ShutDown();
-			ROS_ERROR( "Visual servoing failure due to lost object" );
-			res.return_value.error_code = raw_msgs::VisualServoing::LOST_OBJ;
+			ROS_ERROR( "Visual servoing is already running" );
+			res.return_value.error_code = raw_msgs::VisualServoing::FAILED;
 			return true;
 		}
-		else if( m_is_visual_servoing_completed == 3 )
+
+		res.return_value.error_code = RunSession();
+		return true;
+	}
+
+	/**
+	 * This is the non-blocking version of do_visual_servoing. It starts the visual servoing and
+	 * returns immediately. The progress is published on "visual_servoing_feedback" and the last
+	 * message of the session has its done flag set and carries the result. The session can be
+	 * stopped early with the "cancel_visual_servoing" service.
+	 */
+	bool start_visual_servoing( std_srvs::Empty::Request &req, std_srvs::Empty::Response &res )
+	{
+		if( !StartSession() )
 		{
-			ShutDown();
-			ROS_ERROR( "Visual servoing failure due to general unrecoverable error" );
-			res.return_value.error_code = raw_msgs::VisualServoing::FAILED;
-			return true;
+			ROS_ERROR( "Visual servoing is already running" );
+			return false;
 		}
 
-		if( (ros::Time::now() - start_time).toSec() < m_visual_servoing_timeout )
+		if( m_session_thread.joinable() )
 		{
-			ShutDown();
-			ROS_INFO( "Visual Servoing Sucessful." );
-			res.return_value.error_code = raw_msgs::VisualServoing::SUCCESS;
-			return true;
+			m_session_thread.join();
 		}
-		else
+		m_session_thread = boost::thread( boost::bind( &VisualServoing::RunSession, this ) );
+		return true;
+	}
+
+	/**
+	 * Stops a running visual servoing session, which then reports a failure.
+	 */
+	bool cancel_visual_servoing( std_srvs::Empty::Request &req, std_srvs::Empty::Response &res )
+	{
 		{
-			ShutDown();
-			ROS_ERROR( "Visual Servoing Failure due to Timeout" );
-			res.return_value.error_code = raw_msgs::VisualServoing::TIMEOUT;
-			return true;
+			boost::mutex::scoped_lock lock( m_session_mutex );
+			m_session_cancelled = true;
 		}
+		m_session_condition.notify_all();
+
+		return true;
+	}
+
+	/**
+	 * Switches the stream that drives the robot to another tracked object. The feedback tells from
+	 * which frame on the new target is used.
+	 */
+	bool select_target( raw_visual_servoing::SelectTarget::Request &req, raw_visual_servoing::SelectTarget::Response &res )
+	{
+		ROS_INFO( "Selecting object %d as the target", req.id );
+		m_visual_servoing->SelectTarget( req.id );
+
+		return true;
+	}
 
-		return false;
+	/**
+	 * Writes the flight record of the stream that drives the robot to a file, as is done
+	 * automatically when a session fails.
+	 */
+	bool dump_flight_recorder( std_srvs::Empty::Request &req, std_srvs::Empty::Response &res )
+	{
+		return DumpFlightRecord( "request" );
 	}
 
 	/**
@@ -181,42 +312,483 @@ private:
   }
 
   /**
-   * This function is responsible for calling the libraries that will perform the visual servoing
-   * on the image that is coming in from either the 2D or 3D camera depending on which sensors are
-   * currently available to the user.
+   * This function reads the camera streams from the "streams" parameter, a list of entries with a
+   * name, an image topic and the visual servoing mode (0 - normal, 1 - conveyer belt):
+   *
+   *   streams: [ { name: wrist, topic: /usb_cam/image_raw, mode: 0 },
+   *              { name: overview, topic: /overview_cam/image_raw, mode: 1 } ]
+   *
+   * The stream named by the "servo_stream" parameter (the first one by default) drives the robot,
+   * the others only report what they see. Without the parameter only the wrist camera is used.
    */
-  void imageCallback( const sensor_msgs::ImageConstPtr& image_message )
+  void SetupStreams( ros::NodeHandle& private_node_handler )
+  {
+	  XmlRpc::XmlRpcValue stream_list;
+	  if( private_node_handler.getParam( "streams", stream_list ) && stream_list.getType() == XmlRpc::XmlRpcValue::TypeArray )
+	  {
+		  for( int32_t i = 0; i < stream_list.size(); ++i )
+		  {
+			  ROS_ASSERT( stream_list[i].getType() == XmlRpc::XmlRpcValue::TypeStruct );
+
+			  CameraStream* stream = new CameraStream();
+			  stream->name = stream_list[i].hasMember( "name" ) ? static_cast<std::string>( stream_list[i]["name"] ) : "camera_" + boost::lexical_cast<std::string>( i );
+			  stream->topic = static_cast<std::string>( stream_list[i]["topic"] );
+			  stream->mode = stream_list[i].hasMember( "mode" ) ? static_cast<int>( stream_list[i]["mode"] ) : 0;
+			  m_streams.push_back( stream );
+		  }
+	  }
+
+	  if( m_streams.empty() )
+	  {
+		  //  Incoming message from raw_usbs_cam. This must be running in order for this ROS node to run.
+		  CameraStream* stream = new CameraStream();
+		  stream->name = "wrist";
+		  stream->topic = "/usb_cam/image_raw";
+		  stream->mode = 0;
+		  m_streams.push_back( stream );
+	  }
+
+	  std::string servo_stream;
+	  private_node_handler.param( "servo_stream", servo_stream, m_streams[0]->name );
+
+	  m_servo_stream = m_streams[0];
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  if( m_streams[i]->name == servo_stream )
+		  {
+			  m_servo_stream = m_streams[i];
+		  }
+	  }
+	  if( m_servo_stream->name != servo_stream )
+	  {
+		  ROS_ERROR( "Unknown servo stream '%s', using '%s'", servo_stream.c_str(), m_servo_stream->name.c_str() );
+	  }
+
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  CameraStream* stream = m_streams[i];
+		  stream->visual_servoing = new VisualServoing2D( false, stream->mode, m_arm_joint_names, &m_buffer_pool );
+
+		  if( stream != m_servo_stream )
+		  {
+			  stream->visual_servoing->SetDebugTopic( stream->name + "/visual_servoing_hud" );
+			  stream->feedback_publisher = m_node_handler.advertise<raw_visual_servoing::VisualServoingFeedback>( stream->name + "/visual_servoing_feedback", 1 );
+		  }
+
+		  ROS_INFO( "Camera stream '%s' on %s (mode %d)", stream->name.c_str(), stream->topic.c_str(), stream->mode );
+	  }
+
+	  m_visual_servoing = m_servo_stream->visual_servoing;
+  }
+
+  /**
+   * This function receives the images of a camera stream. The image is wrapped in the encoding it
+   * arrived in, without copying or converting it, and handed to the detection of the stream, which
+   * runs on the worker pool so that the ROS callback thread is never blocked by the image
+   * processing. If the detection has not picked up the previous image yet it is dropped.
+   */
+  void imageCallback( CameraStream* stream, const sensor_msgs::ImageConstPtr& image_message )
   	{
-  		IplImage *cv_image = NULL;
-  		
-  		/**
-  		cv_bridge::CvImagePtr cv_ptr;
+		int64_t ingest_time = LatencyMonitor::Now();
+		ImageFrame::Encoding encoding = ImageFrame::ParseEncoding( image_message->encoding );
+
+		CameraFrame& frame = stream->frame_slot.WriteBuffer();
+		if( image_message->data.empty() || !frame.view.Wrap( &image_message->data[0], image_message->width, image_message->height, image_message->step, encoding ) )
+		{
+			ROS_ERROR_THROTTLE( 1.0, "Unsupported image encoding '%s'.", image_message->encoding.c_str() );
+			return;
+		}
 
-		try
+		frame.message = image_message;
+		frame.stamp = image_message->header.stamp;
+		frame.view.SetStamp( frame.stamp.toSec() );
+
+		if( LatencyMonitor::IsEnabled() )
 		{
-			//cv_ptr = cv_bridge::toCvCopy( image_message, enc::BGR8 );
-			cv_image = sensor_msgs::CvBridge::imgMsgToCv( image_message, enc::BGR8 ); 
+			// The stamp is moved onto the monotonic clock by the age of the image.
+			int64_t age = frame.stamp.isZero() ? 0 : ( ros::Time::now() - frame.stamp ).toNSec();
+			frame.timestamps.image = ingest_time - age;
+			frame.timestamps.ingest = ingest_time;
+			stream->visual_servoing->GetLatencyMonitor().Record( LatencyMonitor::INGEST, age );
 		}
-		catch( cv_bridge::Exception& e )
+
+		if( stream->frame_slot.Publish() )
 		{
-			ROS_ERROR("cv_bridge exception: %s", e.what());
+			ROS_DEBUG( "Dropped a frame of '%s' before detection", stream->name.c_str() );
 		}
-		//cv_image = cv_ptr->image;
-
-		*/
-		sensor_msgs::CvBridge bridge;
-  		try
-  		{
-  			cv_image = bridge.imgMsgToCv( image_message, "bgr8" );
-  		}
-  		catch( sensor_msgs::CvBridgeException& e )
-  		{
-  			ROS_ERROR( "Could not convert from '%s' to 'bgr8'.", image_message->encoding.c_str() );
-  		}
-
- 		m_is_visual_servoing_completed = m_visual_servoing->VisualServoing( cv_image );
+
+		ScheduleDetection( stream );
   	}
 
+  /**
+   * Sets up the subscribers, the publishers and the pipeline for a new visual servoing session.
+   * Returns false if a session is already running.
+   */
+  bool StartSession()
+  {
+	  {
+		  boost::mutex::scoped_lock lock( m_session_mutex );
+		  if( m_session_active )
+		  {
+			  return false;
+		  }
+
+		  m_session_active = true;
+		  m_session_cancelled = false;
+		  m_is_visual_servoing_completed = 0;
+	  }
+
+	  m_session_start_time = ros::Time::now();
+
+	  // Every stream starts over with the largest blob, the servo stream does so in CreatePublishers().
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  if( m_streams[i] != m_servo_stream )
+		  {
+			  m_streams[i]->visual_servoing->ResetSession();
+		  }
+	  }
+
+	  m_visual_servoing->CreatePublishers( 1 );
+	  StartPipeline();
+
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  m_streams[i]->subscriber = m_image_transporter->subscribe( m_streams[i]->topic, 1, boost::bind( &VisualServoing::imageCallback, this, m_streams[i], _1 ) );
+	  }
+
+	  // get joint states and store them to a variable and go through them (arm_link_5) and check to see if the current state is
+	  // to close to the min or max value.
+	  m_sub_joint_states = m_session_node_handler.subscribe( "/joint_states", 1, &VisualServoing::jointstateCallback, this );
+
+	  // Velocity control for the YouBot base.
+	  base_velocities_publisher = m_node_handler.advertise<geometry_msgs::Twist>( "/cmd_vel_safe", 1 );
+
+	  ROS_INFO("VisualServoing: Starting Blob Detection");
+	  return true;
+  }
+
+  /**
+   * Sleeps until the control stage reports that the visual servoing has finished, the session is
+   * cancelled or the timeout is reached. It then shuts the session down, publishes the result as
+   * the last feedback message and returns it.
+   */
+  int RunSession()
+  {
+	  int completed = 0;
+	  bool cancelled = false;
+
+	  {
+		  boost::mutex::scoped_lock lock( m_session_mutex );
+		  boost::system_time deadline = boost::get_system_time() + boost::posix_time::seconds( m_visual_servoing_timeout );
+
+		  while( m_is_visual_servoing_completed == 0 && !m_session_cancelled && ros::ok() )
+		  {
+			  // Wake up now and then to notice a ROS shutdown.
+			  boost::system_time wake_up = std::min( deadline, boost::get_system_time() + boost::posix_time::milliseconds( m_stage_timeout ) );
+			  m_session_condition.timed_wait( lock, wake_up );
+
+			  if( boost::get_system_time() >= deadline )
+			  {
+				  break;
+			  }
+		  }
+
+		  completed = m_is_visual_servoing_completed;
+		  cancelled = m_session_cancelled;
+	  }
+
+	  ShutDown();
+
+	  int error_code;
+	  if( completed == 1 )
+	  {
+		  ROS_INFO( "Visual Servoing Sucessful." );
+		  error_code = raw_msgs::VisualServoing::SUCCESS;
+	  }
+	  else if( completed == 2 )
+	  {
+		  ROS_ERROR( "Visual servoing failure due to lost object" );
+		  error_code = raw_msgs::VisualServoing::LOST_OBJ;
+	  }
+	  else if( completed == 3 || cancelled )
+	  {
+		  ROS_ERROR( "Visual servoing failure due to general unrecoverable error" );
+		  error_code = raw_msgs::VisualServoing::FAILED;
+	  }
+	  else
+	  {
+		  ROS_ERROR( "Visual Servoing Failure due to Timeout" );
+		  error_code = raw_msgs::VisualServoing::TIMEOUT;
+	  }
+
+	  // The pipeline has been stopped, so the record ends with the last frame of the session.
+	  // A cancel is asked for by the user, so it is not recorded as a failure.
+	  if( error_code == raw_msgs::VisualServoing::LOST_OBJ )
+	  {
+		  DumpFlightRecord( "lost_object" );
+	  }
+	  else if( error_code == raw_msgs::VisualServoing::FAILED && completed != 3 && cancelled )
+	  {
+		  DumpFlightRecord( "canceled" );
+	  }
+	  else if( error_code == raw_msgs::VisualServoing::FAILED )
+	  {
+		  DumpFlightRecord( "failed" );
+	  }
+	  else if( error_code == raw_msgs::VisualServoing::TIMEOUT )
+	  {
+		  DumpFlightRecord( "timeout" );
+	  }
+
+	  raw_visual_servoing::VisualServoingFeedback feedback;
+	  feedback.header.stamp = ros::Time::now();
+	  feedback.elapsed = ( feedback.header.stamp - m_session_start_time ).toSec();
+	  feedback.done = true;
+	  feedback.error_code = error_code;
+	  m_feedback_publisher.publish( feedback );
+
+	  {
+		  boost::mutex::scoped_lock lock( m_session_mutex );
+		  m_session_active = false;
+	  }
+
+	  return error_code;
+  }
+
+  /**
+   * Writes the flight record of the stream that drives the robot to a file in the flight recorder
+   * folder, named after the current time and the provided reason. Returns false if it could not be
+   * written.
+   */
+  bool DumpFlightRecord( const std::string& reason )
+  {
+	  char time_string[32];
+	  time_t now = time( NULL );
+	  strftime( time_string, sizeof( time_string ), "%Y%m%d-%H%M%S", localtime( &now ) );
+
+	  std::string path = m_flight_recorder_dir + "/visual_servoing_" + time_string + "_" + reason + ".vsfr";
+	  if( !m_visual_servoing->GetFlightRecorder().Dump( path ) )
+	  {
+		  ROS_ERROR( "Could not write the flight record to %s", path.c_str() );
+		  return false;
+	  }
+
+	  ROS_INFO( "Flight record written to %s", path.c_str() );
+	  return true;
+  }
+
+  /**
+   * The visual servoing runs as a pipeline: the camera callbacks wrap the images, the detection
+   * finds the blob in them and the control stage moves the robot. The detection of every stream is
+   * a task on the shared worker pool, the control stage of the stream that drives the robot has a
+   * thread of its own. The stages are connected by LatestSlots, so every stage always works on the
+   * newest output of the previous one and a slow frame delays only the stage it is in.
+   */
+  void StartPipeline()
+  {
+	  StopPipeline();
+
+	  // Throw away anything left over from the previous run.
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  m_streams[i]->frame_slot.Take();
+		  m_streams[i]->observation_slot.Take();
+	  }
+
+	  m_pipeline_running = true;
+	  m_control_thread = boost::thread( boost::bind( &VisualServoing::ControlLoop, this ) );
+  }
+
+  /**
+   * Stops the control thread and waits for the detection tasks to finish the frame they are working
+   * on.
+   */
+  void StopPipeline()
+  {
+	  m_pipeline_running = false;
+
+	  m_servo_stream->observation_slot.Wake();
+
+	  if( m_control_thread.joinable() )
+	  {
+		  m_control_thread.join();
+	  }
+
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  while( m_streams[i]->scheduled )
+		  {
+			  boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+		  }
+	  }
+  }
+
+  /**
+   * Queues a detection task for the stream on the worker pool, unless one is already queued or
+   * running, in which case that task picks up the new frame.
+   */
+  void ScheduleDetection( CameraStream* stream )
+  {
+	  if( m_pipeline_running && __sync_bool_compare_and_swap( &stream->scheduled, 0, 1 ) )
+	  {
+		  m_worker_pool->Submit( boost::bind( &VisualServoing::DetectionTask, this, stream ) );
+	  }
+  }
+
+  /**
+   * The detection stage of a stream: finds the tracked blob in the latest frame until there are no
+   * new frames left. The observations of the stream that drives the robot go to the control stage,
+   * those of the other streams are published right away.
+   */
+  void DetectionTask( CameraStream* stream )
+  {
+	  while( m_pipeline_running && stream->frame_slot.Take() )
+	  {
+		  const CameraFrame& frame = stream->frame_slot.ReadBuffer();
+		  TargetObservation& observation = stream->observation_slot.WriteBuffer();
+		  if( !stream->visual_servoing->DetectTarget( frame.view, observation ) )
+		  {
+			  continue;
+		  }
+
+		  observation.timestamps = frame.timestamps;
+		  observation.timestamps.detected = stream->visual_servoing->GetLatencyMonitor().RecordSince( LatencyMonitor::DETECT, frame.timestamps.ingest );
+
+		  if( stream == m_servo_stream )
+		  {
+			  stream->observation_slot.Publish();
+		  }
+		  else
+		  {
+			  stream->feedback_publisher.publish( MakeFeedback( observation ) );
+		  }
+	  }
+
+	  __sync_lock_release( &stream->scheduled );
+
+	  // A frame that arrived after the last Take() would otherwise wait for the next one.
+	  if( stream->frame_slot.HasNew() )
+	  {
+		  ScheduleDetection( stream );
+	  }
+  }
+
+  /**
+   * Returns a (not done) feedback message for the provided observation.
+   */
+  raw_visual_servoing::VisualServoingFeedback MakeFeedback( const TargetObservation& observation )
+  {
+	  raw_visual_servoing::VisualServoingFeedback feedback;
+	  feedback.header.stamp = ros::Time::now();
+	  feedback.found = observation.found;
+	  feedback.x_offset = observation.x_offset;
+	  feedback.y_offset = observation.y_offset;
+	  feedback.rot_offset = observation.rot_offset;
+	  feedback.target_id = observation.target_id;
+	  feedback.quality_level = observation.quality_level;
+
+	  feedback.objects.resize( observation.objects.size() );
+	  for( unsigned int i = 0; i < observation.objects.size(); i++ )
+	  {
+		  const ObjectTrack& track = observation.objects[i];
+		  raw_visual_servoing::TrackedObject& object = feedback.objects[i];
+		  object.id = track.id;
+		  object.x = track.filter.GetX();
+		  object.y = track.filter.GetY();
+		  object.velocity_x = track.filter.GetVelocityX();
+		  object.velocity_y = track.filter.GetVelocityY();
+		  object.width = track.width;
+		  object.height = track.height;
+		  object.seen_frames = track.filter.GetCorrectedFrames();
+		  object.missed_frames = track.filter.GetCoastedFrames();
+	  }
+	  feedback.elapsed = ( feedback.header.stamp - m_session_start_time ).toSec();
+	  feedback.done = false;
+	  feedback.error_code = raw_msgs::VisualServoing::SUCCESS;
+
+	  return feedback;
+  }
+
+  /**
+   * The control stage: moves the robot according to the latest observation and reports when the
+   * visual servoing has finished.
+   */
+  void ControlLoop()
+  {
+	  while( m_pipeline_running )
+	  {
+		  if( !m_servo_stream->observation_slot.Wait( m_stage_timeout ) )
+		  {
+			  continue;
+		  }
+
+		  const TargetObservation& observation = m_servo_stream->observation_slot.ReadBuffer();
+		  LatencyMonitor& latency_monitor = m_visual_servoing->GetLatencyMonitor();
+
+		  int64_t control_time = latency_monitor.RecordSince( LatencyMonitor::QUEUE, observation.timestamps.detected );
+		  int result = m_visual_servoing->ServoToTarget( observation );
+		  latency_monitor.RecordSince( LatencyMonitor::CONTROL, control_time );
+
+		  m_feedback_publisher.publish( MakeFeedback( observation ) );
+
+		  if( result != 0 )
+		  {
+			  {
+				  boost::mutex::scoped_lock lock( m_session_mutex );
+				  m_is_visual_servoing_completed = result;
+			  }
+			  m_session_condition.notify_all();
+			  break;
+		  }
+	  }
+  }
+
+  /**
+   * Publishes the latencies that every stream recorded since the last call as a diagnostic status
+   * per stream, with the count, mean, p50, p99 and maximum (in ms) of each stage.
+   */
+  void diagnosticsCallback( const ros::TimerEvent& event )
+  {
+	  diagnostic_msgs::DiagnosticArray diagnostics;
+	  diagnostics.header.stamp = ros::Time::now();
+
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  LatencySummary summaries[LatencyMonitor::STAGE_COUNT];
+		  m_streams[i]->visual_servoing->GetLatencyMonitor().Snapshot( summaries );
+
+		  diagnostic_msgs::DiagnosticStatus status;
+		  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+		  status.name = "raw_visual_servoing: " + m_streams[i]->name + " latency";
+		  status.hardware_id = m_streams[i]->topic;
+		  status.message = "Latencies in ms since the last report";
+
+		  for( int stage = 0; stage < LatencyMonitor::STAGE_COUNT; stage++ )
+		  {
+			  const LatencySummary& summary = summaries[stage];
+			  if( summary.count == 0 )
+			  {
+				  continue;
+			  }
+
+			  diagnostic_msgs::KeyValue value;
+			  value.key = LatencyMonitor::GetName( (LatencyMonitor::Stage)stage );
+
+			  char text[128];
+			  snprintf( text, sizeof( text ), "n %u, mean %.2f, p50 %.2f, p99 %.2f, max %.2f",
+						summary.count, summary.mean, summary.p50, summary.p99, summary.max );
+			  value.value = text;
+
+			  status.values.push_back( value );
+		  }
+
+		  diagnostics.status.push_back( status );
+	  }
+
+	  m_diagnostics_publisher.publish( diagnostics );
+  }
+
   /**
    * This function is a call back that updates the current positions of the
    */
@@ -228,7 +800,10 @@ private:
 			{
 				ROS_DEBUG_STREAM( "Joint Name: " << joints->name[i].c_str() );
 				ROS_DEBUG_STREAM( "Updated Gripper Position: " << joints->position[i] );
-				m_visual_servoing->UpdateGripperPosition( joints->position[i] );
+				for( unsigned int j = 0; j < m_streams.size(); j++ )
+				{
+					m_streams[j]->visual_servoing->UpdateGripperPosition( joints->position[i] );
+				}
 			}
 
 		}
@@ -237,7 +812,10 @@ private:
   void dynamic_reconfig_callback(raw_visual_servoing::VisualServoingConfig &config, uint32_t level) 
   {
   		ROS_DEBUG_STREAM( "New Var: " << config.binary_threshold ); 
-	    m_visual_servoing->UpdateDynamicVariables( config );    
+	    for( unsigned int i = 0; i < m_streams.size(); i++ )
+	    {
+	    	m_streams[i]->visual_servoing->UpdateDynamicVariables( config );
+	    }
 	}
 
   /**
@@ -271,7 +849,7 @@ private:
 			  return false;
 		  }
 	  }
-	  ROS_INFO( "Joint states okay" );
+	  ROS_DEBUG( "Joint states okay" );
 	  return true;
   }
 
@@ -286,27 +864,45 @@ private:
 	  base_velocities_publisher.publish(zero_vel);
 
 	  // shutdown any subscribers and publishers
-	  m_image_subscriber.shutdown();
+	  for( unsigned int i = 0; i < m_streams.size(); i++ )
+	  {
+		  m_streams[i]->subscriber.shutdown();
+	  }
+	  StopPipeline();
 	  base_velocities_publisher.shutdown();
 	  m_sub_joint_states.shutdown();
 
-	  // Shut down any open windows.
-	  cvDestroyAllWindows();
+	  // Zeroes the base and arm velocities and stops asking the safety node, the control stage only
+	  // does this itself when the visual servoing succeeds.
+	  m_visual_servoing->DestroyPublishers();
   }
 
 protected:
 
+  /*
+   * The camera streams and what they share. m_visual_servoing belongs to the stream that drives
+   * the robot.
+   */
+  std::vector<CameraStream*>						m_streams;
+  CameraStream*										m_servo_stream;
   VisualServoing2D*									m_visual_servoing;
+  ImageBufferPool									m_buffer_pool;
+  WorkerPool*										m_worker_pool;
 
   /*
    * Standard ROS Publishers and Subscribers.
    */
   ros::NodeHandle 									m_node_handler; 
-  image_transport::ImageTransport 					m_image_transporter;
+  ros::NodeHandle 									m_session_node_handler; 
+  ros::CallbackQueue								m_session_queue;
+  ros::AsyncSpinner*								m_session_spinner;
+  ros::Publisher									m_feedback_publisher;
+  ros::Publisher									m_diagnostics_publisher;
+  ros::Timer										m_diagnostics_timer;
+  image_transport::ImageTransport* 					m_image_transporter;
   ros::Publisher								 	base_velocities_publisher;
 
   ros::Subscriber 									m_sub_joint_states;
-  image_transport::Subscriber 						m_image_subscriber;
 
   dynamic_reconfigure::Server<raw_visual_servoing::VisualServoingConfig> m_dynamic_reconfigre_subscriber; 
 
@@ -317,9 +913,40 @@ protected:
   std::vector<bool> 								m_joint_positions_initialized;
 
   ros::ServiceServer 								service_do_visual_serv;
+  ros::ServiceServer 								service_start_visual_serv;
+  ros::ServiceServer 								service_cancel_visual_serv;
+  ros::ServiceServer 								service_select_target;
+  ros::ServiceServer 								service_dump_flight_recorder;
+
+  /*
+   * Where the flight records are written to.
+   */
+  std::string										m_flight_recorder_dir;
+
+  /*
+   * The state of the current visual servoing session. m_is_visual_servoing_completed is set by the
+   * control stage, which then signals the condition.
+   */
+  boost::mutex										m_session_mutex;
+  boost::condition_variable							m_session_condition;
+  boost::thread										m_session_thread;
+  bool												m_session_active;
+  bool												m_session_cancelled;
+  ros::Time											m_session_start_time;
 
   int 												m_is_visual_servoing_completed;
 
+  /*
+   * The control stage, the slots between the stages belong to the streams.
+   */
+  boost::thread										m_control_thread;
+  volatile bool										m_pipeline_running;
+
+  /*
+   * How long (in ms) a stage waits for input before it checks whether it should stop.
+   */
+  const static int									m_stage_timeout = 100;
+
   const static int 									m_visual_servoing_timeout = 15;
 
   KDL::Chain 										m_arm_chain;
@@ -333,6 +960,11 @@ int main(int argc, char** argv)
 {
   ros::init(argc, argv, "raw_visual_servoing");
   VisualServoing ic;
-  ros::spin();
+
+  // A second thread keeps dynamic reconfigure and the cancel service responsive while a blocking
+  // do_visual_servoing call is waiting.
+  ros::AsyncSpinner spinner( 2 );
+  spinner.start();
+  ros::waitForShutdown();
   return 0;
 }